@@ -0,0 +1,279 @@
+//-----------------------------------------------------------------------------
+//  Microbenchmark of the derivative kernel shared with
+//  03_dais_compute_pass.comp, scalar vs. batch of 8 triangles, followed by an
+//  error analysis of storing the derivatives in half precision.
+//
+//  Usage: DAISDerivativesBenchmark [--triangles 1048576] [--seed 1]
+//                                  [--repetitions 5]
+//-----------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <dais_reference.h>
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/packing.hpp>
+
+using namespace DAISReference;
+
+namespace {
+constexpr float TextureSize = 1024.0f; // UV errors are reported in texels
+constexpr float HalfMax = 65504.0f;
+constexpr int SamplesPerTriangle = 16;
+
+//-----------------------------------------------------------------------------
+// Name: createTriangles()
+// Desc: Random view-space triangles in front of the camera, some of them
+//       crossing the near plane and the sides of the frustum, so that both
+//       paths of shrinkTriangle() are exercised.
+//-----------------------------------------------------------------------------
+std::vector<Triangle> createTriangles(size_t count, uint32_t seed,
+                                      const glm::mat4& projection) {
+    std::mt19937 engine(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> depth(0.05f, 100.0f);
+    std::uniform_real_distribution<float> size(0.01f, 2.0f);
+
+    std::vector<Triangle> triangles(count);
+    for (auto& triangle : triangles) {
+        const float z = -depth(engine);
+        const glm::vec3 center(unit(engine) * -z, unit(engine) * -z, z);
+        const float radius = size(engine);
+        for (int i = 0; i < 3; i++) {
+            const glm::vec3 position
+              = center
+                + radius * glm::vec3(unit(engine), unit(engine), unit(engine));
+            const glm::vec3 normal = glm::normalize(
+              glm::vec3(unit(engine), unit(engine), unit(engine))
+              + glm::vec3(0.0f, 0.0f, 1.5f));
+            const glm::vec2 UV(unit(engine), unit(engine));
+
+            triangle.vertices[i] = projection * glm::vec4(position, 1.0f);
+            triangle.normalsSnormOct[i]
+              = glm::packSnorm2x16(float32x3ToOct(normal));
+            triangle.UVsUnorm[i] = glm::packSnorm2x16(UV);
+        }
+    }
+    return triangles;
+}
+
+template<typename Function>
+double measureNanosecondsPerTriangle(size_t count, int repetitions,
+                                     Function&& function) {
+    double best = HUGE_VAL;
+    for (int i = 0; i < repetitions; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::duration<double, std::nano> duration
+          = std::chrono::steady_clock::now() - start;
+        best = std::min(best, duration.count() / count);
+    }
+    return best;
+}
+
+// The 24 floats of the record without padding
+template<typename Function>
+void forEachField(TriangleDerivatives& derivatives, Function&& function) {
+    for (int c = 0; c < 2; c++) {
+        function(derivatives.dUV_dX[c], false);
+        function(derivatives.dUV_dY[c], false);
+        function(derivatives.UV_fixed[c], false);
+    }
+    for (int c = 0; c < 3; c++) {
+        function(derivatives.dNormal_dX[c], false);
+        function(derivatives.dNormal_dY[c], false);
+        function(derivatives.normal_fixed[c], false);
+    }
+    function(derivatives.dW_dX, true);
+    function(derivatives.dW_dY, true);
+    function(derivatives.oneOverW_fixed, true);
+}
+
+float maxRelativeDifference(const TriangleDerivatives& a,
+                            const TriangleDerivatives& b) {
+    TriangleDerivatives copy = a;
+    const float* other = reinterpret_cast<const float*>(&b);
+    const float* base = reinterpret_cast<const float*>(&copy);
+    float result = 0.0f;
+    forEachField(copy, [&](float& value, bool) {
+        const float reference = other[&value - base];
+        if (std::isfinite(value) && std::isfinite(reference))
+            result = std::max(result, std::abs(value - reference)
+                                        / std::max(1.0f, std::abs(value)));
+    });
+    return result;
+}
+
+// Round trip through half precision, returns false on overflow
+bool toHalf(float& value) {
+    const bool overflow = std::abs(value) > HalfMax;
+    value = glm::unpackHalf1x16(glm::packHalf1x16(value));
+    return !overflow;
+}
+
+struct Attributes
+{
+    glm::vec2 UV;
+    glm::vec3 normal;
+    float oneOverW;
+};
+
+// Interpolation of 04_dais_shading_pass.frag
+Attributes interpolate(const TriangleDerivatives& derivatives,
+                       glm::vec2 ndcPos) {
+    Attributes result;
+    result.oneOverW = derivatives.oneOverW_fixed + ndcPos.x * derivatives.dW_dX
+                      + ndcPos.y * derivatives.dW_dY;
+    result.UV = (derivatives.UV_fixed + ndcPos.x * derivatives.dUV_dX
+                 + ndcPos.y * derivatives.dUV_dY)
+                / result.oneOverW;
+    result.normal = (derivatives.normal_fixed
+                     + ndcPos.x * derivatives.dNormal_dX
+                     + ndcPos.y * derivatives.dNormal_dY)
+                    / result.oneOverW;
+    return result;
+}
+
+struct ErrorStatistics
+{
+    const char* name;
+    bool quantizeW;
+
+    size_t numSamples = 0;
+    size_t numOverflows = 0; // Records with a field out of half range
+    double maxUVError = 0.0, sumUVError = 0.0;
+    double maxNormalError = 0.0, sumNormalError = 0.0;
+    double maxWError = 0.0, sumWError = 0.0;
+
+    void add(const TriangleDerivatives& reference, glm::vec2 ndcPos,
+             const TriangleDerivatives& quantized) {
+        const Attributes a = interpolate(reference, ndcPos);
+        const Attributes b = interpolate(quantized, ndcPos);
+
+        const double UVError = glm::length(a.UV - b.UV) * TextureSize;
+        const double cosAngle = glm::clamp(
+          glm::dot(glm::normalize(a.normal), glm::normalize(b.normal)), -1.0f,
+          1.0f);
+        const double normalError = glm::degrees(std::acos(cosAngle));
+        const double WError = std::abs(a.oneOverW - b.oneOverW)
+                              / std::abs(a.oneOverW);
+        if (!std::isfinite(UVError) || !std::isfinite(normalError)
+            || !std::isfinite(WError))
+            return;
+
+        numSamples++;
+        maxUVError = std::max(maxUVError, UVError);
+        sumUVError += UVError;
+        maxNormalError = std::max(maxNormalError, normalError);
+        sumNormalError += normalError;
+        maxWError = std::max(maxWError, WError);
+        sumWError += WError;
+    }
+
+    void print() const {
+        const double n = std::max<size_t>(numSamples, 1);
+        printf("%-22s UV [texels] max %10.4f mean %8.4f | normal [deg] max "
+               "%8.4f mean %7.4f | 1/w [rel] max %.2e mean %.2e | "
+               "overflows %zu\n",
+               name, maxUVError, sumUVError / n, maxNormalError,
+               sumNormalError / n, maxWError, sumWError / n, numOverflows);
+    }
+};
+} // namespace
+
+int main(int argc, char** argv) {
+    std::map<std::string, std::string> args;
+    for (int i = 1; i + 1 < argc; i += 2) args[argv[i]] = argv[i + 1];
+    const auto get = [&](const char* key, const char* defaultValue) {
+        const auto it = args.find(key);
+        return it != args.end() ? it->second : std::string(defaultValue);
+    };
+    const auto count = static_cast<size_t>(
+      std::stoull(get("--triangles", "1048576")));
+    const auto seed = static_cast<uint32_t>(std::stoul(get("--seed", "1")));
+    const int repetitions = std::max(1, std::stoi(get("--repetitions", "5")));
+
+    // Projection of the application
+    const glm::mat4 projection = glm::perspective(
+      glm::radians(60.0f), 1200.0f / 900.0f, 0.1f, 1000.0f);
+    const std::vector<Triangle> triangles
+      = createTriangles(count, seed, projection);
+
+    // Performance
+    std::vector<TriangleDerivatives> scalar(count), batch(count);
+    const double scalarTime
+      = measureNanosecondsPerTriangle(count, repetitions, [&] {
+            for (size_t i = 0; i < count; i++)
+                scalar[i] = computeAttributeDerivatives(triangles[i]);
+        });
+    const double batchTime
+      = measureNanosecondsPerTriangle(count, repetitions, [&] {
+            for (size_t i = 0; i < count; i += DerivativesBatchSize)
+                computeAttributeDerivatives8(
+                  &triangles[i], std::min(DerivativesBatchSize, count - i),
+                  &batch[i]);
+        });
+    float maxDifference = 0.0f;
+    for (size_t i = 0; i < count; i++)
+        maxDifference
+          = std::max(maxDifference, maxRelativeDifference(scalar[i], batch[i]));
+
+    // The library is compiled with its own flags, see CMakeLists.txt
+    const char* instructionSet = usesAVX2() ? "AVX2" : "scalar fallback";
+    printf("%zu triangles, best of %d runs\n", count, repetitions);
+    printf("scalar %8.2f ns/triangle\n", scalarTime);
+    printf("batch  %8.2f ns/triangle (%s, %.2fx), max relative difference "
+           "%.2e\n",
+           batchTime, instructionSet, scalarTime / batchTime, maxDifference);
+
+    // Precision of half float storage, sampled inside the visible part of
+    // triangles completely in front of the camera
+    ErrorStatistics errors[] = {{"fp16 all", true},
+                                {"packed (fp32 w)", false}};
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (size_t i = 0; i < count; i++) {
+        const Triangle& triangle = triangles[i];
+        if (triangle.vertices[0].w <= 0.0f || triangle.vertices[1].w <= 0.0f
+            || triangle.vertices[2].w <= 0.0f)
+            continue;
+
+        glm::vec2 ndc[3];
+        for (int v = 0; v < 3; v++)
+            ndc[v] = glm::vec2(triangle.vertices[v]) / triangle.vertices[v].w;
+
+        for (auto& error : errors) {
+            TriangleDerivatives quantized = scalar[i];
+            bool inRange = true;
+            forEachField(quantized, [&](float& value, bool isW) {
+                if (!isW || error.quantizeW) inRange &= toHalf(value);
+            });
+            if (!inRange) error.numOverflows++;
+            // The record of the PackedDerivatives option
+            if (!error.quantizeW) quantized = packDerivatives(scalar[i]);
+
+            std::mt19937 sampleEngine(static_cast<uint32_t>(i));
+            for (int s = 0; s < SamplesPerTriangle; s++) {
+                float b0 = unit(sampleEngine), b1 = unit(sampleEngine);
+                if (b0 + b1 > 1.0f) {
+                    b0 = 1.0f - b0;
+                    b1 = 1.0f - b1;
+                }
+                const glm::vec2 ndcPos
+                  = b0 * ndc[0] + b1 * ndc[1] + (1.0f - b0 - b1) * ndc[2];
+                if (std::abs(ndcPos.x) > 1.0f || std::abs(ndcPos.y) > 1.0f)
+                    continue;
+                error.add(scalar[i], ndcPos, quantized);
+            }
+        }
+    }
+    for (const auto& error : errors) error.print();
+    return 0;
+}
@@ -0,0 +1,23 @@
+//-----------------------------------------------------------------------------
+//  Hash functions and probe sequences of 02_dais_geometry_pass.frag compiled
+//  as C++
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+#ifndef DAISREFERENCE_INCLUDE_CACHE_KERNEL
+#define DAISREFERENCE_INCLUDE_CACHE_KERNEL
+
+#include <glm/integer.hpp>
+
+// The same source as the one included by the shader, see derivative_kernel.h
+namespace DAISReference::Kernel {
+using namespace glm;
+
+#define DAIS_FUNCTION inline
+
+#include "dais_cache.glsl"
+
+#undef DAIS_FUNCTION
+} // namespace DAISReference::Kernel
+
+#endif /* DAISREFERENCE_INCLUDE_CACHE_KERNEL */
@@ -0,0 +1,302 @@
+//-----------------------------------------------------------------------------
+//  CPU reference implementation of Deferred Attribute Interpolation Shading
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+#ifndef DAISREFERENCE_INCLUDE_DAIS_REFERENCE
+#define DAISREFERENCE_INCLUDE_DAIS_REFERENCE
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace DAISReference {
+class ThreadPool;
+
+// Record stored by the geometry pass (02_dais_geometry_pass.frag), std430
+struct Triangle
+{
+    glm::vec4 vertices[3]; // clip-space positions
+    uint32_t normalsSnormOct[3];
+    uint32_t UVsUnorm[3];
+    uint32_t padding[6];
+};
+static_assert(sizeof(Triangle) == 96, "std430 size of Triangle");
+
+// Record of the CompactTriangles option, clip-space z is reconstructed from w
+struct CompactTriangle
+{
+    float positionsXYW[9];
+    uint32_t normalsSnormOct[3];
+    uint32_t UVsUnorm[3];
+};
+static_assert(sizeof(CompactTriangle) == 60, "std430 size of CompactTriangle");
+static_assert(offsetof(CompactTriangle, normalsSnormOct) == 36
+                && offsetof(CompactTriangle, UVsUnorm) == 48,
+              "std430 layout of CompactTriangle");
+
+// Record written by the compute pass (03_dais_compute_pass.comp), std430
+struct TriangleDerivatives
+{
+    glm::vec2 dUV_dX;
+    glm::vec2 dUV_dY;
+    float dW_dX;
+    float dW_dY;
+    float padding0[2];
+    glm::vec3 dNormal_dX;
+    float padding1;
+    glm::vec3 dNormal_dY;
+    float padding2;
+
+    // Attribute values shifted to (0,0) in screenspace
+    glm::vec2 UV_fixed;
+    float padding3[2];
+    glm::vec3 normal_fixed;
+    float oneOverW_fixed;
+};
+static_assert(sizeof(TriangleDerivatives) == 96,
+              "std430 size of TriangleDerivatives");
+
+struct Light
+{
+    glm::vec4 position; // (x, y, z, radius)
+    glm::vec4 color;    // (diffuse.rgb, specular)
+};
+
+struct Texture
+{
+    int width = 0;
+    int height = 0;
+    std::vector<glm::vec4> texels; // RGBA in <0, 1>, first row is v == 0
+
+    // Bilinear filtering with GL_REPEAT wrapping of the base level
+    glm::vec4 sample(glm::vec2 uv) const;
+};
+
+// Same inputs as the ones the GPU implementation reads from its buffers
+struct SceneInput
+{
+    std::vector<glm::vec3> vertices; // Triangle list of one instance
+    std::vector<glm::vec4> instanceOffsets;
+    std::vector<Light> lights;
+    const Texture* albedo = nullptr; // White if not set
+};
+
+// Memoization cache configuration of D.A.I.S., values of dais_cache.glsl
+enum class CacheHash : uint32_t
+{
+    Mask,
+    Multiplicative,
+    Murmur
+};
+enum class CacheProbing : uint32_t
+{
+    None,
+    Linear,
+    Quadratic
+};
+
+struct FrameParameters
+{
+    glm::mat4 modelViewProjection{1.0f};
+    glm::mat4 projection{1.0f};
+    glm::vec3 cameraPosition{0.0f};
+    glm::ivec2 resolution{0};
+    int hashTableSize = 8192; // Has to be a power of two
+    int cacheWays = 2;        // 2, 4 or 8 entries per set
+    CacheHash cacheHash = CacheHash::Mask;
+    CacheProbing cacheProbing = CacheProbing::None;
+    bool packedDerivatives = false; // PackedDerivatives option of D.A.I.S.
+    bool compactTriangles = false;  // CompactTriangles option of D.A.I.S.
+    bool fusedDerivatives = false;  // FusedDerivatives option of D.A.I.S.
+};
+
+//-----------------------------------------------------------------------------
+// Name: Statistics
+// Desc: Counters of a rendered frame. Memory traffic is the number of bytes
+//       the GPU passes read and write, assuming no caching.
+//-----------------------------------------------------------------------------
+struct Statistics
+{
+    size_t submittedTriangles = 0;  // Triangles of all instances
+    size_t rasterizedTriangles = 0; // Passed clipping and covered a pixel
+    size_t coveredPixels = 0;
+    size_t uniqueTriangles = 0; // Triangles referenced by the final image
+
+    size_t cacheLookups = 0;   // One per covered pixel
+    size_t cacheHits = 0;       // ID was found in one of the probed sets
+    size_t cacheCollisions = 0; // Insert found its home set full
+    size_t cacheEvictions = 0;  // Insert dropped a valid entry
+    size_t storedTriangles = 0; // Final value of the triangle write index
+
+    size_t cacheBytes = 0;           // Hash table loads and stores
+    size_t triangleAddressBytes = 0; // Triangle address buffer writes
+    size_t triangleStoreBytes = 0;   // Triangle (fused: derivative) records
+    size_t derivativesBytes = 0; // Compute pass triangle reads and writes
+    size_t shadingBytes = 0; // Triangle address and derivatives reads
+
+    // Durations of the stages [ms]
+    double rasterTime = 0.0;
+    double cacheTime = 0.0;
+    double derivativesTime = 0.0;
+    double shadingTime = 0.0;
+
+    double getCacheHitRate() const {
+        return cacheLookups ? static_cast<double>(cacheHits) / cacheLookups
+                            : 0.0;
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Functions mirroring the shaders, exposed so that the stages can be
+// validated separately
+//-----------------------------------------------------------------------------
+glm::vec2 float32x3ToOct(glm::vec3 v);
+glm::vec3 octToFloat32x3(glm::vec2 e);
+
+//-----------------------------------------------------------------------------
+// Name: MemoizationCache
+// Desc: Set-associative hash table of the geometry pass, sets store (id,
+//       index) pairs in FIFO order. Mirrors lookupMemoizationCache() executed
+//       by a single fragment at a time, so locks never fail and triangles are
+//       never stored redundantly.
+//-----------------------------------------------------------------------------
+class MemoizationCache
+{
+public:
+    // hashTableSize is the number of texels of the cache image, each holding
+    // two entries
+    MemoizationCache(int hashTableSize, int ways, CacheHash hash,
+                     CacheProbing probing);
+
+    void reset();
+
+    // Returns true if the triangle has to be stored at the returned index
+    bool lookup(uint32_t id, int& index);
+
+    size_t getNumLookups() const { return numLookups; }
+    size_t getNumHits() const { return numHits; }
+    size_t getNumCollisions() const { return numCollisions; }
+    size_t getNumEvictions() const { return numEvictions; }
+    uint32_t getWriteIndex() const { return writeIndex; }
+    // Image loads, stores and lock operations of the shader
+    size_t getNumBytes() const;
+
+private:
+    glm::uvec2* getSet(uint32_t set) { return &entries[set * ways]; }
+    bool isFull(uint32_t set);
+    // Index of the id in the probed sets, -1 if not present
+    int find(uint32_t id, uint32_t home);
+
+    std::vector<glm::uvec2> entries;
+    uint32_t ways;
+    uint32_t setMask;
+    CacheHash hash;
+    CacheProbing probing;
+    uint32_t writeIndex = 0;
+
+    size_t numLookups = 0;
+    size_t numHits = 0;
+    size_t numCollisions = 0;
+    size_t numEvictions = 0;
+    size_t numTexelAccesses = 0;
+    size_t numLockAccesses = 0;
+};
+
+TriangleDerivatives computeAttributeDerivatives(const Triangle& triangle);
+
+// Number of triangles processed together by computeAttributeDerivatives8()
+constexpr size_t DerivativesBatchSize = 8;
+
+// Batch version of computeAttributeDerivatives() working on count <= 8
+// triangles, one per SIMD lane (AVX2 if available). Results are the same up
+// to floating point rounding.
+void computeAttributeDerivatives8(const Triangle* triangles, size_t count,
+                                  TriangleDerivatives* result);
+
+// Returns true if the library was built with AVX2 (DAIS_REFERENCE_AVX2), the
+// batch kernel and the rasterizer use the scalar fallback otherwise
+bool usesAVX2();
+
+// Conversions of 02_dais_geometry_pass.frag and 03_dais_compute_pass.comp,
+// the projection has to be a perspective one
+CompactTriangle compactTriangle(const Triangle& triangle);
+Triangle expandTriangle(const CompactTriangle& triangle,
+                        const glm::mat4& projection);
+
+// Round trip through PackedTriangleDerivatives, returns the values read by
+// the shading pass with the PackedDerivatives option
+TriangleDerivatives packDerivatives(const TriangleDerivatives& derivatives);
+
+struct ShadingParameters
+{
+    glm::mat4 MVPMatrixInv;
+    glm::vec3 cameraPosition;
+    float projectionMatrix_32;
+    float projectionMatrix_22;
+};
+
+glm::vec3 shadePixel(const TriangleDerivatives& derivatives,
+                     glm::vec2 ndcPosXY, const ShadingParameters& parameters,
+                     const std::vector<Light>& lights, const Texture* albedo);
+
+//-----------------------------------------------------------------------------
+// Name: Renderer
+// Desc: Renders a frame the same way the GPU passes of
+//       Algorithms::DeferredAttributeInterpolationShading without MSAA do:
+//       rasterization into a triangle ID buffer (tiles are rasterized in
+//       parallel, 8 pixels at a time with AVX2 if available), geometry
+//       sampling through the memoization cache, partial derivatives and
+//       shading. Images are stored bottom-up, the same as glReadPixels.
+//-----------------------------------------------------------------------------
+class Renderer
+{
+public:
+    // numThreads == 0 uses all hardware threads
+    explicit Renderer(unsigned numThreads = 0);
+    ~Renderer();
+
+    const Statistics& render(const SceneInput& scene,
+                             const FrameParameters& frame);
+
+    const Statistics& getStatistics() const { return statistics; }
+    glm::ivec2 getResolution() const { return resolution; }
+
+    // Triangle index of every pixel, -1 if empty
+    const std::vector<int32_t>& getTriangleAddresses() const {
+        return triangleAddresses;
+    }
+    const std::vector<Triangle>& getTriangles() const { return triangles; }
+    const std::vector<TriangleDerivatives>& getDerivatives() const {
+        return derivatives;
+    }
+    const std::vector<glm::vec3>& getColors() const { return colors; }
+
+    // Colors converted to RGBA8 as they are stored in the framebuffer
+    std::vector<unsigned char> getPixels() const;
+
+private:
+    void rasterize(const SceneInput& scene, const FrameParameters& frame);
+    void sampleGeometry(const SceneInput& scene, const FrameParameters& frame);
+    void computeDerivatives(const FrameParameters& frame);
+    void shade(const SceneInput& scene, const FrameParameters& frame);
+
+    std::unique_ptr<ThreadPool> threadPool;
+    Statistics statistics;
+    glm::ivec2 resolution{0};
+
+    std::vector<uint32_t> primitiveIDs; // Output of the rasterizer
+    std::vector<int32_t> triangleAddresses;
+    std::vector<Triangle> triangles;
+    std::vector<TriangleDerivatives> derivatives;
+    std::vector<glm::vec3> colors;
+};
+} // namespace DAISReference
+
+#endif /* DAISREFERENCE_INCLUDE_DAIS_REFERENCE */
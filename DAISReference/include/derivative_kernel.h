@@ -0,0 +1,44 @@
+//-----------------------------------------------------------------------------
+//  Derivative kernel of 03_dais_compute_pass.comp compiled as C++
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+#ifndef DAISREFERENCE_INCLUDE_DERIVATIVE_KERNEL
+#define DAISREFERENCE_INCLUDE_DERIVATIVE_KERNEL
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/mat2x2.hpp>
+#include <glm/mat3x2.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/mat3x4.hpp>
+#include <glm/matrix.hpp>
+#include <glm/packing.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// The same source as the one included by the shader, GLSL types and
+// functions are provided by glm
+namespace DAISReference::Kernel {
+using namespace glm;
+
+#define DAIS_FUNCTION inline
+#define DAIS_IN(type) const type&
+#define DAIS_INOUT(type) type&
+#define DAIS_OUT(type) type&
+#define DAIS_IN_ARRAY3(type, name) const type(&name)[3]
+
+#include "dais_derivatives.glsl"
+
+#undef DAIS_FUNCTION
+#undef DAIS_IN
+#undef DAIS_INOUT
+#undef DAIS_OUT
+#undef DAIS_IN_ARRAY3
+
+static_assert(sizeof(PackedTriangleDerivatives) == 48,
+              "std430 size of PackedTriangleDerivatives");
+} // namespace DAISReference::Kernel
+
+#endif /* DAISREFERENCE_INCLUDE_DERIVATIVE_KERNEL */
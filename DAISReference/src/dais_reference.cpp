@@ -0,0 +1,581 @@
+#include "dais_reference.h"
+#include "cache_kernel.h"
+#include "derivative_kernel.h"
+#include "rasterizer.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+#include <glm/packing.hpp>
+
+namespace DAISReference {
+namespace {
+// Number of items processed by one parallel loop iteration
+constexpr size_t ChunkSize = 4096;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+glm::vec2 signNotZero(glm::vec2 v) {
+    return glm::vec2((v.x >= 0.0f) ? +1.0f : -1.0f,
+                     (v.y >= 0.0f) ? +1.0f : -1.0f);
+}
+
+// Vertex and geometry shader of the geometry pass, primitiveID is
+// gl_PrimitiveIDIn + gl_InstanceID * trianglesPerSphere
+Triangle assembleTriangle(const SceneInput& scene, const glm::mat4& MVPMatrix,
+                          uint32_t primitiveID) {
+    const auto trianglesPerInstance
+      = static_cast<uint32_t>(scene.vertices.size() / 3);
+    const glm::vec4& offset
+      = scene.instanceOffsets[primitiveID / trianglesPerInstance];
+    const size_t firstVertex
+      = static_cast<size_t>(primitiveID % trianglesPerInstance) * 3;
+
+    Triangle triangle{};
+    for (size_t i = 0; i < 3; i++) {
+        const glm::vec3& vertex = scene.vertices[firstVertex + i];
+        triangle.vertices[i]
+          = MVPMatrix * glm::vec4(vertex + glm::vec3(offset), 1.0f);
+        triangle.normalsSnormOct[i]
+          = glm::packSnorm2x16(float32x3ToOct(vertex));
+        triangle.UVsUnorm[i] = glm::packSnorm2x16(glm::vec2(vertex));
+    }
+    return triangle;
+}
+
+// Adds the std430 padding
+TriangleDerivatives toStorage(const Kernel::TriangleDerivatives& derivatives) {
+    TriangleDerivatives result{};
+    result.dUV_dX = derivatives.dUV_dX;
+    result.dUV_dY = derivatives.dUV_dY;
+    result.dW_dX = derivatives.dW_dX;
+    result.dW_dY = derivatives.dW_dY;
+    result.dNormal_dX = derivatives.dNormal_dX;
+    result.dNormal_dY = derivatives.dNormal_dY;
+    result.UV_fixed = derivatives.UV_fixed;
+    result.normal_fixed = derivatives.normal_fixed;
+    result.oneOverW_fixed = derivatives.oneOverW_fixed;
+    return result;
+}
+
+// Sizes of the records in the buffers of the GPU implementation
+size_t getTriangleRecordSize(const FrameParameters& frame) {
+    return frame.compactTriangles ? sizeof(CompactTriangle) : sizeof(Triangle);
+}
+
+size_t getDerivativesRecordSize(const FrameParameters& frame) {
+    return frame.packedDerivatives ? sizeof(Kernel::PackedTriangleDerivatives)
+                                   : sizeof(TriangleDerivatives);
+}
+
+Kernel::TriangleDerivatives
+fromStorage(const TriangleDerivatives& derivatives) {
+    Kernel::TriangleDerivatives result;
+    result.dUV_dX = derivatives.dUV_dX;
+    result.dUV_dY = derivatives.dUV_dY;
+    result.dW_dX = derivatives.dW_dX;
+    result.dW_dY = derivatives.dW_dY;
+    result.dNormal_dX = derivatives.dNormal_dX;
+    result.dNormal_dY = derivatives.dNormal_dY;
+    result.UV_fixed = derivatives.UV_fixed;
+    result.normal_fixed = derivatives.normal_fixed;
+    result.oneOverW_fixed = derivatives.oneOverW_fixed;
+    return result;
+}
+
+// Simple phong lighting
+glm::vec3 calculateLightContribution(const Light& light,
+                                     const glm::vec3& vertex,
+                                     const glm::vec3& normal,
+                                     const glm::vec4& diffSpecColor,
+                                     const glm::vec3& cameraPosition) {
+    const glm::vec4& lightPos = light.position;
+
+    // Check if point is out of the light's range
+    glm::vec3 lightDir = glm::vec3(lightPos) - vertex;
+    const float distance = glm::length(lightDir);
+    if (distance > lightPos.w) return glm::vec3(0.0f);
+
+    const glm::vec4& color = light.color;
+    const float attenuation = 1.0f - distance / lightPos.w;
+
+    // Diffuse color component
+    lightDir = glm::normalize(lightDir);
+    const float NdotL = std::max(glm::dot(normal, lightDir), 0.0f);
+    glm::vec3 lightContribution
+      = glm::vec3(color) * glm::vec3(diffSpecColor) * NdotL;
+
+    // Specular color component
+    const glm::vec3 viewDir = glm::normalize(cameraPosition - vertex);
+    const glm::vec3 halfwayDir = glm::normalize(lightDir + viewDir);
+    const float NdotH
+      = std::pow(std::max(glm::dot(normal, halfwayDir), 0.0f), 5.0f);
+    lightContribution += glm::vec3(color.a) * diffSpecColor.a * NdotH * NdotL;
+
+    return lightContribution * attenuation;
+}
+} // namespace
+
+//-----------------------------------------------------------------------------
+// Name: float32x3ToOct(), octToFloat32x3()
+// Desc: Octahedral normal encoding of the geometry and compute passes
+//-----------------------------------------------------------------------------
+glm::vec2 float32x3ToOct(glm::vec3 v) {
+    // Project the sphere onto the octahedron, and then onto the xy plane
+    const glm::vec2 p
+      = glm::vec2(v) * (1.0f / (std::abs(v.x) + std::abs(v.y) + std::abs(v.z)));
+    // Reflect the folds of the lower hemisphere over the diagonals
+    return (v.z <= 0.0f)
+             ? ((1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p))
+             : p;
+}
+
+glm::vec3 octToFloat32x3(glm::vec2 e) {
+    glm::vec3 v = glm::vec3(e, 1.0f - std::abs(e.x) - std::abs(e.y));
+    if (v.z < 0.0f) {
+        const glm::vec2 xy = (1.0f - glm::abs(glm::vec2(v.y, v.x)))
+                             * signNotZero(glm::vec2(v));
+        v.x = xy.x;
+        v.y = xy.y;
+    }
+    return glm::normalize(v);
+}
+
+//-----------------------------------------------------------------------------
+// Name: MemoizationCache
+// Desc: lookupMemoizationCache() of 02_dais_geometry_pass.frag
+//-----------------------------------------------------------------------------
+static_assert(static_cast<uint32_t>(CacheHash::Multiplicative)
+                == Kernel::DAIS_CACHE_HASH_MULTIPLICATIVE
+              && static_cast<uint32_t>(CacheHash::Murmur)
+                   == Kernel::DAIS_CACHE_HASH_MURMUR);
+static_assert(static_cast<uint32_t>(CacheProbing::Linear)
+                == Kernel::DAIS_CACHE_PROBING_LINEAR
+              && static_cast<uint32_t>(CacheProbing::Quadratic)
+                   == Kernel::DAIS_CACHE_PROBING_QUADRATIC);
+
+MemoizationCache::MemoizationCache(int hashTableSize, int ways,
+                                   CacheHash hash, CacheProbing probing)
+  : entries(static_cast<size_t>(hashTableSize) * 2),
+    ways(static_cast<uint32_t>(ways)),
+    setMask(static_cast<uint32_t>(hashTableSize * 2 / ways - 1)), hash(hash),
+    probing(probing) {
+    reset();
+}
+
+void MemoizationCache::reset() {
+    std::fill(entries.begin(), entries.end(),
+              glm::uvec2(Kernel::DAIS_CACHE_EMPTY));
+    writeIndex = 0;
+    numLookups = 0;
+    numHits = 0;
+    numCollisions = 0;
+    numEvictions = 0;
+    numTexelAccesses = 0;
+    numLockAccesses = 0;
+}
+
+size_t MemoizationCache::getNumBytes() const {
+    return numTexelAccesses * sizeof(glm::uvec4)
+           + numLockAccesses * sizeof(uint32_t);
+}
+
+bool MemoizationCache::isFull(uint32_t set) {
+    numTexelAccesses++;
+    return getSet(set)[ways - 1].x != Kernel::DAIS_CACHE_EMPTY;
+}
+
+int MemoizationCache::find(uint32_t id, uint32_t home) {
+    const uint32_t numProbes
+      = Kernel::getNumCacheProbes(static_cast<uint32_t>(probing));
+    for (uint32_t p = 0; p < numProbes; p++) {
+        const glm::uvec2* set = getSet(Kernel::probeCacheSet(
+          home, p, static_cast<uint32_t>(probing), setMask));
+        // Texels of two entries are loaded until the id or an empty entry
+        // is found
+        for (uint32_t way = 0; way < ways; way++) {
+            if (way % 2 == 0) numTexelAccesses++;
+            if (set[way].x == id) return static_cast<int>(set[way].y);
+            if (set[way].x == Kernel::DAIS_CACHE_EMPTY) break;
+        }
+    }
+    return -1;
+}
+
+bool MemoizationCache::lookup(uint32_t id, int& index) {
+    numLookups++;
+    const uint32_t home
+      = Kernel::hashTriangleID(id, static_cast<uint32_t>(hash), setMask);
+    index = find(id, home);
+    if (index >= 0) {
+        numHits++;
+        return false;
+    }
+
+    // Lock of the home set, the shader repeats the search
+    numLockAccesses += 2;
+    find(id, home);
+
+    // Allocate new storage, insert into the first probed set with an empty
+    // entry, the home set FIFO otherwise
+    index = static_cast<int>(writeIndex++);
+    uint32_t target = home;
+    if (isFull(home)) {
+        numCollisions++;
+        const uint32_t numProbes
+          = Kernel::getNumCacheProbes(static_cast<uint32_t>(probing));
+        for (uint32_t p = 1; target == home && p < numProbes; p++) {
+            const uint32_t probed = Kernel::probeCacheSet(
+              home, p, static_cast<uint32_t>(probing), setMask);
+            numLockAccesses += 2;
+            if (!isFull(probed)) target = probed;
+        }
+    }
+    glm::uvec2* set = getSet(target);
+    if (set[ways - 1].x != Kernel::DAIS_CACHE_EMPTY) numEvictions++;
+    // Texels are loaded and stored until the shifted entry is empty
+    uint32_t shifted = 0;
+    while (shifted < ways && set[shifted].x != Kernel::DAIS_CACHE_EMPTY)
+        shifted++;
+    numTexelAccesses += 2 * std::min(shifted / 2 + 1, ways / 2);
+    std::copy_backward(set, set + ways - 1, set + ways);
+    set[0] = glm::uvec2(id, static_cast<uint32_t>(index));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: computeAttributeDerivatives()
+// Desc: 03_dais_compute_pass.comp, the math is shared with the shader
+//-----------------------------------------------------------------------------
+TriangleDerivatives computeAttributeDerivatives(const Triangle& triangle) {
+    glm::vec2 UVs[3];
+    glm::vec3 normals[3];
+    for (int i = 0; i < 3; i++) {
+        UVs[i] = glm::unpackSnorm2x16(triangle.UVsUnorm[i]);
+        normals[i] = octToFloat32x3(
+          glm::unpackSnorm2x16(triangle.normalsSnormOct[i]));
+    }
+
+    Kernel::TriangleDerivatives kernelDerivatives;
+    Kernel::computeAttributeDerivatives(triangle.vertices, UVs, normals,
+                                        kernelDerivatives);
+    return toStorage(kernelDerivatives);
+}
+
+CompactTriangle compactTriangle(const Triangle& triangle) {
+    CompactTriangle result;
+    for (int i = 0; i < 3; i++) {
+        result.positionsXYW[i * 3] = triangle.vertices[i].x;
+        result.positionsXYW[i * 3 + 1] = triangle.vertices[i].y;
+        result.positionsXYW[i * 3 + 2] = triangle.vertices[i].w;
+        result.normalsSnormOct[i] = triangle.normalsSnormOct[i];
+        result.UVsUnorm[i] = triangle.UVsUnorm[i];
+    }
+    return result;
+}
+
+Triangle expandTriangle(const CompactTriangle& triangle,
+                        const glm::mat4& projection) {
+    Triangle result{};
+    for (int i = 0; i < 3; i++) {
+        const float w = triangle.positionsXYW[i * 3 + 2];
+        result.vertices[i] = glm::vec4(triangle.positionsXYW[i * 3],
+                                       triangle.positionsXYW[i * 3 + 1],
+                                       projection[3][2] - projection[2][2] * w,
+                                       w);
+        result.normalsSnormOct[i] = triangle.normalsSnormOct[i];
+        result.UVsUnorm[i] = triangle.UVsUnorm[i];
+    }
+    return result;
+}
+
+TriangleDerivatives packDerivatives(const TriangleDerivatives& derivatives) {
+    Kernel::PackedTriangleDerivatives packed;
+    Kernel::TriangleDerivatives result;
+    Kernel::packTriangleDerivatives(fromStorage(derivatives), packed);
+    Kernel::unpackTriangleDerivatives(packed, result);
+    return toStorage(result);
+}
+
+//-----------------------------------------------------------------------------
+// Name: shadePixel()
+// Desc: 04_dais_shading_pass.frag
+//-----------------------------------------------------------------------------
+glm::vec3 shadePixel(const TriangleDerivatives& derivatives,
+                     glm::vec2 ndcPosXY, const ShadingParameters& parameters,
+                     const std::vector<Light>& lights, const Texture* albedo) {
+    glm::vec4 ndcPos = glm::vec4(ndcPosXY, 0.0f, 1.0f);
+
+    const float oneOverW = derivatives.oneOverW_fixed
+                           + ndcPos.x * derivatives.dW_dX
+                           + ndcPos.y * derivatives.dW_dY;
+
+    ndcPos.z = parameters.projectionMatrix_32 * oneOverW
+               - parameters.projectionMatrix_22;
+
+    const glm::vec4 clipPos = ndcPos / oneOverW;
+    const glm::vec4 worldPos = parameters.MVPMatrixInv * clipPos;
+
+    const glm::vec3 normal = (derivatives.normal_fixed
+                              + ndcPos.x * derivatives.dNormal_dX
+                              + ndcPos.y * derivatives.dNormal_dY)
+                             / oneOverW;
+
+    const glm::vec2 uv = (derivatives.UV_fixed + ndcPos.x * derivatives.dUV_dX
+                          + ndcPos.y * derivatives.dUV_dY)
+                         / oneOverW;
+
+    const glm::vec4 diffSpecColor
+      = albedo ? albedo->sample(uv) : glm::vec4(1.0f);
+    glm::vec3 result(0.0f);
+    for (const Light& light : lights) {
+        result += calculateLightContribution(light, glm::vec3(worldPos),
+                                             normal, diffSpecColor,
+                                             parameters.cameraPosition);
+    }
+    return result;
+}
+
+glm::vec4 Texture::sample(glm::vec2 uv) const {
+    if (texels.empty()) return glm::vec4(1.0f);
+
+    const auto wrap = [](int coordinate, int size) {
+        const int wrapped = coordinate % size;
+        return wrapped < 0 ? wrapped + size : wrapped;
+    };
+    const float x = uv.x * static_cast<float>(width) - 0.5f;
+    const float y = uv.y * static_cast<float>(height) - 0.5f;
+    const float x0 = std::floor(x);
+    const float y0 = std::floor(y);
+    const float fx = x - x0;
+    const float fy = y - y0;
+    const int left = wrap(static_cast<int>(x0), width);
+    const int right = wrap(static_cast<int>(x0) + 1, width);
+    const int bottom = wrap(static_cast<int>(y0), height);
+    const int top = wrap(static_cast<int>(y0) + 1, height);
+
+    const auto texel = [&](int column, int row) {
+        return texels[static_cast<size_t>(row) * width + column];
+    };
+    return glm::mix(glm::mix(texel(left, bottom), texel(right, bottom), fx),
+                    glm::mix(texel(left, top), texel(right, top), fx), fy);
+}
+
+//-----------------------------------------------------------------------------
+// Name: Renderer
+// Desc:
+//-----------------------------------------------------------------------------
+Renderer::Renderer(unsigned numThreads)
+  : threadPool(std::make_unique<ThreadPool>(numThreads)) {}
+
+Renderer::~Renderer() = default;
+
+const Statistics& Renderer::render(const SceneInput& scene,
+                                   const FrameParameters& frame) {
+    statistics = Statistics{};
+    resolution = frame.resolution;
+
+    auto start = std::chrono::steady_clock::now();
+    rasterize(scene, frame);
+    statistics.rasterTime = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    sampleGeometry(scene, frame);
+    statistics.cacheTime = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    computeDerivatives(frame);
+    statistics.derivativesTime = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    shade(scene, frame);
+    statistics.shadingTime = millisecondsSince(start);
+    return statistics;
+}
+
+void Renderer::rasterize(const SceneInput& scene,
+                         const FrameParameters& frame) {
+    const size_t numTriangles
+      = scene.vertices.size() / 3 * scene.instanceOffsets.size();
+    statistics.submittedTriangles = numTriangles;
+
+    // Triangle setup, chunks keep the submission order
+    const size_t numChunks = (numTriangles + ChunkSize - 1) / ChunkSize;
+    std::vector<std::vector<RasterTriangle>> chunks(numChunks);
+    threadPool->parallelFor(numChunks, [&](size_t chunk, unsigned) {
+        const size_t end = std::min((chunk + 1) * ChunkSize, numTriangles);
+        RasterTriangle setup[3];
+        for (size_t id = chunk * ChunkSize; id < end; id++) {
+            const auto primitiveID = static_cast<uint32_t>(id);
+            const Triangle triangle = assembleTriangle(
+              scene, frame.modelViewProjection, primitiveID);
+            const int count = setupTriangle(triangle.vertices, primitiveID,
+                                            frame.resolution, setup);
+            chunks[chunk].insert(chunks[chunk].end(), setup, setup + count);
+        }
+    });
+
+    std::vector<RasterTriangle> rasterTriangles;
+    for (auto& chunk : chunks) {
+        rasterTriangles.insert(rasterTriangles.end(), chunk.begin(),
+                               chunk.end());
+        std::vector<RasterTriangle>().swap(chunk);
+    }
+
+    // Binning
+    constexpr int TileSize = TileBuffer::TileSize;
+    const glm::ivec2 numTiles = (frame.resolution + (TileSize - 1)) / TileSize;
+    std::vector<std::vector<uint32_t>> bins(
+      static_cast<size_t>(numTiles.x) * numTiles.y);
+    for (size_t i = 0; i < rasterTriangles.size(); i++) {
+        const RasterTriangle& triangle = rasterTriangles[i];
+        for (int y = triangle.min.y / TileSize; y <= triangle.max.y / TileSize;
+             y++)
+            for (int x = triangle.min.x / TileSize;
+                 x <= triangle.max.x / TileSize; x++)
+                bins[static_cast<size_t>(y) * numTiles.x + x].push_back(
+                  static_cast<uint32_t>(i));
+    }
+
+    // Tiles are independent
+    primitiveIDs.assign(static_cast<size_t>(frame.resolution.x)
+                          * frame.resolution.y,
+                        EmptyPrimitive);
+    std::vector<TileBuffer> tileBuffers(threadPool->getNumThreads());
+    threadPool->parallelFor(bins.size(), [&](size_t bin, unsigned thread) {
+        if (bins[bin].empty()) return;
+        const glm::ivec2 origin
+          = glm::ivec2(bin % numTiles.x, bin / numTiles.x) * TileSize;
+        TileBuffer& tile = tileBuffers[thread];
+        tile.clear();
+        rasterizeTile(rasterTriangles, bins[bin], origin, tile);
+
+        const glm::ivec2 end = glm::min(origin + TileSize, frame.resolution);
+        for (int y = origin.y; y < end.y; y++) {
+            const uint32_t* row
+              = &tile.primitiveIDs[(y - origin.y) * TileSize];
+            std::copy(row, row + (end.x - origin.x),
+                      &primitiveIDs[static_cast<size_t>(y) * frame.resolution.x
+                                    + origin.x]);
+        }
+    });
+    statistics.rasterizedTriangles = rasterTriangles.size();
+}
+
+void Renderer::sampleGeometry(const SceneInput& scene,
+                              const FrameParameters& frame) {
+    // The GPU processes fragments in an unspecified order, the reference uses
+    // scanline order so that the results are deterministic
+    MemoizationCache cache(frame.hashTableSize, frame.cacheWays,
+                           frame.cacheHash, frame.cacheProbing);
+    triangles.clear();
+    triangleAddresses.assign(primitiveIDs.size(), -1);
+    for (size_t pixel = 0; pixel < primitiveIDs.size(); pixel++) {
+        const uint32_t id = primitiveIDs[pixel];
+        if (id == EmptyPrimitive) continue;
+
+        int index = 0;
+        // Indices are allocated sequentially
+        if (cache.lookup(id, index)) {
+            const Triangle triangle
+              = assembleTriangle(scene, frame.modelViewProjection, id);
+            triangles.push_back(
+              frame.compactTriangles
+                ? expandTriangle(compactTriangle(triangle), frame.projection)
+                : triangle);
+        }
+        triangleAddresses[pixel] = index;
+    }
+
+    statistics.coveredPixels = cache.getNumLookups();
+    statistics.cacheLookups = cache.getNumLookups();
+    statistics.cacheHits = cache.getNumHits();
+    statistics.cacheCollisions = cache.getNumCollisions();
+    statistics.cacheEvictions = cache.getNumEvictions();
+    statistics.storedTriangles = cache.getWriteIndex();
+    statistics.cacheBytes = cache.getNumBytes();
+    statistics.triangleAddressBytes = cache.getNumLookups() * sizeof(int32_t);
+    // Fused derivatives are stored instead of the triangle
+    statistics.triangleStoreBytes
+      = triangles.size()
+        * (frame.fusedDerivatives ? getDerivativesRecordSize(frame)
+                                  : getTriangleRecordSize(frame));
+
+    // Triangles evicted from the cache and stored again are counted once
+    std::vector<uint32_t> ids;
+    ids.reserve(statistics.coveredPixels);
+    for (const uint32_t id : primitiveIDs)
+        if (id != EmptyPrimitive) ids.push_back(id);
+    std::sort(ids.begin(), ids.end());
+    statistics.uniqueTriangles = static_cast<size_t>(
+      std::unique(ids.begin(), ids.end()) - ids.begin());
+}
+
+void Renderer::computeDerivatives(const FrameParameters& frame) {
+    derivatives.resize(triangles.size());
+    const size_t numChunks = (triangles.size() + ChunkSize - 1) / ChunkSize;
+    threadPool->parallelFor(numChunks, [&](size_t chunk, unsigned) {
+        const size_t end = std::min((chunk + 1) * ChunkSize, triangles.size());
+        for (size_t i = chunk * ChunkSize; i < end; i += DerivativesBatchSize)
+            computeAttributeDerivatives8(
+              &triangles[i], std::min(DerivativesBatchSize, end - i),
+              &derivatives[i]);
+        if (frame.packedDerivatives) {
+            for (size_t i = chunk * ChunkSize; i < end; i++)
+                derivatives[i] = packDerivatives(derivatives[i]);
+        }
+    });
+    statistics.derivativesBytes
+      = frame.fusedDerivatives ? 0
+                               : triangles.size()
+                                   * (getTriangleRecordSize(frame)
+                                      + getDerivativesRecordSize(frame));
+}
+
+void Renderer::shade(const SceneInput& scene, const FrameParameters& frame) {
+    const ShadingParameters parameters{
+      glm::inverse(frame.modelViewProjection), frame.cameraPosition,
+      frame.projection[3][2], frame.projection[2][2]};
+    const glm::vec2 viewportSize = glm::vec2(frame.resolution);
+
+    colors.assign(triangleAddresses.size(), glm::vec3(0.0f));
+    threadPool->parallelFor(
+      static_cast<size_t>(frame.resolution.y), [&](size_t y, unsigned) {
+          for (int x = 0; x < frame.resolution.x; x++) {
+              const size_t pixel = y * frame.resolution.x + x;
+              const int32_t index = triangleAddresses[pixel];
+              if (index < 0) continue; // discard
+
+              const glm::vec2 fragCoord(static_cast<float>(x) + 0.5f,
+                                        static_cast<float>(y) + 0.5f);
+              const glm::vec2 ndcPosXY = fragCoord / viewportSize * 2.0f - 1.0f;
+              colors[pixel] = shadePixel(derivatives[index], ndcPosXY,
+                                         parameters, scene.lights,
+                                         scene.albedo);
+          }
+      });
+    statistics.shadingBytes
+      = triangleAddresses.size() * sizeof(int32_t)
+        + statistics.coveredPixels * getDerivativesRecordSize(frame);
+}
+
+std::vector<unsigned char> Renderer::getPixels() const {
+    std::vector<unsigned char> pixels(colors.size() * 4, 255);
+    for (size_t i = 0; i < colors.size(); i++) {
+        for (int channel = 0; channel < 3; channel++) {
+            const float value = std::clamp(colors[i][channel], 0.0f, 1.0f);
+            pixels[i * 4 + channel]
+              = static_cast<unsigned char>(std::round(value * 255.0f));
+        }
+    }
+    return pixels;
+}
+} // namespace DAISReference
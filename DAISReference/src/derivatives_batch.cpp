@@ -0,0 +1,314 @@
+#include "dais_reference.h"
+
+#include <algorithm>
+
+#include <glm/packing.hpp>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace DAISReference {
+namespace {
+constexpr int Lanes = static_cast<int>(DerivativesBatchSize);
+
+//-----------------------------------------------------------------------------
+// Name: Float8
+// Desc: One float per triangle of the batch. Comparisons return masks that
+//       are consumed by select().
+//-----------------------------------------------------------------------------
+#ifdef __AVX2__
+struct Float8
+{
+    __m256 v;
+
+    Float8() = default;
+    Float8(float value) : v(_mm256_set1_ps(value)) {}
+    explicit Float8(__m256 value) : v(value) {}
+
+    static Float8 load(const float (&values)[Lanes]) {
+        return Float8(_mm256_loadu_ps(values));
+    }
+    void store(float (&values)[Lanes]) const { _mm256_storeu_ps(values, v); }
+};
+
+inline Float8 operator+(Float8 a, Float8 b) {
+    return Float8(_mm256_add_ps(a.v, b.v));
+}
+inline Float8 operator-(Float8 a, Float8 b) {
+    return Float8(_mm256_sub_ps(a.v, b.v));
+}
+inline Float8 operator*(Float8 a, Float8 b) {
+    return Float8(_mm256_mul_ps(a.v, b.v));
+}
+inline Float8 operator/(Float8 a, Float8 b) {
+    return Float8(_mm256_div_ps(a.v, b.v));
+}
+inline Float8 operator-(Float8 a) {
+    return Float8(_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)));
+}
+inline Float8 operator<(Float8 a, Float8 b) {
+    return Float8(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ));
+}
+inline Float8 operator>(Float8 a, Float8 b) {
+    return Float8(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ));
+}
+inline Float8 operator&(Float8 a, Float8 b) {
+    return Float8(_mm256_and_ps(a.v, b.v));
+}
+inline Float8 operator|(Float8 a, Float8 b) {
+    return Float8(_mm256_or_ps(a.v, b.v));
+}
+inline Float8 andNot(Float8 mask, Float8 a) {
+    return Float8(_mm256_andnot_ps(mask.v, a.v));
+}
+inline bool any(Float8 mask) { return _mm256_movemask_ps(mask.v) != 0; }
+inline Float8 select(Float8 mask, Float8 ifTrue, Float8 ifFalse) {
+    return Float8(_mm256_blendv_ps(ifFalse.v, ifTrue.v, mask.v));
+}
+inline Float8 allLanes() {
+    return Float8(_mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+}
+#else
+struct Float8
+{
+    // Masks store 1.0f in selected lanes
+    float v[Lanes];
+
+    Float8() = default;
+    Float8(float value) { std::fill(std::begin(v), std::end(v), value); }
+
+    static Float8 load(const float (&values)[Lanes]) {
+        Float8 result;
+        std::copy(std::begin(values), std::end(values), result.v);
+        return result;
+    }
+    void store(float (&values)[Lanes]) const {
+        std::copy(std::begin(v), std::end(v), values);
+    }
+};
+
+template<typename Op>
+inline Float8 perLane(Float8 a, Float8 b, Op&& op) {
+    Float8 result;
+    for (int i = 0; i < Lanes; i++) result.v[i] = op(a.v[i], b.v[i]);
+    return result;
+}
+
+inline Float8 operator+(Float8 a, Float8 b) {
+    return perLane(a, b, [](float x, float y) { return x + y; });
+}
+inline Float8 operator-(Float8 a, Float8 b) {
+    return perLane(a, b, [](float x, float y) { return x - y; });
+}
+inline Float8 operator*(Float8 a, Float8 b) {
+    return perLane(a, b, [](float x, float y) { return x * y; });
+}
+inline Float8 operator/(Float8 a, Float8 b) {
+    return perLane(a, b, [](float x, float y) { return x / y; });
+}
+inline Float8 operator-(Float8 a) { return Float8(0.0f) - a; }
+inline Float8 operator<(Float8 a, Float8 b) {
+    return perLane(a, b, [](float x, float y) { return x < y ? 1.0f : 0.0f; });
+}
+inline Float8 operator>(Float8 a, Float8 b) {
+    return perLane(a, b, [](float x, float y) { return x > y ? 1.0f : 0.0f; });
+}
+inline Float8 operator&(Float8 a, Float8 b) {
+    return perLane(a, b, [](float x, float y) { return x * y; });
+}
+inline Float8 operator|(Float8 a, Float8 b) {
+    return perLane(a, b, [](float x, float y) { return std::max(x, y); });
+}
+inline Float8 andNot(Float8 mask, Float8 a) {
+    return perLane(mask, a, [](float m, float x) { return (1.0f - m) * x; });
+}
+inline bool any(Float8 mask) {
+    return std::any_of(std::begin(mask.v), std::end(mask.v),
+                       [](float m) { return m != 0.0f; });
+}
+inline Float8 select(Float8 mask, Float8 ifTrue, Float8 ifFalse) {
+    Float8 result;
+    for (int i = 0; i < Lanes; i++)
+        result.v[i] = mask.v[i] != 0.0f ? ifTrue.v[i] : ifFalse.v[i];
+    return result;
+}
+inline Float8 allLanes() { return Float8(1.0f); }
+#endif
+
+// Same as mix() of GLSL: x * (1 - a) + y * a
+inline Float8 mix(Float8 x, Float8 y, Float8 a) {
+    return x * (Float8(1.0f) - a) + y * a;
+}
+
+// Attributes of the three vertices, [vertex][component]
+struct TriangleBatch
+{
+    Float8 pos[3][4];
+    Float8 UVs[3][2];
+    Float8 normals[3][3];
+};
+
+// Vectorized shrinkTriangle() of dais_derivatives.glsl. The cases of the
+// switch are applied as masked vertex pushes in the same order.
+void shrinkTriangles(TriangleBatch& batch, const int axis, const bool isMin) {
+    Float8 outside[3];
+    for (int i = 0; i < 3; i++) {
+        outside[i] = isMin ? batch.pos[i][axis] < -batch.pos[i][3]
+                           : batch.pos[i][axis] > batch.pos[i][3];
+    }
+    if (!any(outside[0] | outside[1] | outside[2])) return;
+
+    // Lanes where exactly the given vertices are outside
+    const auto clipMask = [&](bool v0, bool v1, bool v2) {
+        const bool isOutside[3] = {v0, v1, v2};
+        Float8 mask = allLanes();
+        for (int i = 0; i < 3; i++)
+            mask = isOutside[i] ? mask & outside[i] : andNot(outside[i], mask);
+        return mask;
+    };
+    const Float8 v0 = clipMask(true, false, false);
+    const Float8 v1 = clipMask(false, true, false);
+    const Float8 v2 = clipMask(false, false, true);
+    const Float8 v0v1 = clipMask(true, true, false);
+    const Float8 v1v2 = clipMask(false, true, true);
+    const Float8 v2v0 = clipMask(true, false, true);
+
+    // Push the vertex on edge from->to in lanes of the mask
+    const auto pushVertex = [&](int from, int to, Float8 mask) {
+        if (!any(mask)) return;
+        const Float8 toAxis = batch.pos[to][axis];
+        const Float8 fromAxis = batch.pos[from][axis];
+        const Float8 b1 = isMin ? toAxis : -toAxis;
+        const Float8 b2 = isMin ? fromAxis : -fromAxis;
+        const Float8 a = (batch.pos[to][3] + b1)
+                         / (batch.pos[to][3] - batch.pos[from][3] + b1 - b2);
+        const auto push = [&](Float8& fromValue, Float8 toValue) {
+            fromValue = select(mask, mix(toValue, fromValue, a), fromValue);
+        };
+        for (int c = 0; c < 4; c++) push(batch.pos[from][c], batch.pos[to][c]);
+        for (int c = 0; c < 2; c++) push(batch.UVs[from][c], batch.UVs[to][c]);
+        for (int c = 0; c < 3; c++)
+            push(batch.normals[from][c], batch.normals[to][c]);
+    };
+
+    pushVertex(2, 1, v2v0);
+    pushVertex(0, 1, v0 | v2v0);
+    pushVertex(0, 2, v0v1);
+    pushVertex(1, 2, v1 | v0v1);
+    pushVertex(1, 0, v1v2);
+    pushVertex(2, 0, v2 | v1v2);
+}
+} // namespace
+
+void computeAttributeDerivatives8(const Triangle* triangles, size_t count,
+                                  TriangleDerivatives* result) {
+    if (count == 0) return;
+
+    // Transpose to structure of arrays, unused lanes repeat the last triangle
+    float pos[3][4][Lanes], UVs[3][2][Lanes], normals[3][3][Lanes];
+    for (int lane = 0; lane < Lanes; lane++) {
+        const Triangle& triangle
+          = triangles[std::min(static_cast<size_t>(lane), count - 1)];
+        for (int i = 0; i < 3; i++) {
+            const glm::vec2 UV = glm::unpackSnorm2x16(triangle.UVsUnorm[i]);
+            const glm::vec3 normal = octToFloat32x3(
+              glm::unpackSnorm2x16(triangle.normalsSnormOct[i]));
+            for (int c = 0; c < 4; c++)
+                pos[i][c][lane] = triangle.vertices[i][c];
+            for (int c = 0; c < 2; c++) UVs[i][c][lane] = UV[c];
+            for (int c = 0; c < 3; c++) normals[i][c][lane] = normal[c];
+        }
+    }
+    TriangleBatch batch;
+    for (int i = 0; i < 3; i++) {
+        for (int c = 0; c < 4; c++) batch.pos[i][c] = Float8::load(pos[i][c]);
+        for (int c = 0; c < 2; c++) batch.UVs[i][c] = Float8::load(UVs[i][c]);
+        for (int c = 0; c < 3; c++)
+            batch.normals[i][c] = Float8::load(normals[i][c]);
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        shrinkTriangles(batch, axis, true);
+        shrinkTriangles(batch, axis, false);
+    }
+
+    Float8 oneOverW[3], posScreen[3][2];
+    for (int i = 0; i < 3; i++) {
+        oneOverW[i] = Float8(1.0f) / batch.pos[i][3];
+        for (int c = 0; c < 2; c++) {
+            posScreen[i][c] = batch.pos[i][c] * oneOverW[i];
+            batch.UVs[i][c] = batch.UVs[i][c] * oneOverW[i];
+        }
+        for (int c = 0; c < 3; c++)
+            batch.normals[i][c] = batch.normals[i][c] * oneOverW[i];
+    }
+
+    // computeBarycentricDerivatives()
+    const Float8 det = (posScreen[2][0] - posScreen[1][0])
+                         * (posScreen[0][1] - posScreen[1][1])
+                       - (posScreen[0][0] - posScreen[1][0])
+                           * (posScreen[2][1] - posScreen[1][1]);
+    const Float8 db_dx[3] = {(posScreen[1][1] - posScreen[2][1]) / det,
+                             (posScreen[2][1] - posScreen[0][1]) / det,
+                             (posScreen[0][1] - posScreen[1][1]) / det};
+    const Float8 db_dy[3] = {(posScreen[2][0] - posScreen[1][0]) / det,
+                             (posScreen[0][0] - posScreen[2][0]) / det,
+                             (posScreen[1][0] - posScreen[0][0]) / det};
+
+    const auto weightedSum = [](const Float8 (&values)[3], const Float8* db) {
+        return values[0] * db[0] + values[1] * db[1] + values[2] * db[2];
+    };
+    // Attribute values at (0, 0), derivatives for x and y
+    const auto interpolate = [&](Float8 v0, Float8 v1, Float8 v2,
+                                 float (&dX)[Lanes], float (&dY)[Lanes],
+                                 float (&fixed)[Lanes]) {
+        const Float8 values[3] = {v0, v1, v2};
+        const Float8 derivativeX = weightedSum(values, db_dx);
+        const Float8 derivativeY = weightedSum(values, db_dy);
+        derivativeX.store(dX);
+        derivativeY.store(dY);
+        (v0 - posScreen[0][0] * derivativeX - posScreen[0][1] * derivativeY)
+          .store(fixed);
+    };
+
+    float dUV_dX[2][Lanes], dUV_dY[2][Lanes], UV_fixed[2][Lanes];
+    float dNormal_dX[3][Lanes], dNormal_dY[3][Lanes], normal_fixed[3][Lanes];
+    float dW_dX[Lanes], dW_dY[Lanes], oneOverW_fixed[Lanes];
+    for (int c = 0; c < 2; c++)
+        interpolate(batch.UVs[0][c], batch.UVs[1][c], batch.UVs[2][c],
+                    dUV_dX[c], dUV_dY[c], UV_fixed[c]);
+    for (int c = 0; c < 3; c++)
+        interpolate(batch.normals[0][c], batch.normals[1][c],
+                    batch.normals[2][c], dNormal_dX[c], dNormal_dY[c],
+                    normal_fixed[c]);
+    interpolate(oneOverW[0], oneOverW[1], oneOverW[2], dW_dX, dW_dY,
+                oneOverW_fixed);
+
+    for (size_t lane = 0; lane < count; lane++) {
+        TriangleDerivatives& derivatives = result[lane];
+        derivatives = TriangleDerivatives{};
+        for (int c = 0; c < 2; c++) {
+            derivatives.dUV_dX[c] = dUV_dX[c][lane];
+            derivatives.dUV_dY[c] = dUV_dY[c][lane];
+            derivatives.UV_fixed[c] = UV_fixed[c][lane];
+        }
+        for (int c = 0; c < 3; c++) {
+            derivatives.dNormal_dX[c] = dNormal_dX[c][lane];
+            derivatives.dNormal_dY[c] = dNormal_dY[c][lane];
+            derivatives.normal_fixed[c] = normal_fixed[c][lane];
+        }
+        derivatives.dW_dX = dW_dX[lane];
+        derivatives.dW_dY = dW_dY[lane];
+        derivatives.oneOverW_fixed = oneOverW_fixed[lane];
+    }
+}
+
+bool usesAVX2() {
+#ifdef __AVX2__
+    return true;
+#else
+    return false;
+#endif
+}
+} // namespace DAISReference
@@ -0,0 +1,214 @@
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <glm/vec3.hpp>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace DAISReference {
+namespace {
+// Distances from the clip planes, the inside is >= 0
+float nearPlaneDistance(const glm::vec4& p) { return p.z + p.w; }
+float farPlaneDistance(const glm::vec4& p) { return p.w - p.z; }
+
+// Sutherland-Hodgman clipping of a convex polygon by one plane
+template<typename DistanceFunc>
+int clipPolygon(const glm::vec4* polygon, int numVertices, glm::vec4* result,
+                DistanceFunc&& distance) {
+    int numResultVertices = 0;
+    for (int i = 0; i < numVertices; i++) {
+        const glm::vec4& a = polygon[i];
+        const glm::vec4& b = polygon[(i + 1) % numVertices];
+        const float distanceA = distance(a);
+        const float distanceB = distance(b);
+        if (distanceA >= 0.0f) result[numResultVertices++] = a;
+        if ((distanceA >= 0.0f) != (distanceB >= 0.0f)) {
+            const float t = distanceA / (distanceA - distanceB);
+            result[numResultVertices++] = a + (b - a) * t;
+        }
+    }
+    return numResultVertices;
+}
+
+bool setupWindowTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2,
+                         uint32_t primitiveID, const glm::ivec2& resolution,
+                         RasterTriangle& result) {
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (!(std::abs(area) > 0.0f)) return false; // Degenerate or NaN
+    // Both faces are rendered, orientation is made counterclockwise
+    if (area < 0.0f) {
+        std::swap(v1, v2);
+        area = -area;
+    }
+    const glm::vec3 v[3] = {v0, v1, v2};
+
+    // Pixels whose centers are inside the bounding box
+    const auto firstPixel = [](float min, int size) {
+        return static_cast<int>(
+          std::ceil(std::clamp(min - 0.5f, -1.0f, static_cast<float>(size))));
+    };
+    const auto lastPixel = [](float max, int size) {
+        return static_cast<int>(
+          std::floor(std::clamp(max - 0.5f, -1.0f, static_cast<float>(size))));
+    };
+    result.min.x = std::max(
+      firstPixel(std::min({v0.x, v1.x, v2.x}), resolution.x), 0);
+    result.min.y = std::max(
+      firstPixel(std::min({v0.y, v1.y, v2.y}), resolution.y), 0);
+    result.max.x = std::min(
+      lastPixel(std::max({v0.x, v1.x, v2.x}), resolution.x), resolution.x - 1);
+    result.max.y = std::min(
+      lastPixel(std::max({v0.y, v1.y, v2.y}), resolution.y), resolution.y - 1);
+    if (result.min.x > result.max.x || result.min.y > result.max.y)
+        return false;
+
+    for (int i = 0; i < 3; i++) {
+        const glm::vec3& from = v[i];
+        const glm::vec3& to = v[(i + 1) % 3];
+        const float dx = to.x - from.x;
+        const float dy = to.y - from.y;
+        result.edgeA[i] = -dy;
+        result.edgeB[i] = dx;
+        result.edgeC[i] = dy * from.x - dx * from.y;
+        // Left edges go down, top edges go left in counterclockwise order
+        result.inclusive[i] = dy < 0.0f || (dy == 0.0f && dx < 0.0f);
+    }
+
+    result.zA = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y))
+                / area;
+    result.zB = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x))
+                / area;
+    result.zC = v0.z - result.zA * v0.x - result.zB * v0.y;
+    result.primitiveID = primitiveID;
+    return true;
+}
+
+#ifdef __AVX2__
+// Rasterizes 8 pixels starting at x, rowEdge and rowZ are the terms of the
+// plane equations that are constant in the row
+inline void rasterizeSpan(const RasterTriangle& triangle,
+                          const float (&rowEdge)[3], float rowZ, int x,
+                          float* depth, uint32_t* primitiveIDs) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 px = _mm256_add_ps(_mm256_set1_ps(x + 0.5f),
+                                    _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+
+    __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int i = 0; i < 3; i++) {
+        const __m256 edge
+          = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.edgeA[i]), px),
+                          _mm256_set1_ps(rowEdge[i]));
+        mask = _mm256_and_ps(mask, triangle.inclusive[i]
+                                     ? _mm256_cmp_ps(edge, zero, _CMP_GE_OQ)
+                                     : _mm256_cmp_ps(edge, zero, _CMP_GT_OQ));
+    }
+    if (_mm256_testz_ps(mask, mask)) return;
+
+    const __m256 z = _mm256_add_ps(
+      _mm256_mul_ps(_mm256_set1_ps(triangle.zA), px), _mm256_set1_ps(rowZ));
+    const __m256 oldDepth = _mm256_load_ps(depth);
+    mask = _mm256_and_ps(mask, _mm256_cmp_ps(z, oldDepth, _CMP_LT_OQ));
+    _mm256_store_ps(depth, _mm256_blendv_ps(oldDepth, z, mask));
+
+    auto* ids = reinterpret_cast<float*>(primitiveIDs);
+    const __m256 newIDs = _mm256_castsi256_ps(
+      _mm256_set1_epi32(static_cast<int>(triangle.primitiveID)));
+    _mm256_store_ps(ids, _mm256_blendv_ps(_mm256_load_ps(ids), newIDs, mask));
+}
+#else
+inline void rasterizeSpan(const RasterTriangle& triangle,
+                          const float (&rowEdge)[3], float rowZ, int x,
+                          float* depth, uint32_t* primitiveIDs) {
+    for (int lane = 0; lane < 8; lane++) {
+        const float px = (x + 0.5f) + static_cast<float>(lane);
+        bool inside = true;
+        for (int i = 0; i < 3; i++) {
+            const float edge = triangle.edgeA[i] * px + rowEdge[i];
+            inside &= triangle.inclusive[i] ? edge >= 0.0f : edge > 0.0f;
+        }
+        const float z = triangle.zA * px + rowZ;
+        if (inside && z < depth[lane]) {
+            depth[lane] = z;
+            primitiveIDs[lane] = triangle.primitiveID;
+        }
+    }
+}
+#endif
+} // namespace
+
+int setupTriangle(const glm::vec4 (&clipPositions)[3], uint32_t primitiveID,
+                  const glm::ivec2& resolution, RasterTriangle result[3]) {
+    // Each clipping plane adds at most one vertex
+    glm::vec4 polygon[5], clipped[5];
+    std::copy(std::begin(clipPositions), std::end(clipPositions), polygon);
+    int numVertices = clipPolygon(polygon, 3, clipped, nearPlaneDistance);
+    numVertices = clipPolygon(clipped, numVertices, polygon, farPlaneDistance);
+    if (numVertices < 3) return 0;
+
+    glm::vec3 window[5];
+    for (int i = 0; i < numVertices; i++) {
+        const glm::vec3 ndc = glm::vec3(polygon[i]) / polygon[i].w;
+        window[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * resolution.x,
+                              (ndc.y * 0.5f + 0.5f) * resolution.y,
+                              ndc.z * 0.5f + 0.5f);
+    }
+
+    int numTriangles = 0;
+    for (int i = 1; i + 1 < numVertices; i++) {
+        if (setupWindowTriangle(window[0], window[i], window[i + 1],
+                                primitiveID, resolution,
+                                result[numTriangles]))
+            numTriangles++;
+    }
+    return numTriangles;
+}
+
+void TileBuffer::clear() {
+    std::fill(std::begin(depth), std::end(depth), 1.0f);
+    std::fill(std::begin(primitiveIDs), std::end(primitiveIDs),
+              EmptyPrimitive);
+}
+
+void rasterizeTile(const std::vector<RasterTriangle>& triangles,
+                   const std::vector<uint32_t>& indices,
+                   const glm::ivec2& origin, TileBuffer& tile) {
+    constexpr int TileSize = TileBuffer::TileSize;
+    for (const uint32_t index : indices) {
+        const RasterTriangle& triangle = triangles[index];
+        const int minX = std::max(triangle.min.x, origin.x);
+        const int maxX = std::min(triangle.max.x, origin.x + TileSize - 1);
+        const int minY = std::max(triangle.min.y, origin.y);
+        const int maxY = std::min(triangle.max.y, origin.y + TileSize - 1);
+        // Spans are aligned to 8 pixels inside the tile
+        const int firstX = origin.x + ((minX - origin.x) & ~7);
+
+        for (int y = minY; y <= maxY; y++) {
+            const float py = static_cast<float>(y) + 0.5f;
+            const float rowEdge[3] = {
+              triangle.edgeB[0] * py + triangle.edgeC[0],
+              triangle.edgeB[1] * py + triangle.edgeC[1],
+              triangle.edgeB[2] * py + triangle.edgeC[2]};
+            const float rowZ = triangle.zB * py + triangle.zC;
+
+            const int rowOffset = (y - origin.y) * TileSize - origin.x;
+            for (int x = firstX; x <= maxX; x += 8)
+                rasterizeSpan(triangle, rowEdge, rowZ, x,
+                              &tile.depth[rowOffset + x],
+                              &tile.primitiveIDs[rowOffset + x]);
+        }
+    }
+}
+
+const char* getRasterizerInstructionSet() {
+#ifdef __AVX2__
+    return "AVX2";
+#else
+    return "scalar";
+#endif
+}
+} // namespace DAISReference
@@ -0,0 +1,62 @@
+#ifndef DAISREFERENCE_SRC_RASTERIZER
+#define DAISREFERENCE_SRC_RASTERIZER
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+namespace DAISReference {
+constexpr uint32_t EmptyPrimitive = UINT32_MAX;
+
+// Screen-space triangle prepared for rasterization
+struct RasterTriangle
+{
+    // Edge functions a * x + b * y + c, positive inside the triangle
+    float edgeA[3];
+    float edgeB[3];
+    float edgeC[3];
+    // Top-left edges contain pixels whose centers lie on the edge
+    bool inclusive[3];
+
+    // Window depth plane zA * x + zB * y + zC
+    float zA, zB, zC;
+
+    glm::ivec2 min, max; // Covered pixels, inclusive
+    uint32_t primitiveID;
+};
+
+// Clips the triangle by the near and far planes and sets up the covered parts
+// for the viewport (0, 0, resolution). Returns the number of triangles written
+// to result (at most 3).
+int setupTriangle(const glm::vec4 (&clipPositions)[3], uint32_t primitiveID,
+                  const glm::ivec2& resolution, RasterTriangle result[3]);
+
+//-----------------------------------------------------------------------------
+// Name: TileBuffer
+// Desc: Depth and primitive IDs of one TileSize x TileSize screen tile. Rows
+//       are padded so that 8 pixels wide spans never leave the tile.
+//-----------------------------------------------------------------------------
+struct TileBuffer
+{
+    constexpr static int TileSize = 32;
+    static_assert(TileSize % 8 == 0, "Tiles are rasterized 8 pixels at a time");
+
+    alignas(32) float depth[TileSize * TileSize];
+    alignas(32) uint32_t primitiveIDs[TileSize * TileSize];
+
+    void clear();
+};
+
+// Rasterizes triangles[indices] in order with GL_LESS depth test into the
+// tile whose bottom left pixel is origin
+void rasterizeTile(const std::vector<RasterTriangle>& triangles,
+                   const std::vector<uint32_t>& indices,
+                   const glm::ivec2& origin, TileBuffer& tile);
+
+// Name of the instruction set used by rasterizeTile()
+const char* getRasterizerInstructionSet();
+} // namespace DAISReference
+
+#endif /* DAISREFERENCE_SRC_RASTERIZER */
@@ -0,0 +1,70 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace DAISReference {
+
+ThreadPool::ThreadPool(unsigned numThreads) {
+    if (numThreads == 0)
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned thread = 1; thread < numThreads; thread++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, thread);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        quit = true;
+    }
+    jobStarted.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void ThreadPool::parallelFor(
+  size_t count, const std::function<void(size_t, unsigned)>& func) {
+    if (count == 0) return;
+    if (workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; i++) func(i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        job = &func;
+        this->count = count;
+        nextIndex = 0;
+        numBusyWorkers = static_cast<unsigned>(workers.size());
+        jobGeneration++;
+    }
+    jobStarted.notify_all();
+
+    runItems(0);
+
+    std::unique_lock lock(mutex);
+    jobFinished.wait(lock, [this] { return numBusyWorkers == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::workerLoop(unsigned thread) {
+    size_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            jobStarted.wait(lock, [&] {
+                return quit || jobGeneration != generation;
+            });
+            if (quit) return;
+            generation = jobGeneration;
+        }
+
+        runItems(thread);
+
+        std::lock_guard lock(mutex);
+        if (--numBusyWorkers == 0) jobFinished.notify_one();
+    }
+}
+
+void ThreadPool::runItems(unsigned thread) {
+    for (size_t i = nextIndex++; i < count; i = nextIndex++) (*job)(i, thread);
+}
+} // namespace DAISReference
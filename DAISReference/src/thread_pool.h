@@ -0,0 +1,57 @@
+#ifndef DAISREFERENCE_SRC_THREAD_POOL
+#define DAISREFERENCE_SRC_THREAD_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DAISReference {
+//-----------------------------------------------------------------------------
+// Name: ThreadPool
+// Desc: Fixed set of worker threads executing one parallel loop at a time.
+//       The calling thread takes part in the loop as well.
+//-----------------------------------------------------------------------------
+class ThreadPool
+{
+public:
+    // numThreads == 0 uses all hardware threads
+    explicit ThreadPool(unsigned numThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Calls func(index, thread) for every index in <0, count), thread is in
+    // <0, getNumThreads()). Returns after all calls finished.
+    void parallelFor(size_t count,
+                     const std::function<void(size_t, unsigned)>& func);
+
+    unsigned getNumThreads() const {
+        return static_cast<unsigned>(workers.size()) + 1;
+    }
+
+private:
+    void workerLoop(unsigned thread);
+    void runItems(unsigned thread);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable jobStarted;
+    std::condition_variable jobFinished;
+
+    // Current job, guarded by the mutex
+    const std::function<void(size_t, unsigned)>* job = nullptr;
+    size_t jobGeneration = 0;
+    unsigned numBusyWorkers = 0;
+    bool quit = false;
+
+    size_t count = 0;
+    std::atomic<size_t> nextIndex{0};
+};
+} // namespace DAISReference
+
+#endif /* DAISREFERENCE_SRC_THREAD_POOL */
@@ -0,0 +1,221 @@
+//-----------------------------------------------------------------------------
+//  Renders the sphere scene of DeferredAttributeInterpolationShading with the
+//  CPU reference implementation and reports cache and memory statistics.
+//
+//  Usage: DAISReferenceTool [--spheres 5] [--slices 20] [--lights 256]
+//                           [--seed 1] [--lightrange 0.2:2.0]
+//                           [--resolution 1200x900] [--hash 8192]
+//                           [--zoffset 8] [--threads 0] [--texture file]
+//                           [--packed 0] [--compact 0] [--fused 0]
+//                           [--ways 2] [--cachehash mask|multiplicative|murmur]
+//                           [--probing none|linear|quadratic]
+//                           [--output image.png]
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+
+#include <dais_reference.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <spdlog/spdlog.h>
+#include <stb_image.h>
+#include <stb_image_write.h>
+
+#include <tools.h>
+
+#ifndef PROJECT_DIRECTORY
+#define PROJECT_DIRECTORY ""
+#endif
+
+namespace {
+// Same layout as Scene::Lights::create()
+float random(std::mt19937& engine, float min, float max) {
+    return min + (max - min) * static_cast<float>(engine() >> 8) * 0x1p-24f;
+}
+
+glm::vec3 random(std::mt19937& engine, glm::vec3 min, glm::vec3 max) {
+    const float x = random(engine, min.x, max.x);
+    const float y = random(engine, min.y, max.y);
+    const float z = random(engine, min.z, max.z);
+    return glm::vec3(x, y, z);
+}
+
+std::vector<DAISReference::Light> createLights(int numLights, uint32_t seed,
+                                               glm::vec2 rangeLimits,
+                                               float maxDistance) {
+    std::mt19937 engine(seed);
+    std::vector<DAISReference::Light> lights(numLights);
+    for (auto& light : lights) {
+        const float radius = random(engine, 1.0f, maxDistance);
+        const glm::vec3 position
+          = glm::normalize(random(engine, glm::vec3(-1.0f), glm::vec3(1.0f)))
+            * radius;
+        const float range = random(engine, rangeLimits.x, rangeLimits.y);
+
+        light.position = glm::vec4(position, range);
+        light.color
+          = glm::vec4(random(engine, glm::vec3(0.1f), glm::vec3(0.8f)), 0.45f);
+    }
+    return lights;
+}
+
+// Same geometry as Scene::Spheres::updateGeometry()
+void createSpheres(int numSpheresPerRow, int numSphereSlices,
+                   DAISReference::SceneInput& scene) {
+    Tools::Mesh::CreateSphereVertexMesh(scene.vertices, 0.5f, numSphereSlices,
+                                        numSphereSlices);
+    for (size_t i = 1; i < scene.vertices.size(); i += 3)
+        std::swap(scene.vertices[i], scene.vertices[i + 1]);
+
+    const auto numSpheres = static_cast<size_t>(numSpheresPerRow)
+                            * numSpheresPerRow * numSpheresPerRow;
+    for (size_t i = 0; i < numSpheres; i++) {
+        const int x = i % numSpheresPerRow;
+        const int y = i / numSpheresPerRow % numSpheresPerRow;
+        const int z
+          = i / (numSpheresPerRow * numSpheresPerRow) % numSpheresPerRow;
+        scene.instanceOffsets.emplace_back(
+          glm::vec3(x, y, z) - glm::vec3((numSpheresPerRow - 1) * 0.5f), 1);
+    }
+}
+
+bool loadTexture(const std::string& fileName,
+                 DAISReference::Texture& texture) {
+    int numChannels = 0;
+    stbi_set_flip_vertically_on_load(1);
+    unsigned char* pixels = stbi_load(fileName.c_str(), &texture.width,
+                                      &texture.height, &numChannels, 4);
+    if (!pixels) return false;
+    texture.texels.resize(static_cast<size_t>(texture.width) * texture.height);
+    for (size_t i = 0; i < texture.texels.size(); i++)
+        texture.texels[i] = glm::vec4(pixels[i * 4], pixels[i * 4 + 1],
+                                      pixels[i * 4 + 2], pixels[i * 4 + 3])
+                            / 255.0f;
+    stbi_image_free(pixels);
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    std::map<std::string, std::string> args;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string arg = argv[i];
+        if (!arg.starts_with("--")) {
+            spdlog::error("Unexpected argument {}", arg);
+            return 1;
+        }
+        args[arg.substr(2)] = argv[i + 1];
+    }
+    const auto get = [&](const char* key, const char* defaultValue) {
+        const auto it = args.find(key);
+        return it != args.end() ? it->second : std::string(defaultValue);
+    };
+
+    const int numSpheresPerRow = std::stoi(get("spheres", "5"));
+    const int numSphereSlices = std::stoi(get("slices", "20"));
+    const int numLights = std::stoi(get("lights", "256"));
+    const auto seed = static_cast<uint32_t>(std::stoul(get("seed", "1")));
+    const float zOffset = std::stof(get("zoffset", "8"));
+    const auto numThreads
+      = static_cast<unsigned>(std::stoul(get("threads", "0")));
+    glm::vec2 lightRange;
+    glm::ivec2 resolution;
+    if (sscanf(get("lightrange", "0.2:2.0").c_str(), "%f:%f", &lightRange.x,
+               &lightRange.y)
+          != 2
+        || sscanf(get("resolution", "1200x900").c_str(), "%dx%d",
+                  &resolution.x, &resolution.y)
+             != 2) {
+        spdlog::error("Invalid light range or resolution");
+        return 1;
+    }
+
+    DAISReference::SceneInput scene;
+    createSpheres(numSpheresPerRow, numSphereSlices, scene);
+    scene.lights = createLights(numLights, seed, lightRange,
+                                static_cast<float>(numSpheresPerRow));
+    DAISReference::Texture albedo;
+    const std::string textureFileName
+      = get("texture", PROJECT_DIRECTORY "../common/textures/metal01.jpg");
+    if (loadTexture(textureFileName, albedo))
+        scene.albedo = &albedo;
+    else
+        spdlog::warn("Unable to load texture {}, using white", textureFileName);
+
+    // Default camera of the application
+    DAISReference::FrameParameters frame;
+    const glm::mat4 model
+      = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -zOffset));
+    frame.projection
+      = glm::perspective(glm::radians(60.0f),
+                         float(resolution.x) / resolution.y, 0.1f, 1000.0f);
+    frame.modelViewProjection = frame.projection * model;
+    frame.cameraPosition = glm::vec3(glm::inverse(model)[3]);
+    frame.resolution = resolution;
+    frame.hashTableSize = std::stoi(get("hash", "8192"));
+    if (frame.hashTableSize <= 0
+        || (frame.hashTableSize & (frame.hashTableSize - 1)) != 0) {
+        spdlog::error("Hash table size has to be a power of two");
+        return 1;
+    }
+    frame.cacheWays = std::stoi(get("ways", "2"));
+    const std::map<std::string, DAISReference::CacheHash> hashes{
+      {"mask", DAISReference::CacheHash::Mask},
+      {"multiplicative", DAISReference::CacheHash::Multiplicative},
+      {"murmur", DAISReference::CacheHash::Murmur}};
+    const std::map<std::string, DAISReference::CacheProbing> probings{
+      {"none", DAISReference::CacheProbing::None},
+      {"linear", DAISReference::CacheProbing::Linear},
+      {"quadratic", DAISReference::CacheProbing::Quadratic}};
+    const auto hash = hashes.find(get("cachehash", "mask"));
+    const auto probing = probings.find(get("probing", "none"));
+    if ((frame.cacheWays != 2 && frame.cacheWays != 4 && frame.cacheWays != 8)
+        || hash == hashes.end() || probing == probings.end()) {
+        spdlog::error("Invalid cache ways, hash or probing");
+        return 1;
+    }
+    frame.cacheHash = hash->second;
+    frame.cacheProbing = probing->second;
+    frame.packedDerivatives = std::stoi(get("packed", "0")) != 0;
+    frame.compactTriangles = std::stoi(get("compact", "0")) != 0;
+    frame.fusedDerivatives = std::stoi(get("fused", "0")) != 0;
+
+    DAISReference::Renderer renderer(numThreads);
+    const auto& statistics = renderer.render(scene, frame);
+
+    spdlog::info("Triangles: {} submitted, {} rasterized, {} visible, {} "
+                 "stored",
+                 statistics.submittedTriangles, statistics.rasterizedTriangles,
+                 statistics.uniqueTriangles, statistics.storedTriangles);
+    spdlog::info("Cache: {} lookups, hit rate {:.2f} %, {} collisions, {} "
+                 "evictions",
+                 statistics.cacheLookups, statistics.getCacheHitRate() * 100.0,
+                 statistics.cacheCollisions, statistics.cacheEvictions);
+    spdlog::info("Memory traffic [MB]: cache {:.2f}, triangle address {:.2f}, "
+                 "triangles {:.2f}, derivatives {:.2f}, shading {:.2f}",
+                 statistics.cacheBytes / 1e6,
+                 statistics.triangleAddressBytes / 1e6,
+                 statistics.triangleStoreBytes / 1e6,
+                 statistics.derivativesBytes / 1e6,
+                 statistics.shadingBytes / 1e6);
+    spdlog::info("Time [ms]: raster {:.2f}, cache {:.2f}, derivatives {:.2f}, "
+                 "shading {:.2f}",
+                 statistics.rasterTime, statistics.cacheTime,
+                 statistics.derivativesTime, statistics.shadingTime);
+
+    const std::string outputFileName = get("output", "");
+    if (!outputFileName.empty()) {
+        // Rows are stored bottom-up
+        stbi_flip_vertically_on_write(1);
+        const auto pixels = renderer.getPixels();
+        if (!stbi_write_png(outputFileName.c_str(), resolution.x, resolution.y,
+                            4, pixels.data(), 4 * resolution.x)) {
+            spdlog::error("Unable to write {}", outputFileName);
+            return 1;
+        }
+    }
+    return 0;
+}
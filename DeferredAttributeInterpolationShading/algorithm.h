@@ -1,145 +1,598 @@
 #ifndef DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHM
 #define DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHM
 
+#include "render_graph.h"
+#include "shader_compiler.h"
 #include "tools.h"
+#include "trace.h"
 #include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
 #include <functional>
+#include <initializer_list>
+#include <memory>
 #include <optional>
+#include <ostream>
+#include <sstream>
+#include <type_traits>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include <filesystem>
 
 #include <fmt/format.h>
 
 #include <glbinding/gl/gl.h>
+#include <GLFW/glfw3.h>
 #include <spdlog/spdlog.h>
 
 using namespace gl;
 
 using OptionsMap = std::unordered_map<std::string, bool>;
 
-template<typename DerivedT>
+// MSAA sample counts shader permutations are compiled for (0 = disabled)
+inline constexpr std::array<uint8_t, 3> MSAASampleCounts{0, 4, 8};
+
+// Performance measurements made for every renderpass
+enum class Instrumentation : uint8_t
+{
+    Off,               // Nothing is measured
+    Timers,            // GPU timers
+    PipelineStatistics // GPU timers and shader invocation counters
+};
+
+// Upper bound of the instrumentation level is a template parameter of the
+// algorithm, instrumentation above it is removed at compile time
+template<typename DerivedT, Instrumentation MaxInstrumentation
+                            = Instrumentation::PipelineStatistics>
 class Algorithm;
 
-struct RenderPass
+template<Instrumentation MaxInstrumentation>
+struct BasicRenderPass
 {
     using RenderPassCb = std::function<void(void)>;
 
+    constexpr static bool HasTimers
+      = MaxInstrumentation >= Instrumentation::Timers;
+    constexpr static bool HasPipelineStatistics
+      = MaxInstrumentation >= Instrumentation::PipelineStatistics;
+
+    // Placeholder of instrumentation removed at compile time
+    struct NoInstrumentation
+    {};
+    template<bool Enabled, typename InstrumentationT>
+    using Instrument
+      = std::conditional_t<Enabled, InstrumentationT, NoInstrumentation>;
+
     std::string name;                    // Renderpass name
     const bool* controller = nullptr;    // Renderpass controller (optional)
+    const bool* inverseController
+      = nullptr; // Disables the renderpass when set (optional)
     std::string_view shaderFilenameBase; // Shader file name (without file
                                          // extensions 'vert', 'frag' or 'geom')
-    GLuint program = 0;                  // Shader program ID
-    RenderPassCb render;                 // Render function
-    Tools::GPUTimer timer;               // GPU timer
-    Tools::GPUVSInvocationQuery
-      vertexShaderCounter; // GPU vertex shader execution counter
-    Tools::GPUFSInvocationQuery
-      fragmentShaderCounter; // GPU fragment shader execution counter
+    GLuint program = 0;                  // Selected shader program ID
+    std::unordered_map<std::string, GLuint>
+      programs; // Shader permutations (GLSL defines -> program ID)
+    std::unordered_map<std::string, std::shared_ptr<Tools::ProgramCompileJob>>
+      pendingPrograms; // Permutations being compiled
+    std::unordered_map<std::string, std::shared_ptr<Tools::ProgramCompileJob>>
+      backgroundPrograms; // Other permutations, compiled without blocking
+    BasicRenderPass* programOwner
+      = nullptr; // Earlier renderpass with the same shaders, its programs are
+                 // shared instead of compiling them again
+    std::vector<std::string>
+      permutationOptions;         // Options used by the shaders (sorted)
+    bool usesMSAASamples = false; // Shaders are specialized by MSAA_SAMPLES
+    std::unordered_map<std::string, std::vector<std::string>>
+      requiredExtensions; // Extensions required by "#ifdef <define>" blocks
+    RenderPassCb render;          // Render function
+    [[no_unique_address]] Instrument<HasTimers, Tools::GPUTimer>
+      timer; // GPU timer
+    [[no_unique_address]] Instrument<HasPipelineStatistics,
+                                     Tools::GPUPipelineStatisticsQuery>
+      pipelineStatistics; // GPU pipeline statistics (shader invocations...)
+    std::vector<ResourceAccess>
+      resources; // Resources accessed by the renderpass (render graph)
+    MemoryBarrierMask barriers
+      = MemoryBarrierMask::GL_NONE_BIT; // Barriers issued before the pass
+    bool culled = false; // Renderpass outputs are not used
 
     // Constructors
-    RenderPass(std::string name_, RenderPassCb renderFunc_,
+    BasicRenderPass(std::string name_, RenderPassCb renderFunc_,
 
-               std::optional<std::string_view> shaderFilenameBase_
-               = std::nullopt,
-               const bool* controller_ = nullptr)
+                    std::optional<std::string_view> shaderFilenameBase_
+                    = std::nullopt,
+                    const bool* controller_ = nullptr)
       : name(std::move(name_)), controller(controller_),
         shaderFilenameBase(shaderFilenameBase_.value_or("")),
         render(std::move(renderFunc_)) {}
 
-    RenderPass(std::string name_, RenderPassCb renderFunc_,
-               const bool* controller_ = nullptr)
-      : RenderPass(std::move(name_), std::move(renderFunc_), std::nullopt,
-                   controller_) {}
+    BasicRenderPass(std::string name_, RenderPassCb renderFunc_,
+                    const bool* controller_ = nullptr)
+      : BasicRenderPass(std::move(name_), std::move(renderFunc_),
+                        std::nullopt, controller_) {}
 
     // Starts render pass including lazy initialization and performance
-    // measurements
-    void run(bool forceSync = false) {
-        if (controller != nullptr && !*controller) return;
+    // measurements up to the given level
+    void run(bool forceSync = false,
+             Instrumentation instrumentation = MaxInstrumentation) {
+        if (!isActive()) return;
+
+        // Removed at compile time without instrumentation, no timestamp
+        // queries are issued unless a trace is being recorded
+        std::optional<Tools::TraceScope> traceScope;
+        std::optional<Tools::GPUTraceScope> gpuTraceScope;
+        if constexpr (MaxInstrumentation != Instrumentation::Off) {
+            if (Tools::TraceRecorder::get().isRecording()) {
+                traceScope.emplace(name);
+                gpuTraceScope.emplace(name);
+            }
+        }
 
-        vertexShaderCounter.start();
-        fragmentShaderCounter.start();
-        timer.start(forceSync);
+        const bool measureTime = instrumentation >= Instrumentation::Timers;
+        const bool measureStatistics
+          = instrumentation >= Instrumentation::PipelineStatistics;
+        if constexpr (HasPipelineStatistics) {
+            if (measureStatistics) pipelineStatistics.start();
+        }
+        if constexpr (HasTimers) {
+            if (measureTime) timer.start(forceSync);
+        }
 
+        if (barriers != MemoryBarrierMask::GL_NONE_BIT)
+            glMemoryBarrier(barriers);
         glUseProgram(program);
         render();
 
-        timer.stop();
-        fragmentShaderCounter.stop();
-        vertexShaderCounter.stop();
+        if constexpr (HasTimers) {
+            if (measureTime) timer.stop();
+        }
+        if constexpr (HasPipelineStatistics) {
+            if (measureStatistics) pipelineStatistics.stop();
+        }
     }
 
-    void resetTimer() { timer.reset(); }
+    void resetTimer() {
+        if constexpr (HasTimers) timer.reset();
+        if constexpr (HasPipelineStatistics) pipelineStatistics.clear();
+    }
 
-    bool compileShaders(const OptionsMap& options) {
-        resetTimer();
-        if (shaderFilenameBase.empty()) return true;
+    // Declares resources read by the renderpass
+    BasicRenderPass& reads(std::initializer_list<ResourceAccess> accesses) {
+        for (const auto& access : accesses)
+            resources.push_back({access.resource, access.usage, false});
+        return *this;
+    }
 
-        // Create list of GLSL defines for enabled options
-        std::string preprocessorDefines;
-        for (auto&& [name, enabled] : options) {
-            if (enabled) {
-                std::string defineName = name;
-                std::replace(defineName.begin(), defineName.end(), ' ', '_');
-                preprocessorDefines += fmt::format("#define {}\n", defineName);
-            }
-        }
+    // Declares resources written by the renderpass
+    BasicRenderPass& writes(std::initializer_list<ResourceAccess> accesses) {
+        for (const auto& access : accesses)
+            resources.push_back({access.resource, access.usage, true});
+        return *this;
+    }
 
+    // Renderpass is disabled while the flag is set, e.g. when an option
+    // replaces it by another renderpass
+    BasicRenderPass& disabledBy(const bool* flag) {
+        inverseController = flag;
+        return *this;
+    }
+
+    // Returns list of shader stages (type and file name) of the renderpass
+    std::vector<Tools::ProgramCompileJob::Stage> getShaderStages() const {
         const auto makeFilename = [&](std::string_view extension) {
             return fmt::format("{}.{}", shaderFilenameBase, extension);
         };
-        const auto getDefinesOrNullptr = [&]() {
-            return preprocessorDefines.empty() ? nullptr
-                                               : preprocessorDefines.c_str();
-        };
 
-        bool compilationResult{};
+        std::vector<Tools::ProgramCompileJob::Stage> stages;
         if (std::filesystem::exists(makeFilename("comp"))) {
-            compilationResult
-              = Tools::Shader::CreateComputeShaderProgramFromFile(
-                program, makeFilename("comp").c_str(), getDefinesOrNullptr());
-        } else if (std::filesystem::exists(makeFilename("geom"))) {
-            compilationResult = Tools::Shader::CreateShaderProgramFromFile(
-              program, makeFilename("vert").c_str(), nullptr, nullptr,
-              makeFilename("geom").c_str(), makeFilename("frag").c_str(),
-              getDefinesOrNullptr());
+            stages.emplace_back(GL_COMPUTE_SHADER, makeFilename("comp"));
         } else {
-            compilationResult = Tools::Shader::CreateShaderProgramFromFile(
-              program, makeFilename("vert").c_str(), nullptr, nullptr, nullptr,
-              makeFilename("frag").c_str(), getDefinesOrNullptr());
+            stages.emplace_back(GL_VERTEX_SHADER, makeFilename("vert"));
+            if (std::filesystem::exists(makeFilename("geom")))
+                stages.emplace_back(GL_GEOMETRY_SHADER, makeFilename("geom"));
+            stages.emplace_back(GL_FRAGMENT_SHADER, makeFilename("frag"));
+        }
+        return stages;
+    }
+
+    // Returns the source without // and /* */ comments, line breaks are kept
+    static std::string stripComments(const std::string& source) {
+        std::string result;
+        result.reserve(source.size());
+        for (size_t i = 0; i < source.size(); i++) {
+            if (source.compare(i, 2, "//") == 0) {
+                i = source.find('\n', i);
+                if (i == std::string::npos) break;
+                result += '\n';
+            } else if (source.compare(i, 2, "/*") == 0) {
+                const size_t end = source.find("*/", i + 2);
+                if (end == std::string::npos) break;
+                result.append(std::count(source.begin() + i,
+                                         source.begin() + end, '\n'),
+                              '\n');
+                i = end + 1;
+            } else {
+                result += source[i];
+            }
+        }
+        return result;
+    }
+
+    // Adds extensions required ("#extension <name> : require") inside
+    // "#ifdef <define>" blocks of the source to requiredExtensions
+    void findRequiredExtensions(const std::string& source) {
+        std::vector<std::string> defines; // Enclosing blocks, "" if not #ifdef
+        std::istringstream lines(source);
+        for (std::string line; std::getline(lines, line);) {
+            std::istringstream tokens(line);
+            std::string directive, operand;
+            tokens >> directive >> operand;
+            if (directive == "#ifdef") {
+                defines.push_back(operand);
+            } else if (directive.starts_with("#if")) {
+                defines.emplace_back();
+            } else if (directive == "#else" || directive == "#elif") {
+                if (!defines.empty()) defines.back().clear();
+            } else if (directive == "#endif") {
+                if (!defines.empty()) defines.pop_back();
+            } else if (directive == "#extension"
+                       && line.find("require") != std::string::npos) {
+                for (const auto& define : defines)
+                    if (!define.empty())
+                        requiredExtensions[define].push_back(operand);
+            }
         }
+    }
 
-        // Explicit sync. for better time measurement
-        glFinish();
-        return compilationResult;
+    // Returns false if an enabled option requires an extension the driver
+    // doesn't report, such permutations are never compiled
+    bool isPermutationSupported(const OptionsMap& options) const {
+        for (const auto& name : permutationOptions) {
+            if (!options.at(name)) continue;
+            const auto it = requiredExtensions.find(getDefineName(name));
+            if (it == requiredExtensions.end()) continue;
+            for (const auto& extension : it->second)
+                if (!glfwExtensionSupported(extension.c_str())) return false;
+        }
+        return true;
     }
 
-    bool isEnabled() const { return !controller || (controller[0]); }
-}; // end of struct RenderPass
+    // Finds options (and MSAA sample count) the shaders depend on, only these
+    // are used to create shader permutations. Included files are searched as
+    // well, comments are not.
+    void findPermutationOptions(const OptionsMap& options) {
+        const auto stages = getShaderStages();
+        std::vector<std::string> sources;
+        requiredExtensions.clear();
+        for (auto&& [type, filename] : stages) {
+            std::string source;
+            if (Tools::Shader::LoadShaderSource(source, filename.c_str(),
+                                                nullptr)) {
+                sources.push_back(stripComments(source));
+                findRequiredExtensions(sources.back());
+            }
+        }
+        const auto isUsed = [&](const std::string& identifier) {
+            const auto isIdentifierChar = [](char c) {
+                return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+            };
+            for (const auto& source : sources) {
+                for (size_t pos = source.find(identifier);
+                     pos != std::string::npos;
+                     pos = source.find(identifier, pos + 1)) {
+                    const size_t end = pos + identifier.size();
+                    if ((pos == 0 || !isIdentifierChar(source[pos - 1]))
+                        && (end == source.size()
+                            || !isIdentifierChar(source[end])))
+                        return true;
+                }
+            }
+            return false;
+        };
+
+        permutationOptions.clear();
+        for (auto&& [name, enabled] : options) {
+            if (isUsed(getDefineName(name)))
+                permutationOptions.push_back(name);
+        }
+        // Sorted so that defines (and program binary cache keys) don't depend
+        // on the order of the options map
+        std::sort(permutationOptions.begin(), permutationOptions.end());
+        usesMSAASamples = isUsed("MSAA_SAMPLES");
+    }
+
+    // Returns GLSL defines identifying shader permutation
+    std::string getPermutationDefines(const OptionsMap& options,
+                                      uint8_t numSamples) const {
+        std::string preprocessorDefines;
+        for (const auto& name : permutationOptions) {
+            if (options.at(name))
+                preprocessorDefines
+                  += fmt::format("#define {}\n", getDefineName(name));
+        }
+        if (usesMSAASamples)
+            preprocessorDefines
+              += fmt::format("#define MSAA_SAMPLES {}\n", numSamples);
+        return preprocessorDefines;
+    }
+
+    // Submits the permutation of the current options and sample count for
+    // compilation, current programs are used until the new one is applied
+    // with applyCompiledPrograms(). The other permutations are compiled in
+    // the background afterwards, see compileRemainingPermutations().
+    bool compileShaders(const OptionsMap& options, uint8_t numSamples) {
+        pendingPrograms.clear();
+        backgroundPrograms.clear();
+        if (shaderFilenameBase.empty() || programOwner) return true;
+
+        findPermutationOptions(options);
+        const auto defines = getPermutationDefines(options, numSamples);
+        pendingPrograms.emplace(
+          defines,
+          Tools::ShaderCompiler::get().submit(getShaderStages(), defines));
+        return true;
+    }
+
+    // Submits the permutations one option toggle away from the current
+    // options (at the current sample count) for compilation, they are added
+    // to the programs as they finish (pollBackgroundCompilation()). Other
+    // permutations are compiled on demand by getPermutationProgram().
+    void compileRemainingPermutations(const OptionsMap& options,
+                                      uint8_t numSamples) {
+        if (shaderFilenameBase.empty() || programOwner) return;
+
+        const auto stages = getShaderStages();
+        OptionsMap permutation = options;
+        for (const auto& name : permutationOptions) {
+            permutation[name] = !options.at(name);
+            auto defines = getPermutationDefines(permutation, numSamples);
+            if (isPermutationSupported(permutation)
+                && !programs.contains(defines)
+                && !backgroundPrograms.contains(defines)) {
+                auto job = Tools::ShaderCompiler::get().submit(stages, defines);
+                backgroundPrograms.emplace(std::move(defines), std::move(job));
+            }
+            permutation[name] = options.at(name);
+        }
+    }
+
+    // Moves finished background permutations to the programs, never blocks
+    void pollBackgroundCompilation() {
+        for (auto it = backgroundPrograms.begin();
+             it != backgroundPrograms.end();) {
+            if (!it->second->poll()) {
+                ++it;
+                continue;
+            }
+            if (GLuint compiled = it->second->takeProgram())
+                programs.emplace(it->first, compiled);
+            it = backgroundPrograms.erase(it);
+        }
+    }
+
+    // Returns true if there is no compilation in progress, never blocks
+    bool pollCompilation() {
+        bool finished = true;
+        for (auto&& [defines, job] : pendingPrograms)
+            finished = job->poll() && finished;
+        return finished;
+    }
+
+    // Blocks until all permutations are compiled
+    void waitForCompilation() {
+        for (auto&& [defines, job] : pendingPrograms) job->wait();
+    }
+
+    // Returns true if all permutations were compiled successfully
+    bool compilationSucceeded() const {
+        return std::all_of(pendingPrograms.begin(), pendingPrograms.end(),
+                           [](auto&& pending) {
+                               return pending.second->isReady();
+                           });
+    }
+
+    // Replaces current programs with the compiled ones, a permutation has
+    // to be selected afterwards
+    void applyCompiledPrograms() {
+        if (programOwner) {
+            program = 0;
+            resetTimer();
+        }
+        if (pendingPrograms.empty()) return;
+        for (auto&& [defines, compiledProgram] : programs)
+            glDeleteProgram(compiledProgram);
+        programs.clear();
+        for (auto&& [defines, job] : pendingPrograms)
+            programs.emplace(defines, job->takeProgram());
+        pendingPrograms.clear();
+        program = 0;
+        resetTimer();
+    }
+
+    // Returns program of the permutation, a permutation still compiling in
+    // the background (or not submitted yet) is waited for. Returns 0 if its
+    // compilation failed.
+    GLuint getPermutationProgram(const OptionsMap& options,
+                                 uint8_t numSamples) {
+        if (programOwner)
+            return programOwner->getPermutationProgram(options, numSamples);
+
+        auto defines = getPermutationDefines(options, numSamples);
+        if (const auto it = programs.find(defines); it != programs.end())
+            return it->second;
+        if (!isPermutationSupported(options)) {
+            spdlog::error("{}: permutation requires an extension not "
+                          "supported by the driver",
+                          name);
+            return 0;
+        }
+
+        auto& compiler = Tools::ShaderCompiler::get();
+        auto it = backgroundPrograms.find(defines);
+        if (it == backgroundPrograms.end()) {
+            it = backgroundPrograms
+                   .emplace(defines, compiler.submit(getShaderStages(), defines))
+                   .first;
+        }
+        compiler.prioritize(it->second);
+        it->second->wait();
+        const GLuint compiled = it->second->takeProgram();
+        backgroundPrograms.erase(it);
+        if (compiled) programs.emplace(std::move(defines), compiled);
+        return compiled;
+    }
+
+    // Selects shader permutation, returns false if the permutation couldn't
+    // be compiled
+    bool selectPermutation(const OptionsMap& options, uint8_t numSamples) {
+        if (shaderFilenameBase.empty()) return true;
+        const GLuint selected = getPermutationProgram(options, numSamples);
+        if (selected == 0) return false;
+        program = selected;
+        return true;
+    }
+
+    // Returns GLSL define name for the option
+    static std::string getDefineName(std::string_view optionName) {
+        std::string defineName{optionName};
+        std::replace(defineName.begin(), defineName.end(), ' ', '_');
+        return defineName;
+    }
+
+    bool isEnabled() const {
+        return (!controller || (controller[0]))
+               && (!inverseController || !inverseController[0]);
+    }
+    bool isActive() const { return isEnabled() && !culled; }
+}; // end of struct BasicRenderPass
 
-template<typename DerivedT>
+template<typename DerivedT, Instrumentation MaxInstrumentation>
 class Algorithm
 {
+protected:
+    using RenderPass = BasicRenderPass<MaxInstrumentation>;
+
+private:
     bool initialized = false; // Flag for lazy initialization of shaders
     bool showDebug = false;   // Flag if debug method will be called
-    Tools::GPUTimer timer;    // GPU timer for the complete algorithm
+    bool compiling = false;   // Flag if shaders are being compiled
+    Instrumentation instrumentation
+      = MaxInstrumentation; // Measurements made at runtime
+    [[no_unique_address]] typename RenderPass::template Instrument<
+      RenderPass::HasTimers, Tools::GPUTimer>
+      timer; // GPU timer for the complete algorithm
+    RenderGraph renderGraph;  // Dependencies between renderpasses
+    std::vector<bool>
+      renderGraphEnabledPasses; // Enabled renderpasses the graph was built for
+    std::optional<OptionsMap>
+      pendingOptions; // Options applied once the shaders are compiled
 
     DerivedT& getDerived() { return reinterpret_cast<DerivedT&>(*this); }
     const DerivedT& getDerived() const {
         return reinterpret_cast<const DerivedT&>(*this);
     }
-    const std::string& getName() const { return getDerived().name; }
     std::vector<RenderPass>& getRenderPasses() {
         return getDerived().renderPasses;
     }
     OptionsMap& getOptions() { return getDerived().options; }
 
+    // Rebuilds the render graph if a renderpass was enabled/disabled or a
+    // transient buffer was resized
+    void updateRenderGraph() {
+        std::vector<RenderGraph::Node> nodes;
+        std::vector<bool> enabledPasses;
+        for (const auto& renderPass : getRenderPasses()) {
+            nodes.push_back({&renderPass.resources, renderPass.isEnabled()});
+            enabledPasses.push_back(renderPass.isEnabled());
+        }
+        if (enabledPasses == renderGraphEnabledPasses
+            && !renderGraph.needsBuild())
+            return;
+        renderGraphEnabledPasses = std::move(enabledPasses);
+
+        renderGraph.build(nodes);
+        for (size_t i = 0; i < getRenderPasses().size(); i++) {
+            auto& renderPass = getRenderPasses()[i];
+            renderPass.culled = renderGraph.isCulled(i);
+            renderPass.barriers = renderGraph.getBarriers(i);
+            if (renderPass.culled && renderPass.isEnabled())
+                logDebug("Render pass {} culled.", renderPass.name);
+        }
+    }
+
+    uint8_t getMSAASampleCount() const {
+        return getDerived().getMSAASampleCount();
+    }
+
+    // Returns true if all renderpasses have a program to render with
+    bool hasPrograms() {
+        return std::all_of(getRenderPasses().begin(), getRenderPasses().end(),
+                           [](const RenderPass& renderPass) {
+                               return renderPass.shaderFilenameBase.empty()
+                                      || renderPass.program != 0;
+                           });
+    }
+
+    // Swaps programs of all renderpasses at once when all of them are
+    // compiled, so that the algorithm never renders with mixed shaders
+    void updateCompilation(bool block = false) {
+        if (!compiling) return;
+
+        bool finished = true;
+        for (auto& renderPass : getRenderPasses()) {
+            if (block) renderPass.waitForCompilation();
+            finished = renderPass.pollCompilation() && finished;
+        }
+        if (!finished) return;
+        compiling = false;
+
+        const bool succeeded = std::all_of(
+          getRenderPasses().begin(), getRenderPasses().end(),
+          [](const RenderPass& renderPass) {
+              return renderPass.compilationSucceeded();
+          });
+        if (!succeeded) {
+            logError("Shader compilation failed, keeping previous shaders.");
+            for (auto& renderPass : getRenderPasses())
+                renderPass.pendingPrograms.clear();
+            pendingOptions.reset();
+            return;
+        }
+
+        size_t numPrograms = 0;
+        for (auto& renderPass : getRenderPasses()) {
+            numPrograms += renderPass.pendingPrograms.size();
+            renderPass.applyCompiledPrograms();
+        }
+        if (pendingOptions) {
+            // Assign values one by one, renderpass controllers point into
+            // the options map
+            for (auto&& [name, enabled] : *pendingOptions)
+                getOptions()[name] = enabled;
+            pendingOptions.reset();
+        }
+        logDebug("Shaders compiled ({} permutations).", numPrograms);
+        // Permutations of other options are compiled while rendering
+        for (auto& renderPass : getRenderPasses())
+            renderPass.compileRemainingPermutations(getOptions(),
+                                                    getMSAASampleCount());
+        selectPermutations();
+    }
+
 protected:
-    using AlgorithmCRTPBaseT = Algorithm<DerivedT>;
+    using AlgorithmCRTPBaseT = Algorithm<DerivedT, MaxInstrumentation>;
+
+    RenderGraph& getRenderGraph() { return renderGraph; }
 
     template<typename... Args>
     void log(spdlog::level::level_enum level,
              spdlog::format_string_t<Args...> fmt, Args&&... args) {
+        // Don't format messages which would be discarded
+        if (!spdlog::should_log(level)) return;
         spdlog::log(level, "{}: {}", getDerived().name,
                     fmt::format(fmt, std::forward<Args>(args)...));
     }
@@ -164,7 +617,129 @@ protected:
         log(spdlog::level::debug, fmt, std::forward<Args>(args)...);
     }
 
+    // Selects precompiled shader permutations of all renderpasses matching
+    // current options and MSAA sample count. Has to be called whenever one
+    // of them changes, nothing is compiled.
+    bool selectPermutations() {
+        // Permutations are selected once the compilation is finished
+        if (compiling || !initialized) return true;
+
+        bool result = true;
+        for (auto& renderPass : getRenderPasses()) {
+            if (!renderPass.selectPermutation(getOptions(),
+                                              getMSAASampleCount())) {
+                logError("Missing shader permutation for {} render pass.",
+                         renderPass.name);
+                result = false;
+            }
+        }
+        reset();
+        return result;
+    }
+
 public:
+    const std::string& getName() const { return getDerived().name; }
+
+    // Changes an option the same way as the GUI checkbox does, returns false
+    // if the algorithm has no such option
+    bool setOption(const std::string& name, bool enabled) {
+        const auto it = getOptions().find(name);
+        if (it == getOptions().end()) return false;
+        if (compiling) {
+            if (!pendingOptions) pendingOptions = getOptions();
+            (*pendingOptions)[name] = enabled;
+        } else if (it->second != enabled) {
+            it->second = enabled;
+            selectPermutations();
+        }
+        return true;
+    }
+
+    // Returns average duration of the complete algorithm (0 if timers are
+    // disabled)
+    unsigned int getFrameTime() {
+        if constexpr (RenderPass::HasTimers) return timer.getAverage();
+        return 0;
+    }
+
+    Instrumentation getInstrumentation() const { return instrumentation; }
+
+    // Memory allocated by the render graph for transient buffers
+    GLsizeiptr getTransientMemorySize() const {
+        return renderGraph.getTransientMemorySize();
+    }
+
+    // Reads results of the measurements made by the last run(), so that they
+    // are accumulated even if the GUI is not shown
+    void collectMeasurements() {
+        if constexpr (RenderPass::HasTimers) {
+            if (instrumentation < Instrumentation::Timers) return;
+            timer.get();
+            for (auto& renderPass : getRenderPasses()) {
+                if (renderPass.isActive()) renderPass.timer.get();
+            }
+        }
+        if constexpr (RenderPass::HasPipelineStatistics) {
+            if (instrumentation < Instrumentation::PipelineStatistics) return;
+            for (auto& renderPass : getRenderPasses()) {
+                if (renderPass.isActive()) renderPass.pipelineStatistics.get();
+            }
+        }
+    }
+
+    // Writes averaged measurements of all renderpasses as CSV (one row per
+    // renderpass)
+    void writeStatistics(std::ostream& stream) {
+        writeStatisticsHeader(stream);
+        writeStatisticsRows(stream);
+    }
+
+    // Writes CSV header of writeStatisticsRows()
+    static void writeStatisticsHeader(std::ostream& stream) {
+        using Statistics = Tools::GPUPipelineStatisticsQuery;
+        stream << "algorithm,render pass,time [us],p50 [us],p90 [us],"
+                  "p99 [us],max [us]";
+        for (const auto* statisticName : Statistics::Names)
+            stream << ',' << statisticName;
+        stream << '\n';
+    }
+
+    // Writes CSV row for every active renderpass, prefix is prepended to
+    // every row (additional columns)
+    void writeStatisticsRows(std::ostream& stream,
+                             std::string_view prefix = {}) {
+        using Statistics = Tools::GPUPipelineStatisticsQuery;
+        for (auto& renderPass : getRenderPasses()) {
+            if (!renderPass.isActive()) continue;
+            stream << prefix << getName() << ',' << renderPass.name << ',';
+            if constexpr (RenderPass::HasTimers) {
+                if (instrumentation >= Instrumentation::Timers) {
+                    const auto& history = renderPass.timer.getHistory();
+                    stream << renderPass.timer.getAverage() << ','
+                           << history.getPercentile(0.5f) << ','
+                           << history.getPercentile(0.9f) << ','
+                           << history.getPercentile(0.99f) << ','
+                           << history.getMax();
+                } else {
+                    stream << ",,,,";
+                }
+            } else {
+                stream << ",,,,";
+            }
+            Statistics::Results results{};
+            if constexpr (RenderPass::HasPipelineStatistics) {
+                if (instrumentation >= Instrumentation::PipelineStatistics)
+                    results = renderPass.pipelineStatistics.getAverage();
+            }
+            for (auto value : results) stream << ',' << value;
+            stream << '\n';
+        }
+    }
+    void setInstrumentation(Instrumentation level) {
+        instrumentation = std::min(level, MaxInstrumentation);
+        reset();
+    }
+
     // Displays algorithm debug informations. This method is called at the end
     // of Algorithm::run().
     void debug() { getDerived().debug(); }
@@ -179,13 +754,39 @@ public:
         // Lazy initialization of the algorithm
         if (!initialized) initialized = reset(true);
 
-        timer.start(forceSync);
+        std::optional<Tools::TraceScope> traceScope;
+        if constexpr (MaxInstrumentation != Instrumentation::Off) {
+            if (Tools::TraceRecorder::get().isRecording())
+                traceScope.emplace(getName());
+        }
+
+        // There is nothing to render with until the first compilation ends
+        updateCompilation(!hasPrograms());
+        if (!hasPrograms()) return;
+        for (auto& renderPass : getRenderPasses())
+            renderPass.pollBackgroundCompilation();
+
+        // Algorithms may be resident at the same time, binding points are
+        // shared. Transient buffers may be resized by the algorithm, the
+        // graph is updated afterwards.
+        getDerived().bindResources();
+        updateRenderGraph();
+        renderGraph.bindTransientBuffers();
+
+        const bool measureTime = instrumentation >= Instrumentation::Timers;
+        if constexpr (RenderPass::HasTimers) {
+            if (measureTime) timer.start(forceSync);
+        }
         for (auto& renderPass : getRenderPasses()) {
-            log(spdlog::level::trace, "Starting {} render pass",
-                renderPass.name);
-            renderPass.run(forceSync);
+            if constexpr (MaxInstrumentation != Instrumentation::Off) {
+                log(spdlog::level::trace, "Starting {} render pass",
+                    renderPass.name);
+            }
+            renderPass.run(forceSync, instrumentation);
+        }
+        if constexpr (RenderPass::HasTimers) {
+            if (measureTime) timer.stop();
         }
-        timer.stop();
 
         // Render/print debug information
         if (showDebug) debug();
@@ -194,7 +795,7 @@ public:
     // Resets algorithm - resets all performance timers/counters and restarts
     // all renderpasses (and optionally rebuilds shaders of all renderpasses).
     bool reset(bool resetShaders = false) {
-        timer.reset();
+        if constexpr (RenderPass::HasTimers) timer.reset();
         bool result = true;
         if (resetShaders) {
             result = compile();
@@ -203,19 +804,88 @@ public:
         return result;
     }
 
-    // Rebuilds algorithm shaders (rebuild shaders of all renderpasses)
+    // Rebuilds algorithm shaders (submits the selected shader permutation of
+    // all renderpasses for compilation, programs are swapped once all of them
+    // are compiled). Renderpasses with the same shaders share programs.
     bool compile() {
-        for (auto& renderPass : getRenderPasses())
-            if (!renderPass.compileShaders(getOptions())) return false;
+        const OptionsMap& options
+          = pendingOptions ? *pendingOptions : getOptions();
+        auto& renderPasses = getRenderPasses();
+        for (auto it = renderPasses.begin(); it != renderPasses.end(); ++it) {
+            it->programOwner = nullptr;
+            for (auto owner = renderPasses.begin(); owner != it; ++owner) {
+                if (!it->shaderFilenameBase.empty()
+                    && owner->shaderFilenameBase == it->shaderFilenameBase) {
+                    it->programOwner = &*owner;
+                    break;
+                }
+            }
+        }
+        for (auto& renderPass : renderPasses)
+            if (!renderPass.compileShaders(options, getMSAASampleCount()))
+                return false;
+        compiling = true;
         return true;
     }
 
+    // Returns true if the algorithm is not waiting for shaders
+    bool isCompiling() const { return compiling; }
+
+    // Displays latency percentiles and frame time graphs over the timer
+    // history window, averages hide occasional spikes
+    void timeDistributionGui() {
+        if constexpr (RenderPass::HasTimers) {
+            if (ImGui::CollapsingHeader("LATENCY PERCENTILES")) {
+                const auto showPercentiles
+                  = [](const char* name, const Tools::TimerHistory& history) {
+                        ImGui::Text(" * %s: %.0f / %.0f / %.0f / %.0f", name,
+                                    history.getPercentile(0.5f),
+                                    history.getPercentile(0.9f),
+                                    history.getPercentile(0.99f),
+                                    history.getMax());
+                    };
+                ImGui::Text("p50 / p90 / p99 / max of last %d frames",
+                            timer.getHistory().getSize());
+                showPercentiles("Frame time", timer.getHistory());
+                for (auto& renderPass : getRenderPasses()) {
+                    if (renderPass.isActive())
+                        showPercentiles(renderPass.name.c_str(),
+                                        renderPass.timer.getHistory());
+                }
+            }
+            if (ImGui::CollapsingHeader("FRAME TIME GRAPHS")) {
+                const auto plotHistory
+                  = [](const char* name, const Tools::TimerHistory& history) {
+                        ImPlot::PlotLine(name, history.getData(),
+                                         history.getSize(), 1.0, 0.0, 0,
+                                         history.getOffset());
+                    };
+                if (ImPlot::BeginPlot(
+                      "##FrameTimes",
+                      ImVec2(-1.0f, 150.0f * IMGUI_RESIZE_FACTOR))) {
+                    ImPlot::SetupAxes(nullptr, "us",
+                                      ImPlotAxisFlags_NoTickLabels,
+                                      ImPlotAxisFlags_AutoFit);
+                    ImPlot::SetupAxisLimits(ImAxis_X1, 0,
+                                            Tools::TimerHistory::Capacity);
+                    plotHistory("Frame time", timer.getHistory());
+                    for (auto& renderPass : getRenderPasses()) {
+                        if (renderPass.isActive())
+                            plotHistory(renderPass.name.c_str(),
+                                        renderPass.timer.getHistory());
+                    }
+                    ImPlot::EndPlot();
+                }
+            }
+        }
+    }
+
     // Displays window with GUI for the algorithm, returns window height
     size_t gui(const glm::ivec2& position, int width) {
         // Count enabled renderpasses
         int numRenderPasses = 0;
         for (auto& renderPass : getRenderPasses()) {
-            if (renderPass.isEnabled()) numRenderPasses++;
+            if (renderPass.isActive()) numRenderPasses++;
         }
 
         const int rowHeight = 9 * IMGUI_RESIZE_FACTOR;
@@ -232,37 +902,113 @@ public:
         // Add checkboxes for algorithm options
         ImGui::Text("OPTIONS");
         ImGui::Checkbox("show debug", &showDebug);
-        for (auto& option : getOptions()) {
-            if (ImGui::Checkbox(option.first.c_str(), &option.second))
-                reset(true);
-        }
-        ImGui::Separator();
-        // Timers
-        ImGui::Text("TIMERS");
-        const auto totalTime = timer.getAverage();
-        ImGui::Text("Frame time: %u (%u)", totalTime, timer.getCounter());
-        for (auto& renderPass : getRenderPasses()) {
-            if (renderPass.isEnabled()) {
-                const auto renderPassTime = renderPass.timer.getAverage();
-                ImGui::Text(" * %s: %u (%.2f%%)", renderPass.name.c_str(),
-                            renderPassTime,
-                            float(renderPassTime) / totalTime * 100.0f);
+        for (auto&& [name, enabled] : getOptions()) {
+            // Changes made during compilation are applied together with the
+            // compiled shaders
+            bool value = pendingOptions ? pendingOptions->at(name) : enabled;
+            if (ImGui::Checkbox(name.c_str(), &value)) {
+                if (compiling) {
+                    if (!pendingOptions) pendingOptions = getOptions();
+                    (*pendingOptions)[name] = value;
+                } else {
+                    enabled = value;
+                    selectPermutations();
+                }
             }
         }
-        // Invocation counters
-        ImGui::Separator();
-        ImGui::Text("VERTEX SHADERS");
-        for (auto& renderPass : getRenderPasses()) {
-            if (renderPass.isEnabled())
-                ImGui::Text(" * %s: %u", renderPass.name.c_str(),
-                            renderPass.vertexShaderCounter.get());
+        if (compiling) ImGui::Text("Compiling shaders...");
+        if constexpr (MaxInstrumentation != Instrumentation::Off) {
+            if (ImGui::Button("Save statistics")) {
+                const auto filename
+                  = fmt::format("{}_statistics.csv", getName());
+                std::ofstream file(filename);
+                writeStatistics(file);
+                logInfo("Statistics saved to {}", filename);
+            }
+            // Only levels available in this build are listed
+            constexpr const char* levelNames[]
+              = {"Off", "Timers", "Pipeline statistics"};
+            constexpr auto numLevels
+              = static_cast<int>(MaxInstrumentation) + 1;
+            int level = static_cast<int>(instrumentation);
+            if (ImGui::Combo("Instrumentation", &level, levelNames, numLevels))
+                setInstrumentation(static_cast<Instrumentation>(level));
         }
-        ImGui::Separator();
-        ImGui::Text("FRAGMENT SHADERS");
-        for (auto& renderPass : getRenderPasses()) {
-            if (renderPass.isEnabled())
-                ImGui::Text(" * %s: %u", renderPass.name.c_str(),
-                            renderPass.fragmentShaderCounter.get());
+        if constexpr (RenderPass::HasTimers) {
+            if (instrumentation >= Instrumentation::Timers) {
+                ImGui::Separator();
+                // Timers
+                ImGui::Text("TIMERS");
+                const auto totalTime = timer.getAverage();
+                ImGui::Text("Frame time: %u (%u)", totalTime,
+                            timer.getCounter());
+                for (auto& renderPass : getRenderPasses()) {
+                    if (renderPass.isActive()) {
+                        const auto renderPassTime
+                          = renderPass.timer.getAverage();
+                        ImGui::Text(" * %s: %u (%.2f%%)",
+                                    renderPass.name.c_str(), renderPassTime,
+                                    float(renderPassTime) / totalTime
+                                      * 100.0f);
+                    }
+                }
+                timeDistributionGui();
+            }
+        }
+        if constexpr (RenderPass::HasPipelineStatistics) {
+            if (instrumentation >= Instrumentation::PipelineStatistics) {
+                using Statistics = Tools::GPUPipelineStatisticsQuery;
+                // Results of the last frame
+                std::vector<Statistics::Results> statistics;
+                for (auto& renderPass : getRenderPasses()) {
+                    statistics.push_back(renderPass.isActive()
+                                           ? renderPass.pipelineStatistics.get()
+                                           : Statistics::Results{});
+                }
+                const auto showStatistic
+                  = [&](const char* title, Statistics::Statistic statistic) {
+                        ImGui::Separator();
+                        ImGui::Text("%s", title);
+                        for (size_t i = 0; i < statistics.size(); i++) {
+                            if (getRenderPasses()[i].isActive())
+                                ImGui::Text(" * %s: %u",
+                                            getRenderPasses()[i].name.c_str(),
+                                            statistics[i][statistic]);
+                        }
+                    };
+                // Invocation counters
+                showStatistic("VERTEX SHADERS",
+                              Statistics::VertexShaderInvocations);
+                showStatistic("FRAGMENT SHADERS",
+                              Statistics::FragmentShaderInvocations);
+
+                // Remaining statistics of renderpasses which have any
+                ImGui::Separator();
+                if (ImGui::CollapsingHeader("PIPELINE STATISTICS")) {
+                    for (size_t i = 0; i < statistics.size(); i++) {
+                        const auto& passStatistics = statistics[i];
+                        if (std::all_of(passStatistics.begin(),
+                                        passStatistics.end(),
+                                        [](auto value) { return value == 0; }))
+                            continue;
+                        ImGui::Text("%s", getRenderPasses()[i].name.c_str());
+                        for (int s = 0; s < Statistics::Count; s++) {
+                            if (passStatistics[s] == 0) continue;
+                            ImGui::Text(" * %s: %u", Statistics::Names[s],
+                                        passStatistics[s]);
+                        }
+                        // Geometry shader output amplification
+                        const auto gsInvocations = passStatistics
+                          [Statistics::GeometryShaderInvocations];
+                        const auto gsPrimitives = passStatistics
+                          [Statistics::GeometryShaderPrimitivesEmitted];
+                        if (gsInvocations > 0) {
+                            ImGui::Text(" * GS amplification: %.2f",
+                                        float(gsPrimitives) / gsInvocations);
+                        }
+                    }
+                }
+            }
         }
         ImGui::End();
         return height;
@@ -2,7 +2,10 @@
 #include "option_declaration_macros.h"
 #include "scene.h"
 
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cmath>
 
 #include <glm/vec2.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -16,14 +19,17 @@ DeferredAttributeInterpolationShading::
   ~DeferredAttributeInterpolationShading() {
     glDeleteFramebuffers(1, &FBO);
     glDeleteVertexArrays(1, &emptyVAO);
-    glDeleteBuffers(1, &triangleSSBO);
-    glDeleteBuffers(1, &derivativeSSBO);
     glDeleteBuffers(1, &atomicCounterBuffer);
+    for (auto& readback : counterReadbacks) {
+        if (readback.fence) glDeleteSync(readback.fence);
+        glDeleteBuffers(1, &readback.buffer);
+    }
 
     glDeleteTextures(1, &cacheTexture);
     glDeleteTextures(1, &locksTexture);
     glDeleteTextures(1, &triangleAddressFBOTexture);
     glDeleteTextures(1, &FBOdepthTexture);
+    glDeleteTextures(1, &coarseShadingTexture);
 }
 
 void DeferredAttributeInterpolationShading::initialize() {
@@ -32,24 +38,52 @@ void DeferredAttributeInterpolationShading::initialize() {
     DECLARE_OPTION(resetHashTableWithBufferClear, true);
     DECLARE_OPTION(invalidateDataBeforeClear, true);
     DECLARE_SHADER_ONLY_OPTION(AggressiveMultisampleDiscard, false);
+    // fp16 UV and normal derivatives, halves the record read per sample
+    DECLARE_SHADER_ONLY_OPTION(PackedDerivatives, false);
+    // 60 byte triangle records without clip-space z and padding
+    DECLARE_SHADER_ONLY_OPTION(CompactTriangles, false);
+    // Geometry pass writes derivatives, replaces the compute pass
+    DECLARE_OPTION(FusedDerivatives, false);
+    // One cache lookup per triangle and subgroup (GL_KHR_shader_subgroup)
+    DECLARE_SHADER_ONLY_OPTION(SubgroupDeduplication, false);
+    // Albedo mip level from the stored UV derivatives instead of the implicit
+    // derivatives of the fullscreen pass
+    DECLARE_SHADER_ONLY_OPTION(AnalyticGradients, false);
+    // Collision and eviction counters of the memoization cache
+    DECLARE_OPTION(CacheStatistics, false);
+    // Hash table size follows the number of stored triangles
+    DECLARE_OPTION(adaptiveHashTableSize, false);
+    // Only tiles with geometry are shaded, tiles covered by a single triangle
+    // skip the triangle address buffer
+    DECLARE_OPTION(TileClassification, false);
+    // Lighting is evaluated per triangle at a lattice following its screen
+    // size and reused across samples and frames
+    DECLARE_OPTION(ObjectSpaceShading, false);
+    // Triangles with smooth lighting are shaded per 2x2 or 4x4 pixels
+    DECLARE_OPTION(AdaptiveShadingRate, false);
 
     logDebug("Initializing");
     createHashTableResources();
-    createSSBO(triangleSSBO, layout::ShaderStorageBuffers::DAIS_Triangles);
-    createSSBO(derivativeSSBO, layout::ShaderStorageBuffers::DAIS_Derivatives);
+    createStorageBuffers();
     createAtomicCounterBuffer();
+    createCounterReadbacks();
     createUniformBuffer();
     createFBO(Variables::WindowSize);
+    tileLists.resize(Variables::WindowSize);
+    taa.resize(Variables::WindowSize);
 
     glLineWidth(2.0);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glDisable(GL_DITHER);
 
     glGenVertexArrays(1, &emptyVAO);
 
     renderPasses.emplace_back(
       "Reset buffers",
       [&]() -> void {
+          if (CacheStatistics || adaptiveHashTableSize) {
+              if (readCounters() && adaptiveHashTableSize)
+                  adaptHashTableSize();
+          }
           if (resetHashTableWithBufferClear) {
               if (invalidateDataBeforeClear)
                   glInvalidateTexImage(cacheTexture, 0);
@@ -65,9 +99,9 @@ void DeferredAttributeInterpolationShading::initialize() {
               glClearNamedBufferData(atomicCounterBuffer, GL_R32UI,
                                      GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
           } else {
-              auto* address = static_cast<GLuint*>(
+              auto* address = static_cast<CacheCounters*>(
                 glMapNamedBuffer(atomicCounterBuffer, GL_WRITE_ONLY));
-              *address = 0;
+              *address = CacheCounters{};
               if (glUnmapNamedBuffer(atomicCounterBuffer) == GL_FALSE) {
                   logWarning(
                     "Atomic counter buffer data store contents have become "
@@ -82,6 +116,7 @@ void DeferredAttributeInterpolationShading::initialize() {
           const glm::mat4 MVPInverse
             = glm::inverse(Variables::Transform.ModelViewProjection);
 
+          const GLsizei texelsPerSet = cacheWays / 2;
           {
               // update uniform buffer
               auto uniforms = uniformBuffer.mapForWrite();
@@ -90,14 +125,22 @@ void DeferredAttributeInterpolationShading::initialize() {
                   cameraPosition, Variables::Transform.ModelViewProjection},
                 MVPInverse,
                 Variables::Transform.Viewport,
-                hashTableSize - 1,
+                hashTableSize / texelsPerSet - 1,
                 static_cast<GLuint>(Scene::get().spheres.trianglesPerSphere),
                 Variables::Transform.Projection[3][2],
                 Variables::Transform.Projection[2][2],
-                MSAASampleCount};
+                MSAASampleCount,
+                static_cast<GLuint>(texelsPerSet),
+                cacheHash,
+                cacheProbing,
+                maxShadingVariation,
+                {}};
           }
       },
-      nullptr);
+      nullptr)
+      .writes({{"hash table cache", ResourceUsage::TextureUpdate},
+               {"triangle counter", ResourceUsage::BufferUpdate},
+               {"uniforms", ResourceUsage::BufferUpdate}});
 
     // Add rendering passes
     renderPasses.emplace_back(
@@ -108,39 +151,122 @@ void DeferredAttributeInterpolationShading::initialize() {
 
           Scene::get().spheres.render();
       },
-      "01_dais_depth_prepass");
+      "01_dais_depth_prepass")
+      .reads({{"uniforms", ResourceUsage::UniformBuffer}})
+      .writes({{"depth", ResourceUsage::Framebuffer}});
+
+    const auto geometryPass = [&]() -> void {
+        glDepthFunc(GL_EQUAL);
+        constexpr auto clearValue = glm::uvec4(-1);
+        glClearNamedFramebufferuiv(FBO, GL_COLOR, 0,
+                                   glm::value_ptr(clearValue));
+
+        Scene::get().update();
+        Scene::get().spheres.render();
+        glDepthFunc(GL_LESS);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    };
+    renderPasses.emplace_back("Geometry Pass", geometryPass,
+                              "02_dais_geometry_pass")
+      .reads({{"uniforms", ResourceUsage::UniformBuffer},
+              {"depth", ResourceUsage::Framebuffer},
+              {"hash table cache", ResourceUsage::Image},
+              {"hash table locks", ResourceUsage::Image},
+              {"triangle counter", ResourceUsage::AtomicCounter}})
+      .writes({{"hash table cache", ResourceUsage::Image},
+               {"hash table locks", ResourceUsage::Image},
+               {"triangle counter", ResourceUsage::AtomicCounter},
+               {"triangles", ResourceUsage::StorageBuffer},
+               {"shading cache records", ResourceUsage::StorageBuffer},
+               {"triangle address", ResourceUsage::Framebuffer},
+               {"lights", ResourceUsage::BufferUpdate}})
+      .disabledBy(&FusedDerivatives);
+
+    // Same shaders, the fragment storing a triangle computes its derivatives,
+    // so the triangle buffer is not allocated
+    renderPasses.emplace_back("Fused Geometry Pass", geometryPass,
+                              "02_dais_geometry_pass", &FusedDerivatives)
+      .reads({{"uniforms", ResourceUsage::UniformBuffer},
+              {"depth", ResourceUsage::Framebuffer},
+              {"hash table cache", ResourceUsage::Image},
+              {"hash table locks", ResourceUsage::Image},
+              {"triangle counter", ResourceUsage::AtomicCounter}})
+      .writes({{"hash table cache", ResourceUsage::Image},
+               {"hash table locks", ResourceUsage::Image},
+               {"triangle counter", ResourceUsage::AtomicCounter},
+               {"derivatives", ResourceUsage::StorageBuffer},
+               {"shading cache records", ResourceUsage::StorageBuffer},
+               {"triangle address", ResourceUsage::Framebuffer},
+               {"lights", ResourceUsage::BufferUpdate}});
 
     renderPasses.emplace_back(
-      "Geometry Pass",
+      "Partial Derivatives Compute Pass",
       [&]() -> void {
-          glDepthFunc(GL_EQUAL);
-          constexpr auto clearValue = glm::uvec4(-1);
-          glClearNamedFramebufferuiv(FBO, GL_COLOR, 0,
-                                     glm::value_ptr(clearValue));
-
-          Scene::get().update();
-          Scene::get().spheres.render();
-          glDepthFunc(GL_LESS);
-          glBindFramebuffer(GL_FRAMEBUFFER, 0);
+          const auto numTriangles = getNumStoredTriangles();
+          if (numTriangles == 0) return;
+          glDispatchCompute(numTriangles, 1, 1);
       },
-      "02_dais_geometry_pass");
+      "03_dais_compute_pass")
+      .reads({{"uniforms", ResourceUsage::UniformBuffer},
+              {"triangle counter", ResourceUsage::BufferUpdate},
+              {"triangles", ResourceUsage::StorageBuffer}})
+      .writes({{"derivatives", ResourceUsage::StorageBuffer}})
+      .disabledBy(&FusedDerivatives);
 
     renderPasses.emplace_back(
-      "Partial Derivatives Compute Pass",
+      "Object-Space Shading Pass",
       [&]() -> void {
-          auto numTriangles = *static_cast<GLuint*>(
-            glMapNamedBuffer(atomicCounterBuffer, GL_READ_ONLY));
-          if (glUnmapNamedBuffer(atomicCounterBuffer) == GL_FALSE) {
-              logWarning("Triangle SSBO data store contents have become "
-                         "corrupt during the time the data store was mapped, "
-                         "reinitializing.");
-              createAtomicCounterBuffer();
-          }
+          const auto cameraPosition = Variables::Transform.ModelViewInverse
+                                      * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+          shadingCache.update(glm::vec3(cameraPosition));
+          shadingCache.shade(atomicCounterBuffer,
+                             offsetof(CacheCounters, triangleWriteIndex));
+      },
+      "03_dais_object_space_shading", &ObjectSpaceShading)
+      .reads({{"uniforms", ResourceUsage::UniformBuffer},
+              {"triangle counter", ResourceUsage::BufferUpdate},
+              {"derivatives", ResourceUsage::StorageBuffer},
+              {"shading cache records", ResourceUsage::StorageBuffer},
+              {"shading cache", ResourceUsage::StorageBuffer},
+              {"lights", ResourceUsage::StorageBuffer}})
+      .writes({{"shading cache", ResourceUsage::BufferUpdate},
+               {"shading cache", ResourceUsage::StorageBuffer},
+               {"shading cache records", ResourceUsage::StorageBuffer}});
+
+    // Surfaces are reconstructed from the derivatives of their triangles
+    renderPasses.emplace_back(
+      "Motion Vectors",
+      [&]() -> void {
+          taa.update(Variables::Transform.UnjitteredModelViewProjection);
+          taa.dispatch();
+      },
+      "03_dais_motion_vectors", &temporalAA)
+      .reads({{"uniforms", ResourceUsage::UniformBuffer},
+              {"derivatives", ResourceUsage::StorageBuffer},
+              {"triangle address", ResourceUsage::Texture}})
+      .writes({{"taa uniforms", ResourceUsage::BufferUpdate},
+               {"motion vectors", ResourceUsage::Image}});
 
-          if (numTriangles == 0) return;
-          glDispatchCompute(numTriangles, 1, 1);
+    renderPasses.emplace_back(
+      "Tile Classification", [&]() -> void { tileLists.classify(); },
+      "03_dais_tile_classification", &TileClassification)
+      .reads({{"triangle address", ResourceUsage::Texture}})
+      .writes({{"tile list", ResourceUsage::BufferUpdate},
+               {"tile list", ResourceUsage::StorageBuffer}});
+
+    renderPasses.emplace_back(
+      "Coarse Shading Pass",
+      [&]() -> void {
+          const auto numBlocks = (Variables::WindowSize + COARSE_BLOCK_SIZE - 1)
+                                 / COARSE_BLOCK_SIZE;
+          glDispatchCompute(numBlocks.x, numBlocks.y, 1);
       },
-      "03_dais_compute_pass");
+      "03_dais_coarse_shading", &AdaptiveShadingRate)
+      .reads({{"uniforms", ResourceUsage::UniformBuffer},
+              {"derivatives", ResourceUsage::StorageBuffer},
+              {"triangle address", ResourceUsage::Texture},
+              {"lights", ResourceUsage::StorageBuffer}})
+      .writes({{"coarse shading", ResourceUsage::Image}});
 
     renderPasses.emplace_back(
       "Shading Pass",
@@ -149,11 +275,34 @@ void DeferredAttributeInterpolationShading::initialize() {
           glClear(GL_COLOR_BUFFER_BIT);
 
           glBindVertexArray(emptyVAO);
-          glDrawArrays(GL_TRIANGLES, 0, 3);
+          if (TileClassification)
+              tileLists.draw();
+          else
+              glDrawArrays(GL_TRIANGLES, 0, 3);
 
           glEnable(GL_DEPTH_TEST);
       },
-      "04_dais_shading_pass");
+      "04_dais_shading_pass")
+      .reads({{"uniforms", ResourceUsage::UniformBuffer},
+              {"derivatives", ResourceUsage::StorageBuffer},
+              {"triangle address", ResourceUsage::Texture},
+              {"tile list", ResourceUsage::StorageBuffer},
+              {"tile list", ResourceUsage::Command},
+              {"shading cache", ResourceUsage::StorageBuffer},
+              {"shading cache records", ResourceUsage::StorageBuffer},
+              {"coarse shading", ResourceUsage::Image},
+              {"lights", ResourceUsage::StorageBuffer}})
+      .writes({{RenderGraph::BackbufferColor, ResourceUsage::Framebuffer}});
+
+    renderPasses.emplace_back(
+      "Temporal Anti-Aliasing", [&]() -> void { taa.resolve(); },
+      "taa_resolve", &temporalAA)
+      .reads({{"taa uniforms", ResourceUsage::UniformBuffer},
+              {"motion vectors", ResourceUsage::Image},
+              {"taa history", ResourceUsage::Texture},
+              {RenderGraph::BackbufferColor, ResourceUsage::Framebuffer}})
+      .writes({{"taa history", ResourceUsage::Image},
+               {RenderGraph::BackbufferColor, ResourceUsage::Framebuffer}});
 
     renderPasses.emplace_back(
       "Restore Z-Buffer",
@@ -166,13 +315,16 @@ void DeferredAttributeInterpolationShading::initialize() {
                             GL_DEPTH_BUFFER_BIT, GL_NEAREST);
           glBindFramebuffer(GL_FRAMEBUFFER, 0);
       },
-      &restoreDepth);
+      &restoreDepth)
+      .reads({{"depth", ResourceUsage::Framebuffer}})
+      .writes({{RenderGraph::BackbufferDepth, ResourceUsage::Framebuffer}});
 }
 
 void DeferredAttributeInterpolationShading::setMSAASampleCount(
   const uint8_t numSamples) {
     MSAASampleCount = numSamples;
     createFBO(Variables::WindowSize);
+    selectPermutations();
 }
 
 void DeferredAttributeInterpolationShading::createFBO(
@@ -186,6 +338,10 @@ void DeferredAttributeInterpolationShading::createFBO(
                              MSAASampleCount > 0 ? MSAASampleCount : 1);
     Tools::Texture::Create2D(FBOdepthTexture, gl::GLenum::GL_DEPTH24_STENCIL8,
                              resolution, MSAASampleCount);
+    // Recreated with the new resolution by bindResources() if needed
+    glDeleteTextures(1, &coarseShadingTexture);
+    coarseShadingTexture = 0;
+    coarseShadingResolution = resolution;
 
     glDeleteFramebuffers(1, &FBO);
     glCreateFramebuffers(1, &FBO);
@@ -198,15 +354,6 @@ void DeferredAttributeInterpolationShading::createFBO(
                               0);
     glNamedFramebufferTexture(FBO, GL_DEPTH_ATTACHMENT, FBOdepthTexture, 0);
 
-    // Always bind both textures to avoid warnings, one will have resolution
-    // 1x1.
-    glBindTextureUnit(layout::location(layout::texSamplerForFBOAttachment<false>(
-                        gl::GLenum::GL_COLOR_ATTACHMENT0)),
-                      triangleAddressFBOTexture);
-    glBindTextureUnit(layout::location(layout::texSamplerForFBOAttachment<true>(
-                        gl::GLenum::GL_COLOR_ATTACHMENT0)),
-                      triangleAddressFBOTextureMS);
-
     assert(glGetError() == GL_NO_ERROR);
     assert(glCheckNamedFramebufferStatus(FBO, GL_FRAMEBUFFER)
            == GL_FRAMEBUFFER_COMPLETE);
@@ -217,14 +364,86 @@ void DeferredAttributeInterpolationShading::createAtomicCounterBuffer() {
 
     glDeleteBuffers(1, &atomicCounterBuffer);
     glCreateBuffers(1, &atomicCounterBuffer);
-    constexpr GLuint zero = 0;
-    glNamedBufferStorage(atomicCounterBuffer, sizeof(GLuint), &zero,
+    constexpr CacheCounters zero{};
+    glNamedBufferStorage(atomicCounterBuffer, sizeof(CacheCounters), &zero,
                          GL_CLIENT_STORAGE_BIT | GL_MAP_WRITE_BIT
                            | GL_MAP_READ_BIT);
-    glBindBufferBase(
-      GL_ATOMIC_COUNTER_BUFFER,
-      layout::location(layout::AtomicCounterBuffers::DAIS_TriangleCounter),
-      atomicCounterBuffer);
+}
+
+GLuint DeferredAttributeInterpolationShading::getNumStoredTriangles() {
+    const auto numTriangles = *static_cast<GLuint*>(
+      glMapNamedBuffer(atomicCounterBuffer, GL_READ_ONLY));
+    if (glUnmapNamedBuffer(atomicCounterBuffer) == GL_FALSE) {
+        logWarning("Triangle SSBO data store contents have become "
+                   "corrupt during the time the data store was mapped, "
+                   "reinitializing.");
+        createAtomicCounterBuffer();
+    }
+    return numTriangles;
+}
+
+void DeferredAttributeInterpolationShading::createCounterReadbacks() {
+    for (auto& readback : counterReadbacks) {
+        glCreateBuffers(1, &readback.buffer);
+        glNamedBufferStorage(readback.buffer, sizeof(CacheCounters), nullptr,
+                             GL_CLIENT_STORAGE_BIT);
+    }
+}
+
+bool DeferredAttributeInterpolationShading::readCounters() {
+    bool updated = false;
+    while (numCounterReadbacksInFlight > 0) {
+        auto& readback = counterReadbacks[oldestCounterReadback];
+        if (glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0)
+            == GL_TIMEOUT_EXPIRED)
+            break;
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+        glGetNamedBufferSubData(readback.buffer, 0, sizeof(CacheCounters),
+                                &cacheCounters);
+        oldestCounterReadback
+          = (oldestCounterReadback + 1) % counterReadbacks.size();
+        numCounterReadbacksInFlight--;
+        updated = true;
+    }
+
+    // Skipped while all copies are in flight
+    if (numCounterReadbacksInFlight == counterReadbacks.size()) return updated;
+    auto& readback = counterReadbacks[(oldestCounterReadback
+                                       + numCounterReadbacksInFlight)
+                                      % counterReadbacks.size()];
+    // Counters are written by atomic operations
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glCopyNamedBufferSubData(atomicCounterBuffer, readback.buffer, 0, 0,
+                             sizeof(CacheCounters));
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    numCounterReadbacksInFlight++;
+    return updated;
+}
+
+void DeferredAttributeInterpolationShading::adaptHashTableSize() {
+    // Triangles evicted from the cache and stored again are counted twice,
+    // which only makes a thrashing table grow faster
+    const auto numTriangles
+      = static_cast<float>(cacheCounters.triangleWriteIndex);
+    const float loadFactor = numTriangles / (2.0f * hashTableSize);
+    oversizedReadbacks
+      = loadFactor < MIN_LOAD_FACTOR ? oversizedReadbacks + 1 : 0;
+    if (loadFactor <= MAX_LOAD_FACTOR && oversizedReadbacks < SHRINK_DELAY)
+        return;
+    oversizedReadbacks = 0;
+
+    const auto numEntries = static_cast<unsigned>(
+      std::ceil(numTriangles / TARGET_LOAD_FACTOR));
+    const auto size = std::clamp(
+      static_cast<GLsizei>(std::bit_ceil(std::max(numEntries / 2, 1u))),
+      MIN_HASH_TABLE_SIZE, MAX_HASH_TABLE_SIZE);
+    if (size == hashTableSize) return;
+    logDebug("Resizing hash table {} -> {}, {} triangles stored",
+             hashTableSize, size, cacheCounters.triangleWriteIndex);
+    setHashTableSize(size);
+    // Resources of the frame are already bound
+    bindHashTable();
 }
 
 // NOLINTNEXTLINE(readability-make-member-function-const)
@@ -243,34 +462,84 @@ void DeferredAttributeInterpolationShading::resetHashTable() {
 void DeferredAttributeInterpolationShading::createHashTableResources() {
     logDebug("Creating cache buffers...");
 
-    constexpr auto createAndBindImageTexture
-      = [](GLuint& texture, const gl::GLenum format,
-           const GLsizei hashTableSize, const layout::ImageUnits unit) {
-            Tools::Texture::Create1D(texture, format, hashTableSize);
-            glBindImageTexture(layout::location(unit), texture, 0, GL_FALSE, 0,
-                               GL_READ_WRITE, format);
-        };
+    Tools::Texture::Create1D(cacheTexture, gl::GLenum::GL_RGBA32UI,
+                             hashTableSize);
+    Tools::Texture::Create1D(locksTexture, gl::GLenum::GL_R32UI, hashTableSize);
 
-    createAndBindImageTexture(cacheTexture, gl::GLenum::GL_RGBA32UI,
-                              hashTableSize, layout::ImageUnits::DAIS_Cache);
-    createAndBindImageTexture(locksTexture, gl::GLenum::GL_R32UI, hashTableSize,
-                              layout::ImageUnits::DAIS_Locks);
-
-    resetHashTable();
+    // Cleared on the GPU, the table may be resized between frames
+    constexpr auto emptyEntries = glm::uvec4(-1);
+    glClearTexImage(cacheTexture, 0, GL_RGBA_INTEGER, GL_UNSIGNED_INT,
+                    &emptyEntries.x);
+    glClearTexImage(locksTexture, 0, GL_RED_INTEGER, GL_UNSIGNED_INT,
+                    nullptr);
 }
 
-void DeferredAttributeInterpolationShading::createSSBO(
-  GLuint& ssbo, layout::ShaderStorageBuffers binding) {
-    logDebug("Creating triangle buffer...");
+void DeferredAttributeInterpolationShading::bindResources() {
+    uniformBuffer.bind();
+    glBindBufferBase(
+      GL_ATOMIC_COUNTER_BUFFER,
+      layout::location(layout::AtomicCounterBuffers::DAIS_TriangleCounter),
+      atomicCounterBuffer);
+
+    // The triangle buffer is sized for the record of the CompactTriangles
+    // option, the render graph reallocates it when the option changes
+    getRenderGraph().setTransientBufferSize(
+      "triangles", (options.at("CompactTriangles") ? COMPACT_TRIANGLE_SIZE
+                                                    : TRIANGLE_SIZE)
+                     * MAX_TRIANGLE_COUNT);
+    bindHashTable();
+    tileLists.bind();
+    if (options.at("ObjectSpaceShading")) {
+        shadingCache.allocate(MAX_TRIANGLE_COUNT);
+        shadingCache.bind();
+    } else {
+        shadingCache.free();
+    }
+    if (options.at("AdaptiveShadingRate")) {
+        if (!coarseShadingTexture)
+            Tools::Texture::Create2D(coarseShadingTexture, GL_RGBA8,
+                                     coarseShadingResolution);
+        glBindImageTexture(
+          layout::location(layout::ImageUnits::DAIS_CoarseShading),
+          coarseShadingTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+    } else if (coarseShadingTexture) {
+        glDeleteTextures(1, &coarseShadingTexture);
+        coarseShadingTexture = 0;
+    }
+    taa.bind();
 
-    glDeleteBuffers(1, &ssbo);
-    glCreateBuffers(1, &ssbo);
+    // Always bind both textures to avoid warnings, one will have resolution
+    // 1x1.
+    glBindTextureUnit(layout::location(layout::texSamplerForFBOAttachment<false>(
+                        gl::GLenum::GL_COLOR_ATTACHMENT0)),
+                      triangleAddressFBOTexture);
+    glBindTextureUnit(layout::location(layout::texSamplerForFBOAttachment<true>(
+                        gl::GLenum::GL_COLOR_ATTACHMENT0)),
+                      triangleAddressFBOTextureMS);
 
-    constexpr auto dataSize = TRIANGLE_SIZE * MAX_TRIANGLE_COUNT;
+    glDisable(GL_DITHER);
+}
 
-    glNamedBufferStorage(ssbo, dataSize, nullptr, GL_CLIENT_STORAGE_BIT);
+void DeferredAttributeInterpolationShading::bindHashTable() {
+    glBindImageTexture(layout::location(layout::ImageUnits::DAIS_Cache),
+                       cacheTexture, 0, GL_FALSE, 0, GL_READ_WRITE,
+                       GL_RGBA32UI);
+    glBindImageTexture(layout::location(layout::ImageUnits::DAIS_Locks),
+                       locksTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+}
 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, layout::location(binding), ssbo);
+void DeferredAttributeInterpolationShading::createStorageBuffers() {
+    logDebug("Creating triangle buffers...");
+
+    // Allocated by the render graph, which binds them before the first frame
+    getRenderGraph().addTransientBuffer(
+      "triangles", GL_SHADER_STORAGE_BUFFER,
+      layout::location(layout::ShaderStorageBuffers::DAIS_Triangles),
+      TRIANGLE_SIZE * MAX_TRIANGLE_COUNT);
+    getRenderGraph().addTransientBuffer(
+      "derivatives", GL_SHADER_STORAGE_BUFFER,
+      layout::location(layout::ShaderStorageBuffers::DAIS_Derivatives),
+      DERIVATIVES_SIZE * MAX_TRIANGLE_COUNT);
 }
 
 size_t DeferredAttributeInterpolationShading::customGui() {
@@ -296,7 +565,7 @@ size_t DeferredAttributeInterpolationShading::customGui() {
                 return 5;
         }
     };
-    static int choice = sizeToChoice(hashTableSize);
+    int choice = sizeToChoice(hashTableSize);
     constexpr auto hashTableSizeLabels = std::array{
       "256", "512", "1024", "2048", "4096", "8192", "16384", "32768"};
     constexpr auto choiceToSize
@@ -304,9 +573,80 @@ size_t DeferredAttributeInterpolationShading::customGui() {
 
     if (ImGui::Combo("Hash Table Size", &choice, hashTableSizeLabels.data(),
                      hashTableSizeLabels.size())) {
-        hashTableSize = choiceToSize[choice];
-        createHashTableResources();
+        setHashTableSize(choiceToSize[choice]);
+    }
+
+    int waysChoice = std::countr_zero(static_cast<unsigned>(cacheWays)) - 1;
+    constexpr auto waysLabels = std::array{"2", "4", "8"};
+    if (ImGui::Combo("Cache Ways", &waysChoice, waysLabels.data(),
+                     waysLabels.size())) {
+        setCacheWays(2 << waysChoice);
+    }
+    auto hashChoice = static_cast<int>(cacheHash);
+    constexpr auto hashLabels
+      = std::array{"Mask", "Multiplicative", "Murmur"};
+    if (ImGui::Combo("Cache Hash", &hashChoice, hashLabels.data(),
+                     hashLabels.size())) {
+        cacheHash = static_cast<CacheHash>(hashChoice);
+    }
+    auto probingChoice = static_cast<int>(cacheProbing);
+    constexpr auto probingLabels = std::array{"None", "Linear", "Quadratic"};
+    if (ImGui::Combo("Cache Probing", &probingChoice, probingLabels.data(),
+                     probingLabels.size())) {
+        cacheProbing = static_cast<CacheProbing>(probingChoice);
     }
-    return 1;
+    int numElements = 4;
+    if (options.at("ObjectSpaceShading")) {
+        auto pixelsPerSample = shadingCache.header.pixelsPerSample;
+        if (ImGui::SliderFloat("Pixels per shading sample", &pixelsPerSample,
+                               1.0f, 16.0f)) {
+            shadingCache.setPixelsPerSample(pixelsPerSample);
+        }
+        ImGui::Checkbox("Reuse shading across frames",
+                        &shadingCache.temporalReuse);
+        ImGui::Text("Shading reused for %d frames", shadingCache.epochAge);
+        numElements += 3;
+        // Every light movement starts a new epoch
+        if (Scene::get().lights.rotate) {
+            ImGui::Text("Rotating lights prevent reuse");
+            numElements++;
+        }
+    }
+    if (options.at("AdaptiveShadingRate")) {
+        ImGui::SliderFloat("Max shading variation", &maxShadingVariation,
+                           0.0f, 1.0f);
+        numElements++;
+    }
+    if (options.at("adaptiveHashTableSize")) {
+        ImGui::Text("Adaptive size: %u triangles stored, load factor %.2f",
+                    cacheCounters.triangleWriteIndex,
+                    cacheCounters.triangleWriteIndex / (2.0 * hashTableSize));
+        numElements++;
+    }
+    if (!options.at("CacheStatistics")) return numElements;
+
+    const auto& counters = cacheCounters;
+    const auto hits = static_cast<int64_t>(counters.lookups)
+                      - counters.insertions - counters.redundantStores;
+    ImGui::Text("Cache: %u lookups, hit rate %.2f %%", counters.lookups,
+                counters.lookups ? 100.0 * hits / counters.lookups : 0.0);
+    ImGui::Text("%u insertions, %u collisions, %u evictions",
+                counters.insertions, counters.collisions, counters.evictions);
+    ImGui::Text("%u redundant stores, %u triangles stored",
+                counters.redundantStores, counters.triangleWriteIndex);
+    if (!options.at("SubgroupDeduplication")) return numElements + 3;
+    ImGui::Text("%u lookups shared within subgroups", counters.sharedLookups);
+    return numElements + 4;
+}
+
+void DeferredAttributeInterpolationShading::setCacheWays(int ways) {
+    assert(ways == 2 || ways == 4 || ways == 8);
+    cacheWays = ways;
+}
+
+void DeferredAttributeInterpolationShading::setHashTableSize(GLsizei size) {
+    if (size == hashTableSize) return;
+    hashTableSize = size;
+    createHashTableResources();
 }
 } // namespace Algorithms
@@ -1,10 +1,17 @@
 #ifndef DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_DEFERRED_ATTRIBUTE_INTERPOLATION_SHADING
 #define DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_DEFERRED_ATTRIBUTE_INTERPOLATION_SHADING
 
+#include "algorithms/shading_cache.h"
+#include "algorithms/temporal_aa.h"
+#include "algorithms/tile_lists.h"
 #include "algorithms/uniform_buffer.h"
 #include <algorithm.h>
 
+#include <array>
+#include <cstddef>
+
 #include <glbinding/gl/gl.h>
+#include <glm/vec4.hpp>
 #include <layout_constants.h>
 
 namespace Algorithms {
@@ -13,48 +20,166 @@ class DeferredAttributeInterpolationShading
 {
     // NOLINTNEXTLINE(cert-err58-cpp)
     inline static const std::string name{"D.A.I.S."};
-    GLsizei hashTableSize = 8192; // TODO: make this a GUI parameter
+    // Texels of the cache, set in the GUI or by the adaptiveHashTableSize
+    // option
+    GLsizei hashTableSize = 8192;
+
+public:
+    // Values of the cacheHash and cacheProbing uniforms (dais_cache.glsl)
+    enum class CacheHash : GLuint
+    {
+        Mask,
+        Multiplicative,
+        Murmur
+    };
+    enum class CacheProbing : GLuint
+    {
+        None,
+        Linear,
+        Quadratic
+    };
+
+private:
+    // Entries per set of the memoization cache, 2, 4 or 8. A set is made of
+    // cacheWays / 2 texels, the capacity of the cache does not depend on the
+    // associativity.
+    int cacheWays = 2;
+    CacheHash cacheHash = CacheHash::Mask;
+    CacheProbing cacheProbing = CacheProbing::None;
 
     GLuint emptyVAO = 0;
     GLuint FBO = 0;
 
-    constexpr static size_t TRIANGLE_SIZE = 72;
+    // Triangle records of dais_triangle.glsl (std430)
+    struct Triangle
+    {
+        glm::vec4 vertices[3];
+        GLuint normalsSnormOct[3];
+        GLuint UVsUnorm[3];
+        GLuint padding[6];
+    };
+    static_assert(sizeof(Triangle) == 96);
+
+    // CompactTriangles option, clip-space z is reconstructed from w
+    struct CompactTriangle
+    {
+        GLfloat positionsXYW[9];
+        GLuint normalsSnormOct[3];
+        GLuint UVsUnorm[3];
+    };
+    static_assert(sizeof(CompactTriangle) == 60);
+    static_assert(offsetof(CompactTriangle, normalsSnormOct) == 36);
+    static_assert(offsetof(CompactTriangle, UVsUnorm) == 48);
+
+    constexpr static size_t TRIANGLE_SIZE = sizeof(Triangle);
+    constexpr static size_t COMPACT_TRIANGLE_SIZE = sizeof(CompactTriangle);
+    // std430 size of TriangleDerivatives, PackedTriangleDerivatives
+    // (PackedDerivatives option) has 48 bytes and fits in the same buffer
+    constexpr static size_t DERIVATIVES_SIZE = 96;
     constexpr static size_t MAX_TRIANGLE_COUNT = 1036800;
 
     struct UniformBufferData : public CommonUniformBufferData
     {
         glm::mat4x4 MVPInverse;
         glm::vec4 viewport;
-        /// @brief triangleID & bitwiseModHashSize == triangleID % hashTableSize
+        /// @brief hash & bitwiseModHashSize == hash % number of cache sets
         GLint bitwiseModHashSize;
         GLuint numTrianglesPerSphere;
         GLfloat projectionMatrix_32;
         GLfloat projectionMatrix_22;
         GLuint numSamples;
+        GLuint cacheTexelsPerSet;
+        CacheHash cacheHash;
+        CacheProbing cacheProbing;
+        GLfloat maxShadingVariation;
+        GLfloat padding[3];
     };
+    static_assert(sizeof(UniformBufferData) == 208);
     UniformBufferObject<UniformBufferData> uniformBuffer;
-    GLuint triangleSSBO = 0, derivativeSSBO = 0;
+
+    // Atomic counter buffer, the statistics are only counted with the
+    // CacheStatistics option
+    struct CacheCounters
+    {
+        GLuint triangleWriteIndex;
+        GLuint lookups;
+        GLuint insertions; // Triangles stored after a miss
+        GLuint collisions; // Insertions into a full home set
+        GLuint evictions;  // Insertions that dropped a valid entry
+        GLuint redundantStores; // Stored without inserting (lock timeout)
+        // SubgroupDeduplication option, served by the lookup of another
+        // fragment of the subgroup and not counted in lookups
+        GLuint sharedLookups;
+    };
     GLuint atomicCounterBuffer = 0;
 
+    // Copies of the atomic counter buffer, read once their fence is signaled
+    // so that the pipeline does not stall
+    struct CounterReadback
+    {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+    };
+    std::array<CounterReadback, 3> counterReadbacks;
+    size_t oldestCounterReadback = 0, numCounterReadbacksInFlight = 0;
+    // Values of the last finished readback, a few frames old
+    CacheCounters cacheCounters{};
+
+    // Adaptive hash table size: cache entries per stored triangle are kept
+    // between the load factors, shrinking only after SHRINK_DELAY readbacks
+    // in a row so that the table is not reallocated back and forth
+    constexpr static GLsizei MIN_HASH_TABLE_SIZE = 256;
+    constexpr static GLsizei MAX_HASH_TABLE_SIZE = 32768;
+    constexpr static float TARGET_LOAD_FACTOR = 0.5f;
+    constexpr static float MAX_LOAD_FACTOR = 0.75f;
+    constexpr static float MIN_LOAD_FACTOR = 0.125f;
+    constexpr static int SHRINK_DELAY = 30;
+    int oversizedReadbacks = 0;
+
     // Cache and Locks for geometry sampling stage.
     GLuint cacheTexture = 0, locksTexture = 0;
 
     GLuint triangleAddressFBOTexture = 0, triangleAddressFBOTextureMS = 0,
            FBOdepthTexture = 0;
 
+    // AdaptiveShadingRate option: pixels of triangles with low frequency
+    // lighting share a shading sample of up to COARSE_BLOCK_SIZE^2 pixels.
+    // maxShadingVariation is the largest change of the normal over a sample
+    // (radians, scaled by the square root of the light count). The texture
+    // is only allocated while the option is enabled.
+    constexpr static GLint COARSE_BLOCK_SIZE = 4;
+    GLuint coarseShadingTexture = 0;
+    glm::ivec2 coarseShadingResolution{0};
+    float maxShadingVariation = 0.25f;
+
+    TileLists tileLists;
+    ShadingCache shadingCache;
+
+    // Temporal anti-aliasing mode, set for all algorithms by the application
+    bool temporalAA = false;
+    TemporalAA taa;
+
     OptionsMap options;
     std::vector<RenderPass> renderPasses;
 
     uint8_t MSAASampleCount = 4;
 
     void createAtomicCounterBuffer();
+    // Maps the atomic counter buffer, waits for the geometry pass
+    GLuint getNumStoredTriangles();
     void createUniformBuffer() {
         logDebug("Creating settings uniform buffer...");
         uniformBuffer.initialize(layout::UniformBuffers::DAIS_Uniforms,
                                  std::nullopt);
     }
     void createHashTableResources();
-    void createSSBO(GLuint& ssbo, layout::ShaderStorageBuffers binding);
+    void createCounterReadbacks();
+    // Copies the counters of the previous frame and reads the finished
+    // copies, returns true if cacheCounters were updated
+    bool readCounters();
+    void adaptHashTableSize();
+    void bindHashTable();
+    void createStorageBuffers();
     void createFBO(const glm::ivec2& resolution);
 
     void resetHashTable();
@@ -64,11 +189,36 @@ public:
     size_t customGui();
 
     void setMSAASampleCount(uint8_t numSamples);
+
+    // Size has to be a power of two
+    void setHashTableSize(GLsizei size);
+    GLsizei getHashTableSize() const { return hashTableSize; }
+    void setCacheWays(int ways);
+    int getCacheWays() const { return cacheWays; }
+    void setCacheHash(CacheHash hash) { cacheHash = hash; }
+    CacheHash getCacheHash() const { return cacheHash; }
+    void setCacheProbing(CacheProbing probing) { cacheProbing = probing; }
+    CacheProbing getCacheProbing() const { return cacheProbing; }
     uint8_t getMSAASampleCount() const { return MSAASampleCount; }
+    bool isTemporalAAEnabled() const { return temporalAA; }
+    void setTemporalAA(bool enabled) {
+        temporalAA = enabled;
+        taa.invalidate();
+        reset();
+    }
+    // Memory of the history, color and motion textures
+    GLsizeiptr getTemporalAAMemorySize() const {
+        return temporalAA ? taa.getMemorySize() : 0;
+    }
 
     ~DeferredAttributeInterpolationShading();
 
-    void windowResized(const glm::ivec2& resolution) { createFBO(resolution); }
+    void windowResized(const glm::ivec2& resolution) {
+        createFBO(resolution);
+        tileLists.resize(resolution);
+        taa.resize(resolution);
+    }
+    void bindResources();
     void initialize();
     void debug(){};
 
@@ -23,6 +23,8 @@ void DeferredShading::initialize() {
     DECLARE_OPTION(restoreDepth, true);
     // DECLARE_SHADER_ONLY_OPTION(discardPixelsWithoutGeometry, true);
     DECLARE_OPTION(StoreCoverage, false);
+    // Only tiles with geometry are shaded
+    DECLARE_OPTION(TileClassification, false);
 
     logDebug("Initializing");
 
@@ -30,6 +32,8 @@ void DeferredShading::initialize() {
     uniformBuffer.initialize(layout::UniformBuffers::DS_Uniforms, std::nullopt);
 
     createGBuffer(Variables::WindowSize);
+    tileLists.resize(Variables::WindowSize);
+    taa.resize(Variables::WindowSize);
 
     glLineWidth(2.0);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
@@ -47,7 +51,8 @@ void DeferredShading::initialize() {
           // Warning: the buffer will be unmapped once `uniforms` goes out of
           // scope
       },
-      nullptr);
+      nullptr)
+      .writes({{"uniforms", ResourceUsage::BufferUpdate}});
 
     renderPasses.emplace_back(
       "Depth Pre-pass",
@@ -58,7 +63,10 @@ void DeferredShading::initialize() {
           Scene::get().update();
           Scene::get().spheres.render();
       },
-      "00_ds_depth_pre", &StoreCoverage);
+      "00_ds_depth_pre", &StoreCoverage)
+      .reads({{"uniforms", ResourceUsage::UniformBuffer}})
+      .writes({{"depth", ResourceUsage::Framebuffer},
+               {"lights", ResourceUsage::BufferUpdate}});
 
     // Add rendering passes
     renderPasses.emplace_back(
@@ -78,21 +86,67 @@ void DeferredShading::initialize() {
           Scene::get().spheres.render();
           glDepthFunc(GL_LEQUAL);
       },
-      "01_ds_gbuffer");
+      "01_ds_gbuffer")
+      .reads({{"uniforms", ResourceUsage::UniformBuffer},
+              {"depth", ResourceUsage::Framebuffer}})
+      .writes({{"depth", ResourceUsage::Framebuffer},
+               {"g-buffer color", ResourceUsage::Framebuffer},
+               {"g-buffer normal", ResourceUsage::Framebuffer},
+               {"g-buffer position", ResourceUsage::Framebuffer},
+               {"lights", ResourceUsage::BufferUpdate}});
+
+    renderPasses.emplace_back(
+      "Tile Classification", [this]() { tileLists.classify(); },
+      "01_ds_tile_classification", &TileClassification)
+      .reads({{"g-buffer position", ResourceUsage::Texture}})
+      .writes({{"tile list", ResourceUsage::BufferUpdate},
+               {"tile list", ResourceUsage::StorageBuffer}});
+
+    renderPasses.emplace_back(
+      "Motion Vectors",
+      [&]() -> void {
+          taa.update(Variables::Transform.UnjitteredModelViewProjection);
+          taa.dispatch();
+      },
+      "01_ds_motion_vectors", &temporalAA)
+      .reads({{"g-buffer position", ResourceUsage::Texture}})
+      .writes({{"taa uniforms", ResourceUsage::BufferUpdate},
+               {"motion vectors", ResourceUsage::Image}});
 
     renderPasses.emplace_back(
       "Deferred Shading",
-      [this]() {
+      [&]() {
           glBindFramebuffer(GL_FRAMEBUFFER, 0);
           glClear(GL_COLOR_BUFFER_BIT);
           glDisable(GL_DEPTH_TEST);
 
           glBindVertexArray(emptyVAO);
-          glDrawArrays(GL_TRIANGLES, 0, 3);
+          if (TileClassification)
+              tileLists.draw();
+          else
+              glDrawArrays(GL_TRIANGLES, 0, 3);
 
           glEnable(GL_DEPTH_TEST);
       },
-      "02_ds_deferred");
+      "02_ds_deferred")
+      .reads({{"uniforms", ResourceUsage::UniformBuffer},
+              {"g-buffer color", ResourceUsage::Texture},
+              {"g-buffer normal", ResourceUsage::Texture},
+              {"g-buffer position", ResourceUsage::Texture},
+              {"tile list", ResourceUsage::StorageBuffer},
+              {"tile list", ResourceUsage::Command},
+              {"lights", ResourceUsage::StorageBuffer}})
+      .writes({{RenderGraph::BackbufferColor, ResourceUsage::Framebuffer}});
+
+    renderPasses.emplace_back(
+      "Temporal Anti-Aliasing", [&]() -> void { taa.resolve(); },
+      "taa_resolve", &temporalAA)
+      .reads({{"taa uniforms", ResourceUsage::UniformBuffer},
+              {"motion vectors", ResourceUsage::Image},
+              {"taa history", ResourceUsage::Texture},
+              {RenderGraph::BackbufferColor, ResourceUsage::Framebuffer}})
+      .writes({{"taa history", ResourceUsage::Image},
+               {RenderGraph::BackbufferColor, ResourceUsage::Framebuffer}});
 
     renderPasses.emplace_back(
       "Restore Depth",
@@ -105,7 +159,9 @@ void DeferredShading::initialize() {
                             GL_DEPTH_BUFFER_BIT, GL_NEAREST);
           glBindFramebuffer(GL_FRAMEBUFFER, 0);
       },
-      &restoreDepth);
+      &restoreDepth)
+      .reads({{"depth", ResourceUsage::Framebuffer}})
+      .writes({{RenderGraph::BackbufferDepth, ResourceUsage::Framebuffer}});
 }
 
 void DeferredShading::showGBufferTextures() {
@@ -136,6 +192,7 @@ void DeferredShading::showGBufferTextures() {
 void DeferredShading::setMSAASampleCount(uint8_t numSamples) {
     MSAASampleCount = numSamples;
     createGBuffer(Variables::WindowSize);
+    selectPermutations();
 }
 
 template<bool MS>
@@ -184,7 +241,10 @@ void DeferredShading::createGBuffer(const glm::ivec2& resolution) {
     assert(glGetError() == GL_NO_ERROR);
     assert(glCheckNamedFramebufferStatus(gBufferFBO, GL_FRAMEBUFFER)
            == GL_FRAMEBUFFER_COMPLETE);
+}
 
+void DeferredShading::bindResources() {
+    uniformBuffer.bind();
     for (auto attachment : colorAttachments) {
         glBindTextureUnit(
           layout::location(
@@ -195,6 +255,9 @@ void DeferredShading::createGBuffer(const glm::ivec2& resolution) {
             layout::texSamplerForFBOAttachment<true>(attachment)),
           getTextureForAttachment<true>(attachment));
     }
+    tileLists.bind();
+    taa.bind();
+    glEnable(GL_DITHER);
 }
 
 } // namespace Algorithms
@@ -1,6 +1,8 @@
 #ifndef DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_DEFERRED_SHADING
 #define DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_DEFERRED_SHADING
 
+#include "algorithms/temporal_aa.h"
+#include "algorithms/tile_lists.h"
 #include "algorithms/uniform_buffer.h"
 #include <algorithm.h>
 
@@ -29,6 +31,12 @@ class DeferredShading : public Algorithm<DeferredShading>
     std::array<GLuint, colorAttachments.size()> colorTexturesMS{};
     GLuint depthStencilTex{};
 
+    TileLists tileLists;
+
+    // Temporal anti-aliasing mode, set for all algorithms by the application
+    bool temporalAA = false;
+    TemporalAA taa;
+
     struct UniformBufferData : public CommonUniformBufferData
     {
         GLuint numSamples;
@@ -47,12 +55,26 @@ public:
     uint8_t getMSAASampleCount() const { return MSAASampleCount; }
     void setMSAASampleCount(uint8_t numSamples);
 
+    bool isTemporalAAEnabled() const { return temporalAA; }
+    void setTemporalAA(bool enabled) {
+        temporalAA = enabled;
+        taa.invalidate();
+        reset();
+    }
+    // Memory of the history, color and motion textures
+    GLsizeiptr getTemporalAAMemorySize() const {
+        return temporalAA ? taa.getMemorySize() : 0;
+    }
+
     static size_t customGui() { return 0; }
 
     void windowResized(const glm::ivec2& resolution) {
         createGBuffer(resolution);
+        tileLists.resize(resolution);
+        taa.resize(resolution);
     }
     void initialize();
+    void bindResources();
     void debug() { showGBufferTextures(); };
 
     friend DeferredShading::AlgorithmCRTPBaseT;
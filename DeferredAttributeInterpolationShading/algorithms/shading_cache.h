@@ -0,0 +1,196 @@
+#ifndef DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_SHADING_CACHE
+#define DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_SHADING_CACHE
+
+#include "scene.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include <glbinding/gl/gl.h>
+
+#include <layout_constants.h>
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+using namespace gl;
+
+//-----------------------------------------------------------------------------
+// Name: ShadingCache
+// Desc: Object-space shading cache of D.A.I.S. (dais_shading_cache.glsl).
+//       Lighting of each stored triangle is evaluated at a barycentric
+//       lattice whose density follows the screen size of the triangle, the
+//       shading pass interpolates it for all pixels and samples. Lattices are
+//       kept per scene triangle during an epoch, which ends when the lights
+//       change or the camera moves further than maxCameraDistance. Moving
+//       lights (Scene lights.rotate, on by default) end it every frame, the
+//       cache only saves shading within the frame then.
+//-----------------------------------------------------------------------------
+struct ShadingCache
+{
+    // Lattice samples, 8 bytes each
+    constexpr static GLuint CAPACITY = 1 << 22;
+
+    // Buffer header followed by the samples
+    struct Header
+    {
+        GLuint numAllocatedTexels = 0;
+        GLuint capacity = CAPACITY;
+        GLuint epoch = 0;
+        GLfloat pixelsPerSample = 4.0f;
+    };
+    static_assert(sizeof(Header) == 16);
+
+    // Written by the geometry pass for each stored triangle
+    struct Record
+    {
+        GLfloat vertices[9];
+        GLuint triangleID;
+        GLuint block;
+        GLuint padding;
+    };
+    static_assert(sizeof(Record) == 48);
+
+    GLuint texelBuffer = 0, entryBuffer = 0, recordBuffer = 0;
+    // glDispatchComputeIndirect() arguments, the group count is copied from
+    // the triangle counter on the GPU
+    GLuint dispatchBuffer = 0;
+    Header header;
+    // Samples are reused while the camera stays this close to its position at
+    // the start of the epoch, the specular term depends on it
+    float maxCameraDistance = 0.05f;
+    bool temporalReuse = true;
+    int epochAge = 0; // Frames since the start of the epoch
+
+    ~ShadingCache() {
+        glDeleteBuffers(1, &texelBuffer);
+        glDeleteBuffers(1, &entryBuffer);
+        glDeleteBuffers(1, &recordBuffer);
+        glDeleteBuffers(1, &dispatchBuffer);
+    }
+
+    // Buffers are only allocated once the option is enabled
+    void allocate(GLsizeiptr maxTriangleCount) {
+        if (texelBuffer) return;
+        glCreateBuffers(1, &texelBuffer);
+        glNamedBufferStorage(
+          texelBuffer, sizeof(Header) + sizeof(GLuint) * 2 * CAPACITY, nullptr,
+          GL_DYNAMIC_STORAGE_BIT);
+        glCreateBuffers(1, &recordBuffer);
+        glNamedBufferStorage(recordBuffer, sizeof(Record) * maxTriangleCount,
+                             nullptr, BufferStorageMask::GL_NONE_BIT);
+        constexpr GLuint dispatchArguments[3] = {0, 1, 1};
+        glCreateBuffers(1, &dispatchBuffer);
+        glNamedBufferStorage(dispatchBuffer, sizeof(dispatchArguments),
+                             dispatchArguments,
+                             BufferStorageMask::GL_NONE_BIT);
+        invalidate();
+    }
+
+    // Releases the buffers once the option is disabled
+    void free() {
+        if (!texelBuffer) return;
+        glDeleteBuffers(1, &texelBuffer);
+        glDeleteBuffers(1, &entryBuffer);
+        glDeleteBuffers(1, &recordBuffer);
+        glDeleteBuffers(1, &dispatchBuffer);
+        texelBuffer = entryBuffer = recordBuffer = dispatchBuffer = 0;
+        numEntries = -1;
+        header.numAllocatedTexels = 0;
+        epochAge = 0;
+        invalidate();
+    }
+
+    void bind() const {
+        using layout::ShaderStorageBuffers;
+        glBindBufferBase(
+          GL_SHADER_STORAGE_BUFFER,
+          layout::location(ShaderStorageBuffers::DAIS_ShadingCache),
+          texelBuffer);
+        glBindBufferBase(
+          GL_SHADER_STORAGE_BUFFER,
+          layout::location(ShaderStorageBuffers::DAIS_ShadingCacheEntries),
+          entryBuffer);
+        glBindBufferBase(
+          GL_SHADER_STORAGE_BUFFER,
+          layout::location(ShaderStorageBuffers::DAIS_ShadingCacheRecords),
+          recordBuffer);
+    }
+
+    void setPixelsPerSample(float pixels) {
+        header.pixelsPerSample = pixels;
+        invalidate();
+    }
+
+    // Starts a new epoch if the scene or the camera changed, the lattices of
+    // the previous epochs are dropped
+    void update(const glm::vec3& cameraPosition) {
+        const auto& scene = Scene::get();
+        const auto& spheres = scene.spheres;
+        const auto numTriangles = static_cast<GLsizeiptr>(
+          spheres.sphereOffsets.size() * spheres.trianglesPerSphere);
+        if (numTriangles != numEntries) {
+            numEntries = numTriangles;
+            glDeleteBuffers(1, &entryBuffer);
+            glCreateBuffers(1, &entryBuffer);
+            // Epoch 0 is never current
+            glNamedBufferStorage(
+              entryBuffer,
+              sizeof(GLuint) * 2 * std::max(numEntries, GLsizeiptr{1}),
+              nullptr, BufferStorageMask::GL_NONE_BIT);
+            glClearNamedBufferData(entryBuffer, GL_R32UI, GL_RED_INTEGER,
+                                   GL_UNSIGNED_INT, nullptr);
+            bind();
+            invalidate();
+        }
+
+        const auto& lights = scene.lights;
+        const bool lightsChanged
+          = lights.numLights != epochNumLights
+            || !std::equal(lights.lights.begin(), lights.lights.end(),
+                           epochLights.begin(), epochLights.end(),
+                           [](const Light& a, const Light& b) {
+                               return a.position == b.position
+                                      && a.color == b.color;
+                           });
+        if (!temporalReuse || lightsChanged
+            || glm::distance(cameraPosition, epochCameraPosition)
+                 > maxCameraDistance)
+            invalidate();
+
+        if (invalidated) {
+            header.numAllocatedTexels = 0;
+            header.epoch++;
+            glNamedBufferSubData(texelBuffer, 0, sizeof(Header), &header);
+            epochCameraPosition = cameraPosition;
+            epochLights = lights.lights;
+            epochNumLights = lights.numLights;
+            epochAge = 0;
+            invalidated = false;
+        } else {
+            epochAge++;
+        }
+    }
+
+    // Shades the lattices of the stored triangles with the bound program,
+    // one workgroup per triangle. The count is read from counterBuffer on the
+    // GPU, the CPU doesn't wait for the geometry pass.
+    void shade(GLuint counterBuffer, GLintptr countOffset) const {
+        glCopyNamedBufferSubData(counterBuffer, dispatchBuffer, countOffset, 0,
+                                 sizeof(GLuint));
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatchBuffer);
+        glDispatchComputeIndirect(0);
+    }
+
+    void invalidate() { invalidated = true; }
+
+private:
+    GLsizeiptr numEntries = -1;
+    bool invalidated = true;
+    glm::vec3 epochCameraPosition{0.0f};
+    std::vector<Light> epochLights;
+    int epochNumLights = 0;
+};
+
+#endif /* DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_SHADING_CACHE */
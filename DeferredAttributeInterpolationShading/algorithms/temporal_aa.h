@@ -0,0 +1,170 @@
+#ifndef DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_TEMPORAL_AA
+#define DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_TEMPORAL_AA
+
+#include <array>
+#include <cstddef>
+
+#include <glbinding/gl/gl.h>
+
+#include <layout_constants.h>
+#include <tools.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+
+using namespace gl;
+
+//-----------------------------------------------------------------------------
+// Name: TemporalAA
+// Desc: Temporal anti-aliasing resolve (taa_resolve.comp), replaces MSAA.
+//       The projection is jittered by a sub-pixel offset every frame, the
+//       algorithm writes the screen-space motion of its visible surfaces and
+//       the resolve blends the shaded frame into the history reprojected by
+//       the motion. History colors are clamped to the neighbourhood of the
+//       pixel in the current frame, so disoccluded and changed surfaces do
+//       not ghost.
+//-----------------------------------------------------------------------------
+struct TemporalAA
+{
+    constexpr static GLint GROUP_SIZE = 16;
+    constexpr static size_t NUM_JITTER_SAMPLES = 8;
+
+    // std140 block of taa_resolve.comp and the motion vector passes
+    struct UniformBufferData
+    {
+        glm::mat4 previousMVP; // Unjittered, of the previous frame
+        glm::mat4 currentMVP;  // Unjittered
+        GLfloat blendFactor = 0.1f; // Weight of the current frame
+        GLuint historyValid = 0;
+        GLuint padding[2];
+    };
+    static_assert(sizeof(UniformBufferData) == 144);
+
+    // Shaded frame, motion (RG16F, UV units) and the ping-pong history
+    GLuint colorTexture = 0, motionTexture = 0, uniformBuffer = 0;
+    std::array<GLuint, 2> historyTextures{};
+    GLuint colorFBO = 0;
+    std::array<GLuint, 2> historyFBOs{};
+    UniformBufferData uniforms;
+    glm::ivec2 resolution{0};
+
+    ~TemporalAA() {
+        glDeleteFramebuffers(1, &colorFBO);
+        glDeleteFramebuffers(2, historyFBOs.data());
+        glDeleteTextures(1, &colorTexture);
+        glDeleteTextures(1, &motionTexture);
+        glDeleteTextures(2, historyTextures.data());
+        glDeleteBuffers(1, &uniformBuffer);
+    }
+
+    // Halton (2, 3) offset in pixels, [-0.5, 0.5)
+    static glm::vec2 getJitter(size_t frame) {
+        const auto halton = [](size_t index, size_t base) {
+            float result = 0.0f, fraction = 1.0f;
+            for (; index > 0; index /= base) {
+                fraction /= static_cast<float>(base);
+                result += fraction * static_cast<float>(index % base);
+            }
+            return result;
+        };
+        const size_t index = frame % NUM_JITTER_SAMPLES + 1;
+        return glm::vec2(halton(index, 2), halton(index, 3)) - 0.5f;
+    }
+
+    void resize(const glm::ivec2& resolution) {
+        this->resolution = resolution;
+        Tools::Texture::Create2D(colorTexture, GL_RGBA8, resolution);
+        Tools::Texture::Create2D(motionTexture, GL_RG16F, resolution);
+        glDeleteFramebuffers(1, &colorFBO);
+        glCreateFramebuffers(1, &colorFBO);
+        glNamedFramebufferTexture(colorFBO, GL_COLOR_ATTACHMENT0, colorTexture,
+                                  0);
+
+        glDeleteFramebuffers(2, historyFBOs.data());
+        glCreateFramebuffers(2, historyFBOs.data());
+        for (size_t i = 0; i < historyTextures.size(); i++) {
+            Tools::Texture::Create2D(historyTextures[i], GL_RGBA8, resolution);
+            // Reprojected history is sampled between the texels
+            glTextureParameteri(historyTextures[i], GL_TEXTURE_MIN_FILTER,
+                                GL_LINEAR);
+            glTextureParameteri(historyTextures[i], GL_TEXTURE_MAG_FILTER,
+                                GL_LINEAR);
+            glTextureParameteri(historyTextures[i], GL_TEXTURE_WRAP_S,
+                                GL_CLAMP_TO_EDGE);
+            glTextureParameteri(historyTextures[i], GL_TEXTURE_WRAP_T,
+                                GL_CLAMP_TO_EDGE);
+            glNamedFramebufferTexture(historyFBOs[i], GL_COLOR_ATTACHMENT0,
+                                      historyTextures[i], 0);
+        }
+
+        if (!uniformBuffer) {
+            glCreateBuffers(1, &uniformBuffer);
+            glNamedBufferStorage(uniformBuffer, sizeof(UniformBufferData),
+                                 nullptr, GL_DYNAMIC_STORAGE_BIT);
+        }
+        invalidate();
+    }
+
+    void bind() const {
+        glBindBufferBase(
+          GL_UNIFORM_BUFFER,
+          layout::location(layout::UniformBuffers::TAA_Uniforms),
+          uniformBuffer);
+        glBindImageTexture(layout::location(layout::ImageUnits::TAA_Motion),
+                           motionTexture, 0, GL_FALSE, 0, GL_READ_WRITE,
+                           GL_RG16F);
+        glBindTextureUnit(layout::location(layout::TextureUnits::TAA_Color),
+                          colorTexture);
+        glBindTextureUnit(layout::location(layout::TextureUnits::TAA_History),
+                          historyTextures[1 - current]);
+        glBindImageTexture(layout::location(layout::ImageUnits::TAA_History),
+                           historyTextures[current], 0, GL_FALSE, 0,
+                           GL_WRITE_ONLY, GL_RGBA8);
+    }
+
+    // Uploads the matrices of the frame, called before its motion vectors are
+    // written
+    void update(const glm::mat4& unjitteredMVP) {
+        uniforms.previousMVP
+          = uniforms.historyValid ? uniforms.currentMVP : unjitteredMVP;
+        uniforms.currentMVP = unjitteredMVP;
+        glNamedBufferSubData(uniformBuffer, 0, sizeof(UniformBufferData),
+                             &uniforms);
+    }
+
+    // Dispatches the bound program once per pixel
+    void dispatch() const {
+        const auto numGroups = (resolution + GROUP_SIZE - 1) / GROUP_SIZE;
+        glDispatchCompute(numGroups.x, numGroups.y, 1);
+    }
+
+    // Dispatches the bound resolve program for the frame in the default
+    // framebuffer and replaces the frame with the new history
+    void resolve() {
+        glBlitNamedFramebuffer(0, colorFBO, 0, 0, resolution.x, resolution.y,
+                               0, 0, resolution.x, resolution.y,
+                               GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        dispatch();
+        glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+        glBlitNamedFramebuffer(historyFBOs[current], 0, 0, 0, resolution.x,
+                               resolution.y, 0, 0, resolution.x, resolution.y,
+                               GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+        current = 1 - current;
+        uniforms.historyValid = 1;
+    }
+
+    // History is dropped, e.g. after a resize or a change of the algorithm
+    void invalidate() { uniforms.historyValid = 0; }
+
+    // Memory of the textures, not counted by the render graph
+    GLsizeiptr getMemorySize() const {
+        // RGBA8 color and histories, RG16F motion
+        return static_cast<GLsizeiptr>(resolution.x) * resolution.y * 4 * 4;
+    }
+
+private:
+    size_t current = 0; // History written in this frame
+};
+
+#endif /* DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_TEMPORAL_AA */
@@ -0,0 +1,74 @@
+#ifndef DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_TILE_LISTS
+#define DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_TILE_LISTS
+
+#include <glbinding/gl/gl.h>
+
+#include <layout_constants.h>
+
+#include <glm/vec2.hpp>
+
+using namespace gl;
+
+//-----------------------------------------------------------------------------
+// Name: TileLists
+// Desc: Screen tiles containing geometry (tile_lists.glsl). A classification
+//       compute pass appends the tiles, the shading pass draws them as
+//       instanced quads instead of a full-screen triangle, so empty parts of
+//       the screen are not shaded.
+//-----------------------------------------------------------------------------
+struct TileLists
+{
+    constexpr static GLint TILE_SIZE = 16;
+
+    // Buffer header, glDrawArraysIndirect() command followed by the grid
+    struct Header
+    {
+        GLuint vertexCount = 6; // Quad made of two triangles
+        GLuint instanceCount = 0;
+        GLuint firstVertex = 0;
+        GLuint baseInstance = 0;
+        glm::uvec2 numTiles{0};
+        glm::uvec2 resolution{0};
+    };
+    static_assert(sizeof(Header) == 32);
+
+    GLuint buffer = 0;
+    Header header;
+
+    ~TileLists() { glDeleteBuffers(1, &buffer); }
+
+    void resize(const glm::ivec2& resolution) {
+        header.resolution = resolution;
+        header.numTiles = (resolution + TILE_SIZE - 1) / TILE_SIZE;
+        // (tile, triangle) pairs
+        const auto size = static_cast<GLsizeiptr>(
+          sizeof(Header)
+          + sizeof(glm::uvec2) * header.numTiles.x * header.numTiles.y);
+
+        glDeleteBuffers(1, &buffer);
+        glCreateBuffers(1, &buffer);
+        glNamedBufferStorage(buffer, size, &header, GL_DYNAMIC_STORAGE_BIT);
+    }
+
+    void bind() const {
+        glBindBufferBase(
+          GL_SHADER_STORAGE_BUFFER,
+          layout::location(layout::ShaderStorageBuffers::TileLists), buffer);
+    }
+
+    // Empties the list and classifies the tiles with the bound program,
+    // one workgroup per tile
+    void classify() const {
+        glNamedBufferSubData(buffer, 0, sizeof(Header), &header);
+        glDispatchCompute(header.numTiles.x, header.numTiles.y, 1);
+    }
+
+    // Draws the classified tiles with the bound program
+    void draw() const {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+        glDrawArraysIndirect(GL_TRIANGLES, nullptr);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+};
+
+#endif /* DEFERREDATTRIBUTEINTERPOLATIONSHADING_ALGORITHMS_TILE_LISTS */
@@ -6,6 +6,7 @@
 #include <spdlog/spdlog.h>
 
 #include <layout_constants.h>
+#include <trace.h>
 
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
@@ -30,6 +31,10 @@ struct UniformBufferObject
         glNamedBufferStorage(buffer, sizeof(DataT),
                              initialData ? &initialData : nullptr,
                              GL_CLIENT_STORAGE_BIT | GL_MAP_WRITE_BIT);
+        bind();
+    }
+
+    void bind() const {
         glBindBufferBase(GL_UNIFORM_BUFFER, layout::location(binding), buffer);
     }
 
@@ -50,6 +55,7 @@ struct UniformBufferObject
           = delete;
 
         ~UniformBufferWriteRef() {
+            Tools::TraceScope traceScope("UniformBufferObject::unmap");
             if (glUnmapNamedBuffer(parent.buffer) != GL_TRUE) {
                 spdlog::warn(
                   "Uniform buffer data store contents have become corrupt "
@@ -75,6 +81,8 @@ struct UniformBufferObject
 
     UniformBufferWriteRef mapForWrite(BufferAccessMask additionalAccessFlags
                                       = BufferAccessMask::GL_NONE_BIT) {
+        // Mapping waits for the GPU if the buffer is still in use
+        Tools::TraceScope traceScope("UniformBufferObject::mapForWrite");
         return UniformBufferWriteRef(
           *this, static_cast<DataT*>(glMapNamedBufferRange(
                    buffer, 0, sizeof(DataT),
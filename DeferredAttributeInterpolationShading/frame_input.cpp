@@ -0,0 +1,135 @@
+#include "frame_input.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <common.h>
+
+#include <spdlog/spdlog.h>
+
+FrameInput captureFrameInput(uint8_t msaaSampleCount) {
+    const auto& scene = Scene::get();
+    FrameInput input{};
+    input.camera = Variables::Transform.Camera.getState();
+    input.sceneRotation = Variables::Transform.SceneRotation;
+    input.sceneZOffset = Variables::Transform.SceneZOffset;
+    input.windowSize = Variables::WindowSize;
+    input.lightSeed = scene.lights.seed;
+    input.numLights = scene.lights.numLights;
+    input.lightRangeLimits = scene.lights.rangeLimits;
+    input.lightRotationSpeed = scene.lights.rotationSpeed;
+    input.lightsRotate = scene.lights.rotate ? 1 : 0;
+    input.msaaSampleCount = msaaSampleCount;
+    input.numSpheresPerRow = scene.spheres.numSpheresPerRow;
+    input.numSphereSlices = scene.spheres.numSphereSlices;
+    return input;
+}
+
+bool applyFrameInput(const FrameInput& input, bool forceLightsCreate) {
+    auto& scene = Scene::get();
+    auto& lights = scene.lights;
+    auto& spheres = scene.spheres;
+
+    if (input.windowSize != Variables::WindowSize) {
+        glfwSetWindowSize(Variables::Window, input.windowSize.x,
+                          input.windowSize.y);
+        // Resize events may be delivered later, the size is needed now
+        Callbacks::WindowSizeChanged(Variables::Window, input.windowSize.x,
+                                     input.windowSize.y);
+    }
+    Variables::Transform.Camera.setState(input.camera);
+    Variables::Transform.SceneRotation = input.sceneRotation;
+    Variables::Transform.SceneZOffset = input.sceneZOffset;
+    Variables::Transform.update();
+
+    // Same operations as the ones done by the GUI when the values change
+    bool changed = false;
+    if (forceLightsCreate || input.lightSeed != lights.seed
+        || input.numLights != lights.numLights
+        || input.numSpheresPerRow != spheres.numSpheresPerRow) {
+        lights.seed = input.lightSeed;
+        lights.numLights = input.numLights;
+        lights.rangeLimits = input.lightRangeLimits;
+        spheres.numSpheresPerRow = input.numSpheresPerRow;
+        lights.create(static_cast<float>(input.numSpheresPerRow));
+        changed = true;
+    } else if (input.lightRangeLimits != lights.rangeLimits) {
+        lights.rangeLimits = input.lightRangeLimits;
+        lights.genRandomRadiuses();
+        changed = true;
+    }
+    lights.rotationSpeed = input.lightRotationSpeed;
+    lights.rotate = input.lightsRotate != 0;
+
+    if (input.numSphereSlices != spheres.numSphereSlices) {
+        spheres.numSphereSlices = input.numSphereSlices;
+        changed = true;
+    }
+    spheres.updateGeometry();
+    return changed;
+}
+
+bool FrameInputRecorder::startRecording(const std::string& fileName) {
+    stop();
+    file.open(fileName, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        spdlog::error("Unable to create frame input recording {}", fileName);
+        return false;
+    }
+    Header header{};
+    std::copy(std::begin(Magic), std::end(Magic), header.magic);
+    header.version = Version;
+    header.frameSize = sizeof(FrameInput);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    mode = Mode::Recording;
+    spdlog::info("Recording frame inputs to {}", fileName);
+    return true;
+}
+
+bool FrameInputRecorder::startReplay(const std::string& fileName) {
+    stop();
+    std::ifstream input(fileName, std::ios::binary);
+    Header header{};
+    if (!input.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+        spdlog::error("{} is not a frame input recording", fileName);
+        return false;
+    }
+    if (header.version != Version || header.frameSize != sizeof(FrameInput)) {
+        spdlog::error("Frame input recording {} has unsupported version {}",
+                      fileName, header.version);
+        return false;
+    }
+
+    FrameInput frameInput{};
+    while (input.read(reinterpret_cast<char*>(&frameInput), sizeof(frameInput)))
+        frames.push_back(frameInput);
+
+    mode = Mode::Replaying;
+    spdlog::info("Replaying {} frames from {}", frames.size(), fileName);
+    return true;
+}
+
+void FrameInputRecorder::stop() {
+    if (mode == Mode::Recording)
+        spdlog::info("Recorded {} frames", frame);
+    else if (mode == Mode::Replaying)
+        spdlog::info("Replayed {} of {} frames", frame, frames.size());
+    file.close();
+    frames.clear();
+    frame = 0;
+    mode = Mode::Off;
+}
+
+void FrameInputRecorder::record(const FrameInput& input) {
+    if (mode != Mode::Recording) return;
+    file.write(reinterpret_cast<const char*>(&input), sizeof(input));
+    frame++;
+}
+
+const FrameInput* FrameInputRecorder::next() {
+    if (mode != Mode::Replaying || frame >= frames.size()) return nullptr;
+    return &frames[frame++];
+}
@@ -0,0 +1,97 @@
+#ifndef DEFERREDATTRIBUTEINTERPOLATIONSHADING_FRAME_INPUT
+#define DEFERREDATTRIBUTEINTERPOLATIONSHADING_FRAME_INPUT
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <camera.h>
+
+// Everything that determines the rendered frame, recorded at the beginning of
+// every frame. Light positions are not stored, they are given by the seed and
+// the rotation in all previous frames.
+struct FrameInput
+{
+    Tools::Camera::State camera;
+    glm::vec4 sceneRotation;
+    float sceneZOffset;
+    glm::ivec2 windowSize;
+
+    uint32_t lightSeed;
+    int32_t numLights;
+    glm::vec2 lightRangeLimits;
+    float lightRotationSpeed;
+    uint8_t lightsRotate;
+
+    uint8_t msaaSampleCount;
+    int32_t numSpheresPerRow;
+    int32_t numSphereSlices;
+};
+static_assert(std::is_trivially_copyable_v<FrameInput>);
+
+// Returns inputs of the current frame
+FrameInput captureFrameInput(uint8_t msaaSampleCount);
+
+// Sets scene, camera and window size to the recorded state. Lights are
+// recreated from the seed if forced or if their layout changed. Returns true
+// if the scene geometry changed.
+bool applyFrameInput(const FrameInput& input, bool forceLightsCreate = false);
+
+//-----------------------------------------------------------------------------
+// Name: FrameInputRecorder
+// Desc: Records inputs of every frame into a binary file and replays them, so
+//       that benchmark runs render identical frames. The file contains a
+//       header followed by FrameInput of every frame (native byte order).
+//-----------------------------------------------------------------------------
+class FrameInputRecorder
+{
+public:
+    enum class Mode
+    {
+        Off,
+        Recording,
+        Replaying
+    };
+
+    bool startRecording(const std::string& fileName);
+
+    // Loads the whole recording
+    bool startReplay(const std::string& fileName);
+
+    void stop();
+
+    // Appends inputs of the current frame to the recording
+    void record(const FrameInput& input);
+
+    // Returns inputs of the next replayed frame, nullptr once all frames have
+    // been replayed
+    const FrameInput* next();
+
+    Mode getMode() const { return mode; }
+
+    // Index of the recorded/replayed frame and number of recorded frames
+    size_t getFrame() const { return frame; }
+    size_t getNumFrames() const { return frames.size(); }
+
+private:
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t frameSize;
+    };
+    static constexpr char Magic[4] = {'D', 'A', 'F', 'I'};
+    static constexpr uint32_t Version = 1;
+
+    Mode mode = Mode::Off;
+    std::ofstream file;
+    std::vector<FrameInput> frames;
+    size_t frame = 0;
+};
+
+#endif /* DEFERREDATTRIBUTEINTERPOLATIONSHADING_FRAME_INPUT */
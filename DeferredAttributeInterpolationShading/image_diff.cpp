@@ -0,0 +1,179 @@
+#include "image_diff.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <limits>
+
+#include <common.h>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+ImageDifference compareImages(const unsigned char* image,
+                              const unsigned char* reference, size_t numPixels,
+                              std::vector<unsigned char>* diffImage) {
+    // Differences are amplified to be visible in the diff image
+    constexpr int DiffScale = 8;
+
+    ImageDifference result;
+    if (diffImage) diffImage->assign(numPixels * 4, 255);
+    uint64_t squaredErrorSum = 0;
+    for (size_t pixel = 0; pixel < numPixels; pixel++) {
+        bool different = false;
+        for (size_t channel = 0; channel < 3; channel++) {
+            const size_t i = pixel * 4 + channel;
+            const int error = std::abs(static_cast<int>(image[i])
+                                       - static_cast<int>(reference[i]));
+            squaredErrorSum += static_cast<uint64_t>(error * error);
+            result.maxError = std::max(result.maxError, error);
+            different |= error != 0;
+            if (diffImage)
+                (*diffImage)[i] = static_cast<unsigned char>(
+                  std::min(error * DiffScale, 255));
+        }
+        if (different) result.numDifferentPixels++;
+    }
+
+    const double meanSquaredError
+      = static_cast<double>(squaredErrorSum) / (3.0 * numPixels);
+    result.psnr = meanSquaredError > 0.0
+                    ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError)
+                    : std::numeric_limits<double>::infinity();
+    return result;
+}
+
+bool ImageDiffRunner::start(std::string replayFileName,
+                            std::string referenceDirectory, double minPSNR,
+                            std::vector<Variant> variants) {
+    std::error_code error;
+    std::filesystem::create_directories(
+      std::filesystem::path(referenceDirectory) / "diff", error);
+    const auto reportFileName
+      = (std::filesystem::path(referenceDirectory) / "image_diff.csv")
+          .string();
+    report.open(reportFileName);
+    if (error || !report) {
+        spdlog::error("Unable to create image diff report {}", reportFileName);
+        return false;
+    }
+    report << "variant,frame,psnr [dB],max error,different pixels\n";
+
+    this->replayFileName = std::move(replayFileName);
+    this->referenceDirectory = std::move(referenceDirectory);
+    this->minPSNR = minPSNR;
+    this->variants = std::move(variants);
+    readback = std::make_unique<Tools::AsyncReadback>();
+    variant = 0;
+    started = false;
+    failed = false;
+    running = !this->variants.empty();
+    return running;
+}
+
+void ImageDiffRunner::stop() {
+    readback.reset();
+    report.close();
+    running = false;
+}
+
+const ImageDiffRunner::Variant* ImageDiffRunner::nextVariant() {
+    if (!running) return nullptr;
+
+    if (started) {
+        processReadbacks(true);
+        spdlog::info("Image diff {}: {} frames, min PSNR {:.2f} dB, max error "
+                     "{}",
+                     getVariant().name, numFrames, variantMinPSNR,
+                     variantMaxError);
+        variant++;
+    }
+    started = true;
+    if (variant == variants.size()) {
+        spdlog::log(failed ? spdlog::level::err : spdlog::level::info,
+                    "Image diff {}", failed ? "FAILED" : "passed");
+        stop();
+        return nullptr;
+    }
+
+    variantMinPSNR = std::numeric_limits<double>::infinity();
+    variantMaxError = 0;
+    numFrames = 0;
+    return &variants[variant];
+}
+
+void ImageDiffRunner::captureFrame(int frame, const glm::ivec2& size) {
+    GLint readFramebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    readback->read(frame, 0, 0, size.x, size.y);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+}
+
+void ImageDiffRunner::processReadbacks(bool wait) {
+    Tools::AsyncReadback::Image image;
+    while (readback && readback->get(image, wait)) compare(image);
+}
+
+void ImageDiffRunner::compare(const Tools::AsyncReadback::Image& image) {
+    const auto& current = getVariant();
+    if (image.id <= current.warmupFrames) return;
+    const auto referencePath
+      = std::filesystem::path(referenceDirectory)
+        / (current.temporalAA
+             ? fmt::format("taa_frame_{}.png", image.id)
+             : fmt::format("msaa{}_frame_{}.png", current.msaaSampleCount,
+                           image.id));
+    const auto referenceFileName = referencePath.string();
+
+    int width = 0, height = 0, channels = 0;
+    unsigned char* reference = stbi_load(referenceFileName.c_str(), &width,
+                                         &height, &channels, 4);
+    if (!reference) {
+        stbi_write_png(referenceFileName.c_str(), image.width, image.height, 4,
+                       image.pixels.data(), 4 * image.width);
+        spdlog::debug("Reference {} created by {}", referenceFileName,
+                      current.name);
+        return;
+    }
+
+    numFrames++;
+    ImageDifference difference;
+    std::vector<unsigned char> diffImage;
+    if (width != image.width || height != image.height) {
+        spdlog::error("Reference {} has resolution {}x{}, frame has {}x{}",
+                      referenceFileName, width, height, image.width,
+                      image.height);
+        difference.maxError = 255;
+        difference.numDifferentPixels
+          = static_cast<size_t>(image.width) * image.height;
+    } else {
+        difference
+          = compareImages(image.pixels.data(), reference,
+                          static_cast<size_t>(width) * height, &diffImage);
+    }
+    stbi_image_free(reference);
+
+    if (difference.numDifferentPixels > 0 && !diffImage.empty()) {
+        const auto diffFileName
+          = (std::filesystem::path(referenceDirectory) / "diff"
+             / fmt::format("{}_frame_{}.png", current.name, image.id))
+              .string();
+        stbi_write_png(diffFileName.c_str(), image.width, image.height, 4,
+                       diffImage.data(), 4 * image.width);
+    }
+
+    report << fmt::format("{},{},{:.3f},{},{}\n", current.name, image.id,
+                          difference.psnr, difference.maxError,
+                          difference.numDifferentPixels);
+    variantMinPSNR = std::min(variantMinPSNR, difference.psnr);
+    variantMaxError = std::max(variantMaxError, difference.maxError);
+    const double threshold = current.minPSNR > 0.0 ? current.minPSNR : minPSNR;
+    if (difference.psnr < threshold) {
+        failed = true;
+        spdlog::warn("Image diff {} frame {}: PSNR {:.2f} dB is below {:.2f} "
+                     "dB",
+                     current.name, image.id, difference.psnr, threshold);
+    }
+}
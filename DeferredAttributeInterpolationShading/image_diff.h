@@ -0,0 +1,106 @@
+#ifndef DEFERREDATTRIBUTEINTERPOLATIONSHADING_IMAGE_DIFF
+#define DEFERREDATTRIBUTEINTERPOLATIONSHADING_IMAGE_DIFF
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include <tools.h>
+
+struct ImageDifference
+{
+    double psnr = 0.0; // Peak signal-to-noise ratio of RGB [dB], inf if equal
+    int maxError = 0;  // Maximal difference of a color channel
+    size_t numDifferentPixels = 0;
+};
+
+// Compares RGBA8 images, alpha is ignored. If diffImage is not null, it is
+// filled with the amplified absolute difference.
+ImageDifference compareImages(const unsigned char* image,
+                              const unsigned char* reference, size_t numPixels,
+                              std::vector<unsigned char>* diffImage = nullptr);
+
+//-----------------------------------------------------------------------------
+// Name: ImageDiffRunner
+// Desc: Correctness check of the algorithms. The same recorded frames are
+//       replayed by every variant (algorithm, its options and MSAA sample
+//       count or TAA), frames are read back asynchronously and compared with
+//       reference images ("<reference dir>/msaa<samples>_frame_<frame>.png",
+//       "<reference dir>/taa_frame_<frame>.png").
+//       Missing references are created from the first variant rendering
+//       them. Results of all frames are written to
+//       "<reference dir>/image_diff.csv", diff images of differing frames to
+//       "<reference dir>/diff".
+//-----------------------------------------------------------------------------
+class ImageDiffRunner
+{
+public:
+    struct Variant
+    {
+        int algorithm;
+        uint8_t msaaSampleCount;
+        std::string name;
+        // Algorithm options set before the frames are replayed
+        std::vector<std::pair<std::string, bool>> options;
+        // D.A.I.S. only, index into SweepRunner::getCacheHashNames() and
+        // getCacheProbingNames()
+        int cacheHash = 0;
+        int cacheProbing = 0;
+        // Threshold of lossy variants, 0 = the one given to start()
+        double minPSNR = 0.0;
+        // Temporal anti-aliasing (msaaSampleCount is 0), the first
+        // warmupFrames frames accumulate the history and are not compared
+        bool temporalAA = false;
+        int warmupFrames = 0;
+    };
+
+    bool start(std::string replayFileName, std::string referenceDirectory,
+               double minPSNR, std::vector<Variant> variants);
+
+    // Releases OpenGL objects, unfinished readbacks are not compared
+    void stop();
+
+    // Finishes the current variant and returns the next one, nullptr once all
+    // variants were replayed
+    const Variant* nextVariant();
+
+    // Reads back the frame rendered into the default framebuffer
+    void captureFrame(int frame, const glm::ivec2& size);
+
+    // Compares frames whose readback has finished
+    void processReadbacks(bool wait = false);
+
+    bool isRunning() const { return running; }
+    bool hasFailed() const { return failed; }
+
+    const std::string& getReplayFileName() const { return replayFileName; }
+    const Variant& getVariant() const { return variants[variant]; }
+
+private:
+    void compare(const Tools::AsyncReadback::Image& image);
+
+    std::string replayFileName;
+    std::string referenceDirectory;
+    double minPSNR = 0.0;
+    std::vector<Variant> variants;
+
+    bool running = false;
+    bool failed = false;
+    size_t variant = 0;
+    bool started = false; // The first variant was started
+
+    // Worst results of the current variant
+    double variantMinPSNR = 0.0;
+    int variantMaxError = 0;
+    int numFrames = 0;
+
+    std::unique_ptr<Tools::AsyncReadback> readback;
+    std::ofstream report;
+};
+
+#endif /* DEFERREDATTRIBUTEINTERPOLATIONSHADING_IMAGE_DIFF */
@@ -2,6 +2,7 @@
 #define DEFERREDATTRIBUTEINTERPOLATIONSHADING_LAYOUT_CONSTANTS
 
 #include <glbinding/gl/gl.h>
+#include <type_traits>
 
 namespace layout {
 using namespace gl;
@@ -15,14 +16,19 @@ enum class UniformBuffers : GLuint
 {
     SphereOffsets = 0,
     DAIS_Uniforms,
-    DS_Uniforms
+    DS_Uniforms,
+    TAA_Uniforms
 };
 
 enum class ShaderStorageBuffers : GLuint
 {
     DAIS_Triangles = 0,
     DAIS_Derivatives,
-    Lights
+    Lights,
+    TileLists,
+    DAIS_ShadingCache,
+    DAIS_ShadingCacheEntries,
+    DAIS_ShadingCacheRecords
 };
 
 enum class TextureUnits : GLuint
@@ -36,12 +42,17 @@ enum class TextureUnits : GLuint
     DS_Color_DAIS_TriangleAddressMS,
     DS_NormalMS,
     DS_VertexMS,
+    TAA_Color,
+    TAA_History,
 };
 
 enum class ImageUnits : GLuint
 {
     DAIS_Cache = 0,
     DAIS_Locks,
+    DAIS_CoarseShading,
+    TAA_History,
+    TAA_Motion,
 };
 
 template<bool MS>
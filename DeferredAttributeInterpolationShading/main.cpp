@@ -2,7 +2,11 @@
 #include "common.h"
 #include "algorithms/deferred_shading.h"
 #include "algorithms/deferred_attribute_interpolation_shading.h"
+#include "frame_input.h"
+#include "image_diff.h"
 #include "scene.h"
+#include "sweep.h"
+#include <tuple>
 #include <variant>
 
 #include <spdlog/spdlog.h>
@@ -11,7 +15,11 @@ namespace Algorithms {
 using DAISUniquePtr = std::unique_ptr<DeferredAttributeInterpolationShading>;
 using DSUniquePtr = std::unique_ptr<DeferredShading>;
 
-using Variant = std::variant<DSUniquePtr, DAISUniquePtr>;
+// Created algorithms, in the order of AlgorithmsEnum
+using Storage = std::tuple<DSUniquePtr, DAISUniquePtr>;
+// Non-owning reference to one of the algorithms
+using Variant
+  = std::variant<DeferredShading*, DeferredAttributeInterpolationShading*>;
 } // namespace Algorithms
 
 enum class AlgorithmsEnum : int
@@ -20,14 +28,275 @@ enum class AlgorithmsEnum : int
     DAIS = 1,
 };
 
-Algorithms::Variant g_AlgorithmVariant{
-  std::make_unique<Algorithms::DeferredShading>()};
+Algorithms::Storage g_Algorithms;
+Algorithms::Variant g_AlgorithmVariant; // Displayed algorithm
 
 bool g_ExplicitTimerSync = false; // Explicit synchronization will be made
                                   // before any performance measurement
+bool g_KeepAlgorithmsResident = false; // Algorithms are not destroyed when
+                                       // switching between them
+bool g_CompareAlgorithms = false; // All algorithms are rendered every frame
+uint8_t g_MSAASampleCount = 4;    // MSAA sample count of all algorithms
+bool g_TemporalAA = false;        // Temporal anti-aliasing of all algorithms
+size_t g_TemporalAAFrame = 0;     // Index of the projection jitter
+FrameInputRecorder g_FrameInputs; // Recording/replay of frame inputs
+SweepRunner g_Sweep;              // Parameter sweep (scaling studies)
+std::string g_SweepGridFile;      // Sweep started after initialization
+std::string g_SweepOutputFile = "sweep.csv";
+ImageDiffRunner g_ImageDiff; // Correctness check of replayed frames
+
+// Calls func for all created algorithms
+template<typename Func>
+void forEachAlgorithm(Func&& func) {
+    std::apply(
+      [&](auto&... algos) { ((algos ? func(algos.get()) : void()), ...); },
+      g_Algorithms);
+}
+
+// Returns the algorithm, creates and initializes it on first use
+template<AlgorithmsEnum Algorithm>
+auto* getAlgorithm() {
+    auto& algo = std::get<static_cast<size_t>(Algorithm)>(g_Algorithms);
+    if (!algo) {
+        algo = std::make_unique<
+          typename std::decay_t<decltype(algo)>::element_type>();
+        algo->initialize();
+        if (algo->getMSAASampleCount() != g_MSAASampleCount)
+            algo->setMSAASampleCount(g_MSAASampleCount);
+        if (algo->isTemporalAAEnabled() != g_TemporalAA)
+            algo->setTemporalAA(g_TemporalAA);
+    }
+    return algo.get();
+}
+
+Algorithms::Variant getAlgorithmVariant(AlgorithmsEnum algorithm) {
+    switch (algorithm) {
+        case AlgorithmsEnum::DS:
+            return getAlgorithm<AlgorithmsEnum::DS>();
+        case AlgorithmsEnum::DAIS:
+            return getAlgorithm<AlgorithmsEnum::DAIS>();
+    }
+    return getAlgorithm<AlgorithmsEnum::DS>();
+}
+
+// Destroys all algorithms except the displayed one
+void destroyInactiveAlgorithms() {
+    std::apply(
+      [](auto&... algos) {
+          ((algos && Algorithms::Variant(algos.get()) != g_AlgorithmVariant
+              ? algos.reset()
+              : void()),
+           ...);
+      },
+      g_Algorithms);
+}
+
+void resetAlgorithm() {
+    forEachAlgorithm([](auto* algo) { algo->reset(); });
+}
+
+void setMSAASampleCount(uint8_t numSamples) {
+    g_MSAASampleCount = numSamples;
+    forEachAlgorithm(
+      [](auto* algo) { algo->setMSAASampleCount(g_MSAASampleCount); });
+}
+
+void setTemporalAA(bool enabled) {
+    g_TemporalAA = enabled;
+    forEachAlgorithm([](auto* algo) { algo->setTemporalAA(g_TemporalAA); });
+    if (!enabled) {
+        Variables::Transform.Jitter = glm::vec2(0.0f);
+        Variables::Transform.update();
+    }
+}
+
+// Applies the current sweep configuration to the scene and all algorithms
+void configureSweep() {
+    const auto& config = g_Sweep.getConfiguration();
+    FrameInput input = captureFrameInput(config.msaaSampleCount);
+    input.numSpheresPerRow = config.numSpheresPerRow;
+    input.numSphereSlices = config.numSphereSlices;
+    input.numLights = config.numLights;
+    input.lightRangeLimits = config.lightRangeLimits;
+    input.windowSize = config.resolution;
+    // Every run starts from the same light layout
+    applyFrameInput(input, true);
+
+    if (config.msaaSampleCount != g_MSAASampleCount)
+        setMSAASampleCount(config.msaaSampleCount);
+    if (config.temporalAA != g_TemporalAA) setTemporalAA(config.temporalAA);
+    using DAIS = Algorithms::DeferredAttributeInterpolationShading;
+    auto* dais = getAlgorithm<AlgorithmsEnum::DAIS>();
+    dais->setHashTableSize(config.hashTableSize);
+    dais->setCacheWays(config.cacheWays);
+    dais->setCacheHash(static_cast<DAIS::CacheHash>(config.cacheHash));
+    dais->setCacheProbing(static_cast<DAIS::CacheProbing>(config.cacheProbing));
+    g_AlgorithmVariant
+      = getAlgorithmVariant(static_cast<AlgorithmsEnum>(g_Sweep.getAlgorithm()));
+    forEachAlgorithm([](auto* algo) {
+        algo->setInstrumentation(Instrumentation::PipelineStatistics);
+    });
+}
+
+void writeSweepResults() {
+    std::visit(
+      [](auto* algo) {
+          const auto prefix
+            = g_Sweep.getColumns()
+              + fmt::format("{},{},{},", algo->getTransientMemorySize(),
+                            algo->getTemporalAAMemorySize(),
+                            Statistic::GPUMemory::AllocatedMemory);
+          algo->writeStatisticsRows(g_Sweep.getOutput(), prefix);
+      },
+      g_AlgorithmVariant);
+}
+
+bool startSweep(const std::string& gridFileName,
+                const std::string& outputFileName) {
+    auto& scene = Scene::get();
+    const auto* dais = getAlgorithm<AlgorithmsEnum::DAIS>();
+    const SweepRunner::Configuration current{
+      scene.spheres.numSpheresPerRow,
+      scene.spheres.numSphereSlices,
+      scene.lights.numLights,
+      scene.lights.rangeLimits,
+      g_MSAASampleCount,
+      g_TemporalAA,
+      dais->getHashTableSize(),
+      dais->getCacheWays(),
+      static_cast<int>(dais->getCacheHash()),
+      static_cast<int>(dais->getCacheProbing()),
+      Variables::WindowSize};
+    if (!g_Sweep.start(gridFileName, outputFileName,
+                       std::variant_size_v<Algorithms::Variant>, current))
+        return false;
+
+    g_KeepAlgorithmsResident = true;
+    g_CompareAlgorithms = false;
+    auto& output = g_Sweep.getOutput();
+    output << SweepRunner::getColumnsHeader()
+           << "transient memory [B],temporal AA memory [B],"
+              "GPU memory allocated [KB],";
+    Algorithms::DeferredShading::writeStatisticsHeader(output);
+    return true;
+}
+
+// Records inputs of the frame or replaces them with the replayed ones
+void beginFrame() {
+    switch (g_Sweep.nextFrame()) {
+        case SweepRunner::Action::Configure:
+            configureSweep();
+            break;
+        case SweepRunner::Action::StartMeasurement:
+            resetAlgorithm();
+            break;
+        case SweepRunner::Action::WriteResults:
+            writeSweepResults();
+            break;
+        case SweepRunner::Action::Finished:
+            Variables::AppClose = true;
+            break;
+        default:
+            break;
+    }
+
+    // Each image diff variant replays all recorded frames
+    if (g_ImageDiff.isRunning()) {
+        g_ImageDiff.processReadbacks();
+        if (g_FrameInputs.getMode() == FrameInputRecorder::Mode::Off) {
+            if (const auto* variant = g_ImageDiff.nextVariant()) {
+                g_AlgorithmVariant = getAlgorithmVariant(
+                  static_cast<AlgorithmsEnum>(variant->algorithm));
+                // Every TAA variant starts with the same jitter sequence
+                if (variant->temporalAA != g_TemporalAA)
+                    setTemporalAA(variant->temporalAA);
+                g_TemporalAAFrame = 0;
+                std::visit(
+                  [&](auto* algo) {
+                      for (auto&& [name, enabled] : variant->options)
+                          algo->setOption(name, enabled);
+                  },
+                  g_AlgorithmVariant);
+                if (variant->algorithm
+                    == static_cast<int>(AlgorithmsEnum::DAIS)) {
+                    using DAIS
+                      = Algorithms::DeferredAttributeInterpolationShading;
+                    auto* dais = getAlgorithm<AlgorithmsEnum::DAIS>();
+                    dais->setCacheHash(
+                      static_cast<DAIS::CacheHash>(variant->cacheHash));
+                    dais->setCacheProbing(
+                      static_cast<DAIS::CacheProbing>(variant->cacheProbing));
+                }
+                g_FrameInputs.startReplay(g_ImageDiff.getReplayFileName());
+            } else {
+                Variables::AppClose = true;
+            }
+        }
+    }
+
+    switch (g_FrameInputs.getMode()) {
+        case FrameInputRecorder::Mode::Recording:
+            g_FrameInputs.record(captureFrameInput(g_MSAASampleCount));
+            break;
+        case FrameInputRecorder::Mode::Replaying:
+            if (const FrameInput* input = g_FrameInputs.next()) {
+                // Light layout is recreated from the seed in the first frame
+                if (applyFrameInput(*input, g_FrameInputs.getFrame() == 1))
+                    resetAlgorithm();
+                const uint8_t numSamples
+                  = g_ImageDiff.isRunning()
+                      ? g_ImageDiff.getVariant().msaaSampleCount
+                      : input->msaaSampleCount;
+                if (numSamples != g_MSAASampleCount)
+                    setMSAASampleCount(numSamples);
+            } else {
+                g_FrameInputs.stop();
+                if (Variables::Headless && !g_ImageDiff.isRunning())
+                    Variables::AppClose = true;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void startRecording() {
+    // Recorded frames start from the light layout given by the seed
+    Scene::get().lights.create(
+      static_cast<float>(Scene::get().spheres.numSpheresPerRow));
+    resetAlgorithm();
+    g_FrameInputs.startRecording("frame_inputs.bin");
+}
 
 void display() {
-    std::visit([](auto&& algo) { algo->run(); }, g_AlgorithmVariant);
+    Scene::get().beginFrame();
+    // Lights have to move in every recorded frame, even if no algorithm
+    // renders anything yet (shaders are still being compiled)
+    if (g_FrameInputs.getMode() != FrameInputRecorder::Mode::Off)
+        Scene::get().update();
+    // Every frame is rendered with the next sub-pixel offset, the history
+    // accumulates all of them
+    if (g_TemporalAA) {
+        Variables::Transform.Jitter
+          = TemporalAA::getJitter(g_TemporalAAFrame++);
+        Variables::Transform.update();
+    }
+    if (g_CompareAlgorithms) {
+        // Other algorithms are rendered first so that the displayed one ends
+        // up in the framebuffer
+        forEachAlgorithm([](auto* algo) {
+            if (Algorithms::Variant(algo) != g_AlgorithmVariant) algo->run();
+        });
+    }
+    std::visit([](auto* algo) { algo->run(); }, g_AlgorithmVariant);
+    if (g_Sweep.isMeasuring()) {
+        std::visit([](auto* algo) { algo->collectMeasurements(); },
+                   g_AlgorithmVariant);
+    }
+    if (g_ImageDiff.isRunning()
+        && g_FrameInputs.getMode() == FrameInputRecorder::Mode::Replaying)
+        g_ImageDiff.captureFrame(static_cast<int>(g_FrameInputs.getFrame()),
+                                 Variables::WindowSize);
     Scene::get().lights.render(); // Render light centers/ranges if enabled
 }
 
@@ -35,7 +304,14 @@ void init() {
     // Default scene distance
     Variables::Transform.SceneZOffset = 8.0f;
 
-    std::visit([](auto&& algo) { algo->initialize(); }, g_AlgorithmVariant);
+    g_AlgorithmVariant = getAlgorithmVariant(AlgorithmsEnum::DS);
+    Callbacks::User::BeginFrame = beginFrame;
+
+    // "--sweep <grid file>" runs all algorithms for all parameter
+    // combinations, results are written to "--sweepoutput <file>"
+    if (!g_SweepGridFile.empty()
+        && !startSweep(g_SweepGridFile, g_SweepOutputFile))
+        Variables::AppClose = true;
 
     // Load shader program
     compileShaders();
@@ -43,20 +319,14 @@ void init() {
 
 constexpr const char* help_message = "no help here";
 
-void resetAlgorithm() {
-    // this is NOT std::unique_ptr::reset!
-    std::visit([](auto&& algo) { algo->reset(); }, g_AlgorithmVariant);
-}
-
 int showGUI() {
-    int menuHeight = 355;
+    int menuHeight = g_CompareAlgorithms ? 485 : 445;
     const int oneInt = 1;
     const int itemWidth = 140 * IMGUI_RESIZE_FACTOR;
 
-    static AlgorithmsEnum algorithm
-      = std::holds_alternative<Algorithms::DSUniquePtr>(g_AlgorithmVariant)
-          ? AlgorithmsEnum::DS
-          : AlgorithmsEnum::DAIS;
+    // Follows the displayed algorithm, it is also switched by the sweep and
+    // the image diff
+    auto algorithm = static_cast<AlgorithmsEnum>(g_AlgorithmVariant.index());
 
     ImGui::Begin("Render");
     ImGui::SetWindowSize(glm::vec2(220, menuHeight) * IMGUI_RESIZE_FACTOR,
@@ -65,23 +335,30 @@ int showGUI() {
     if (ImGui::Combo(
           "Shading", reinterpret_cast<int*>(&algorithm),
           "DeferredShading\0Deferred Attribute Interpolation Shading\0")) {
-        switch (algorithm) {
-            case AlgorithmsEnum::DS:
-                g_AlgorithmVariant
-                  = std::make_unique<Algorithms::DeferredShading>();
-                break;
-            case AlgorithmsEnum::DAIS:
-                g_AlgorithmVariant = std::make_unique<
-                  Algorithms::DeferredAttributeInterpolationShading>();
-                break;
+        // Previous algorithm is destroyed before the new one is created
+        if (!g_KeepAlgorithmsResident)
+            std::apply([](auto&... algos) { (algos.reset(), ...); },
+                       g_Algorithms);
+        g_AlgorithmVariant = getAlgorithmVariant(algorithm);
+        resetAlgorithm();
+    }
+    if (ImGui::Checkbox("Keep resident", &g_KeepAlgorithmsResident)) {
+        if (!g_KeepAlgorithmsResident) {
+            g_CompareAlgorithms = false;
+            destroyInactiveAlgorithms();
+        }
+    }
+    if (ImGui::Checkbox("Compare (same frame)", &g_CompareAlgorithms)) {
+        if (g_CompareAlgorithms) {
+            g_KeepAlgorithmsResident = true;
+            getAlgorithmVariant(AlgorithmsEnum::DS);
+            getAlgorithmVariant(AlgorithmsEnum::DAIS);
         }
-        std::visit([](auto&& algo) { algo->initialize(); }, g_AlgorithmVariant);
         resetAlgorithm();
     }
 
     static uint8_t MSAASamples;
-    switch (std::visit([](auto&& algo) { return algo->getMSAASampleCount(); },
-                       g_AlgorithmVariant)) {
+    switch (g_MSAASampleCount) {
         case 4:
             MSAASamples = 1;
             break;
@@ -91,15 +368,22 @@ int showGUI() {
         default:
             MSAASamples = 0;
     }
+    // Temporal anti-aliasing is the last item, rendered without MSAA
+    if (g_TemporalAA) MSAASamples = 3;
 
     if (ImGui::Combo(
           "MSAA/SSAA", reinterpret_cast<int*>(&MSAASamples),
           "Disabled\0" // NOLINT(bugprone-string-literal-with-embedded-nul)
           "x4\0"
-          "x8")) {
-        if (MSAASamples > 0) MSAASamples = 1 << (MSAASamples + 1);
-        std::visit([](auto&& algo) { algo->setMSAASampleCount(MSAASamples); },
-                   g_AlgorithmVariant);
+          "x8\0"
+          "TAA")) {
+        const bool temporalAA = MSAASamples == 3;
+        if (temporalAA)
+            MSAASamples = 0;
+        else if (MSAASamples > 0)
+            MSAASamples = 1 << (MSAASamples + 1);
+        setMSAASampleCount(MSAASamples);
+        if (temporalAA != g_TemporalAA) setTemporalAA(temporalAA);
     }
 
     ImGui::Checkbox("Rotate lights", &Scene::get().lights.rotate);
@@ -112,6 +396,29 @@ int showGUI() {
     ImGui::SameLine(170.0f * IMGUI_RESIZE_FACTOR, -10.0f * IMGUI_RESIZE_FACTOR);
     if (ImGui::Button("Reset")) resetAlgorithm();
 
+    // Frame inputs recording/replay
+    switch (g_FrameInputs.getMode()) {
+        case FrameInputRecorder::Mode::Off:
+            if (ImGui::Button("Record inputs")) startRecording();
+            ImGui::SameLine();
+            if (ImGui::Button("Replay inputs")) {
+                if (g_FrameInputs.startReplay("frame_inputs.bin"))
+                    resetAlgorithm();
+            }
+            break;
+        case FrameInputRecorder::Mode::Recording:
+            if (ImGui::Button("Stop")) g_FrameInputs.stop();
+            ImGui::SameLine();
+            ImGui::Text("Recording %zu", g_FrameInputs.getFrame());
+            break;
+        case FrameInputRecorder::Mode::Replaying:
+            if (ImGui::Button("Stop")) g_FrameInputs.stop();
+            ImGui::SameLine();
+            ImGui::Text("Replaying %zu/%zu", g_FrameInputs.getFrame(),
+                        g_FrameInputs.getNumFrames());
+            break;
+    }
+
     ImGui::Separator();
     ImGui::Text("Spheres");
     ImGui::SetNextItemWidth(itemWidth);
@@ -146,6 +453,12 @@ int showGUI() {
     }
     ImGui::SetNextItemWidth(itemWidth);
     ImGui::SliderFloat("Speed", &Scene::get().lights.rotationSpeed, 0.0f, 0.2f);
+    ImGui::SetNextItemWidth(itemWidth);
+    if (ImGui::InputScalar("Seed", ImGuiDataType_U32,
+                           &Scene::get().lights.seed, &oneInt)) {
+        Scene::get().lights.create(static_cast<float>(numSpheresPerRow));
+        resetAlgorithm();
+    }
 
     ImGui::SetNextItemWidth(56 * IMGUI_RESIZE_FACTOR);
     auto& lightRangeLimits = Scene::get().lights.rangeLimits;
@@ -163,10 +476,28 @@ int showGUI() {
     }
     ImGui::SameLine();
     ImGui::Text("Range");
+
+    if (g_CompareAlgorithms) {
+        ImGui::Separator();
+        ImGui::Text("Frame times");
+        forEachAlgorithm([](auto* algo) {
+            ImGui::Text(" * %s: %u", algo->getName().c_str(),
+                        algo->getFrameTime());
+        });
+    }
     ImGui::End();
 
-    std::visit([](auto&& algo) { algo->gui(glm::ivec2(235, 10), 240); },
-               g_AlgorithmVariant);
+    if (g_CompareAlgorithms) {
+        // Algorithm windows side by side
+        int offset = 235;
+        forEachAlgorithm([&offset](auto* algo) {
+            algo->gui(glm::ivec2(offset, 10), 240);
+            offset += 250;
+        });
+    } else {
+        std::visit([](auto* algo) { algo->gui(glm::ivec2(235, 10), 240); },
+                   g_AlgorithmVariant);
+    }
 
     return menuHeight;
 }
@@ -175,7 +506,7 @@ void compileShaders(void* clientData) {
     spdlog::debug("compileShaders top level function called, calling "
                   "algorithm.reset(true)");
     glUseProgram(0);
-    std::visit([](auto&& algo) { algo->reset(true); }, g_AlgorithmVariant);
+    forEachAlgorithm([](auto* algo) { algo->reset(true); });
 }
 
 //-----------------------------------------------------------------------------
@@ -186,14 +517,14 @@ void keyboardChanged(int key, int action, int mods) {}
 
 void windowResized(const glm::ivec2& resolution) {
     spdlog::trace("Window resized");
-    std::visit(
-      [&resolution](auto&& algo) { algo->onWindowResized(resolution); },
-      g_AlgorithmVariant);
+    forEachAlgorithm(
+      [&resolution](auto* algo) { algo->onWindowResized(resolution); });
 }
 
 void destroyAlgorithm() {
-    spdlog::trace("Destroying algorithm");
-    std::visit([](auto&& algo) { algo.reset(nullptr); }, g_AlgorithmVariant);
+    g_ImageDiff.stop();
+    spdlog::trace("Destroying algorithms");
+    std::apply([](auto&... algos) { (algos.reset(), ...); }, g_Algorithms);
 }
 
 void setLogLevel(std::string_view levelStr) {
@@ -221,7 +552,17 @@ void setLogLevel(std::string_view levelStr) {
 // Desc:
 //-----------------------------------------------------------------------------
 int main(int argc, char** argv) {
-    constexpr int OGL_CONFIGURATION[] = {GLFW_CONTEXT_VERSION_MAJOR,
+    auto args = argparse(argc, argv);
+    // Frame inputs are replayed without window and GUI, the application exits
+    // after the last frame. Sweeps are always run headless.
+    const auto headlessIt = args.keyValueArgs.find("headless");
+    const auto sweepIt = args.keyValueArgs.find("sweep");
+    const auto imageDiffIt = args.keyValueArgs.find("imagediff");
+    const bool headless = headlessIt != args.keyValueArgs.end()
+                          || sweepIt != args.keyValueArgs.end()
+                          || imageDiffIt != args.keyValueArgs.end();
+
+    const int OGL_CONFIGURATION[] = {GLFW_CONTEXT_VERSION_MAJOR,
                                          4,
                                          GLFW_CONTEXT_VERSION_MINOR,
                                          6,
@@ -233,19 +574,159 @@ int main(int argc, char** argv) {
                                          GLFW_OPENGL_CORE_PROFILE,
                                          PGR2_SHOW_MEMORY_STATISTICS,
                                          GL_TRUE.m_value,
+                                         PGR2_HEADLESS,
+                                         headless ? 1 : 0,
                                          0};
 
     printf("%s\n", help_message);
     spdlog::set_level(spdlog::level::debug);
     spdlog::set_pattern("[%H:%M:%S.%e] [%^%l%$] %v");
 
-    auto args = argparse(argc, argv);
     if (auto it = args.keyValueArgs.find("loglevel");
         it != args.keyValueArgs.end()) {
         setLogLevel(it->second);
     }
+    if (auto it = args.keyValueArgs.find("shadercache");
+        it != args.keyValueArgs.end()) {
+        // "off" disables the program binary cache, anything else is the cache
+        // directory
+        if (it->second == "off") {
+            Variables::ShaderBinaryCache = false;
+        } else {
+            Variables::ShaderBinaryCacheDirectory = it->second;
+        }
+    }
+    if (auto it = args.keyValueArgs.find("trace");
+        it != args.keyValueArgs.end()) {
+        // "<first frame>:<number of frames>", timeline of the frames is
+        // written in Chrome trace format
+        int firstFrame = 0, numFrames = 0;
+        if (sscanf(it->second.c_str(), "%d:%d", &firstFrame, &numFrames) == 2)
+            Tools::TraceRecorder::get().capture(
+              firstFrame, numFrames, fmt::format("trace_{}.json", firstFrame));
+        else
+            spdlog::warn("Invalid trace frame range {}", it->second);
+    }
+
+    // "--record <file>" records inputs of all frames, "--replay <file>" or
+    // "--headless <file>" replays them
+    if (auto it = args.keyValueArgs.find("record");
+        it != args.keyValueArgs.end()) {
+        g_FrameInputs.startRecording(it->second);
+    }
+    if (auto it = args.keyValueArgs.find("replay");
+        it != args.keyValueArgs.end()) {
+        g_FrameInputs.startReplay(it->second);
+    }
+    if (headlessIt != args.keyValueArgs.end()
+        && !g_FrameInputs.startReplay(headlessIt->second))
+        return 4;
+    if (imageDiffIt != args.keyValueArgs.end()) {
+        // "--imagediff <recorded frame inputs>" replays the frames with all
+        // algorithms (D.A.I.S. also with its memory layout options, subgroup
+        // deduplication, cache hashes and probings, analytic gradients,
+        // object-space shading and adaptive shading rate, both also with tile
+        // classification) and MSAA sample counts or TAA and compares them
+        // with reference images in "--reference <dir>"
+        std::string referenceDirectory = "reference";
+        if (auto it = args.keyValueArgs.find("reference");
+            it != args.keyValueArgs.end())
+            referenceDirectory = it->second;
+        double minPSNR = 40.0;
+        if (auto it = args.keyValueArgs.find("minpsnr");
+            it != args.keyValueArgs.end())
+            minPSNR = std::stod(it->second);
+
+        // D.A.I.S. is replayed with each of these options, all the others
+        // are disabled
+        const std::vector<std::pair<std::string, const char*>> daisOptions
+          = {{"", nullptr},
+             {"packed_", "PackedDerivatives"},
+             {"compact_", "CompactTriangles"},
+             {"fused_", "FusedDerivatives"},
+             {"subgroup_", "SubgroupDeduplication"},
+             {"tiles_", "TileClassification"},
+             {"analyticgrad_", "AnalyticGradients"},
+             {"objectspace_", "ObjectSpaceShading"},
+             {"adaptiverate_", "AdaptiveShadingRate"}};
+        // Options trading quality for speed are compared with a lower
+        // threshold
+        constexpr double lossyMinPSNR = 30.0;
+        const std::vector<std::string_view> lossyOptions{
+          "ObjectSpaceShading", "AdaptiveShadingRate"};
+        const auto& hashNames = SweepRunner::getCacheHashNames();
+        const auto& probingNames = SweepRunner::getCacheProbingNames();
+        std::vector<ImageDiffRunner::Variant> variants;
+        for (uint8_t numSamples : MSAASampleCounts) {
+            for (bool tiles : {false, true}) {
+                variants.push_back(
+                  {static_cast<int>(AlgorithmsEnum::DS), numSamples,
+                   fmt::format("DS_{}msaa{}", tiles ? "tiles_" : "",
+                               numSamples),
+                   {{"TileClassification", tiles}}});
+            }
+            const auto daisVariant = [&](std::string name,
+                                         const char* enabledOption) {
+                ImageDiffRunner::Variant variant{
+                  static_cast<int>(AlgorithmsEnum::DAIS), numSamples,
+                  fmt::format("DAIS_{}msaa{}", name, numSamples)};
+                for (const auto& other : daisOptions) {
+                    if (other.second)
+                        variant.options.emplace_back(
+                          other.second, other.second == enabledOption);
+                }
+                if (enabledOption
+                    && std::find(lossyOptions.begin(), lossyOptions.end(),
+                                 enabledOption)
+                         != lossyOptions.end())
+                    variant.minPSNR = std::min(minPSNR, lossyMinPSNR);
+                return variant;
+            };
+            for (auto&& [prefix, enabledOption] : daisOptions)
+                variants.push_back(daisVariant(prefix, enabledOption));
+            // Cache hashes and probings with the default options, the cache
+            // only memoizes derivatives, images are the same
+            for (int hash = 1; hash < static_cast<int>(hashNames.size());
+                 hash++) {
+                variants.push_back(
+                  daisVariant(hashNames[hash] + "_", nullptr));
+                variants.back().cacheHash = hash;
+            }
+            for (int probing = 1;
+                 probing < static_cast<int>(probingNames.size()); probing++) {
+                variants.push_back(
+                  daisVariant(probingNames[probing] + "_", nullptr));
+                variants.back().cacheProbing = probing;
+            }
+        }
+        // TAA is rendered without MSAA and with the default options, frames
+        // are compared once the history has accumulated all jitter offsets
+        // twice
+        ImageDiffRunner::Variant dsTAA{static_cast<int>(AlgorithmsEnum::DS),
+                                       0, "DS_taa"};
+        dsTAA.options.emplace_back("TileClassification", false);
+        ImageDiffRunner::Variant daisTAA{
+          static_cast<int>(AlgorithmsEnum::DAIS), 0, "DAIS_taa"};
+        for (const auto& [prefix, option] : daisOptions)
+            if (option) daisTAA.options.emplace_back(option, false);
+        for (auto* variant : {&dsTAA, &daisTAA}) {
+            variant->temporalAA = true;
+            variant->warmupFrames
+              = static_cast<int>(2 * TemporalAA::NUM_JITTER_SAMPLES);
+            variants.push_back(std::move(*variant));
+        }
+        if (!g_ImageDiff.start(imageDiffIt->second, referenceDirectory,
+                               minPSNR, std::move(variants)))
+            return 4;
+    }
+    if (sweepIt != args.keyValueArgs.end()) {
+        g_SweepGridFile = sweepIt->second;
+        if (auto it = args.keyValueArgs.find("sweepoutput");
+            it != args.keyValueArgs.end())
+            g_SweepOutputFile = it->second;
+    }
 
-    return common_main(
+    const int result = common_main(
       1200, 900, "[PGR2] Cornell Box",
       static_cast<const int*>(OGL_CONFIGURATION), // OGL configuration hints
       init,                                       // Init GL callback function
@@ -256,4 +737,6 @@ int main(int argc, char** argv) {
       keyboardChanged,  // Keyboard callback function
       nullptr,          // Mouse button callback function
       nullptr);         // Mouse motion callback function
+    if (result == 0 && g_ImageDiff.hasFailed()) return 5;
+    return result;
 }
@@ -0,0 +1,248 @@
+#include "render_graph.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+// Writes not synchronized with subsequent accesses without glMemoryBarrier()
+bool isIncoherentWrite(ResourceUsage usage) {
+    return usage == ResourceUsage::Image
+           || usage == ResourceUsage::StorageBuffer
+           || usage == ResourceUsage::AtomicCounter;
+}
+
+// Barrier making incoherent writes visible to the subsequent access
+MemoryBarrierMask getBarrierBit(ResourceUsage usage) {
+    switch (usage) {
+        case ResourceUsage::Framebuffer:
+            return GL_FRAMEBUFFER_BARRIER_BIT;
+        case ResourceUsage::Texture:
+            return GL_TEXTURE_FETCH_BARRIER_BIT;
+        case ResourceUsage::Image:
+            return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+        case ResourceUsage::StorageBuffer:
+            return GL_SHADER_STORAGE_BARRIER_BIT;
+        case ResourceUsage::AtomicCounter:
+            return GL_ATOMIC_COUNTER_BARRIER_BIT;
+        case ResourceUsage::UniformBuffer:
+            return GL_UNIFORM_BARRIER_BIT;
+        case ResourceUsage::BufferUpdate:
+            return GL_BUFFER_UPDATE_BARRIER_BIT;
+        case ResourceUsage::TextureUpdate:
+            return GL_TEXTURE_UPDATE_BARRIER_BIT;
+        case ResourceUsage::Command:
+            return GL_COMMAND_BARRIER_BIT;
+    }
+    return MemoryBarrierMask::GL_NONE_BIT;
+}
+
+GLint getOffsetAlignment(GLenum target) {
+    GLint alignment = 1;
+    if (target == GL_SHADER_STORAGE_BUFFER)
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    else if (target == GL_UNIFORM_BUFFER)
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    else if (target == GL_ATOMIC_COUNTER_BUFFER)
+        alignment = 4;
+    return std::max(alignment, 1);
+}
+} // namespace
+
+RenderGraph::~RenderGraph() { glDeleteBuffers(1, &transientPool); }
+
+void RenderGraph::addTransientBuffer(std::string name, GLenum target,
+                                     GLuint binding, GLsizeiptr size) {
+    transientBuffers.push_back(
+      TransientBuffer{std::move(name), target, binding, size});
+}
+
+void RenderGraph::setTransientBufferSize(const std::string& name,
+                                         GLsizeiptr size) {
+    for (auto& buffer : transientBuffers) {
+        if (buffer.name != name || buffer.size == size) continue;
+        buffer.size = size;
+        buffersChanged = true;
+    }
+}
+
+void RenderGraph::build(const std::vector<Node>& nodes) {
+    cull(nodes);
+    computeBarriers(nodes);
+    allocateTransientBuffers(nodes);
+    buffersChanged = false;
+}
+
+GLsizeiptr RenderGraph::getTransientMemoryRequested() const {
+    GLsizeiptr size = 0;
+    for (const auto& buffer : transientBuffers)
+        if (buffer.used) size += buffer.size;
+    return size;
+}
+
+void RenderGraph::cull(const std::vector<Node>& nodes) {
+    culled.assign(nodes.size(), true);
+
+    // Walk the graph backwards from the outputs, renderpass is needed if it
+    // writes a resource read by a later needed renderpass. Walked twice so
+    // that resources read before being written (kept from the previous
+    // frame) keep their writers alive.
+    std::unordered_set<std::string> needed;
+    for (int iteration = 0; iteration < 2; iteration++) {
+        needed.insert(BackbufferColor);
+        needed.insert(BackbufferDepth);
+        for (size_t i = nodes.size(); i-- > 0;) {
+            const Node& node = nodes[i];
+            if (!node.enabled) continue;
+            // Renderpasses without declared resources are always executed
+            if (node.resources->empty()) {
+                culled[i] = false;
+                continue;
+            }
+
+            const bool writesNeeded = std::any_of(
+              node.resources->begin(), node.resources->end(),
+              [&](const ResourceAccess& access) {
+                  return access.write && needed.contains(access.resource);
+              });
+            if (!writesNeeded) continue;
+
+            culled[i] = false;
+            for (const auto& access : *node.resources)
+                if (access.write) needed.erase(access.resource);
+            for (const auto& access : *node.resources)
+                if (!access.write) needed.insert(access.resource);
+        }
+    }
+}
+
+void RenderGraph::computeBarriers(const std::vector<Node>& nodes) {
+    struct ResourceState
+    {
+        bool incoherentlyWritten = false;
+        MemoryBarrierMask visibleTo = MemoryBarrierMask::GL_NONE_BIT;
+    };
+    std::unordered_map<std::string, ResourceState> states;
+
+    barriers.assign(nodes.size(), MemoryBarrierMask::GL_NONE_BIT);
+
+    // The first iteration only finds the state at the end of a frame, so that
+    // writes from the previous frame are synchronized as well
+    for (int iteration = 0; iteration < 2; iteration++) {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (!nodes[i].enabled || culled[i]) continue;
+
+            MemoryBarrierMask required = MemoryBarrierMask::GL_NONE_BIT;
+            for (const auto& access : *nodes[i].resources) {
+                const auto& state = states[access.resource];
+                const auto bit = getBarrierBit(access.usage);
+                const bool visible
+                  = (state.visibleTo & bit) != MemoryBarrierMask::GL_NONE_BIT;
+                if (state.incoherentlyWritten && !visible) required |= bit;
+            }
+            if (iteration == 1) barriers[i] = required;
+
+            // Barrier applies to all previous writes
+            if (required != MemoryBarrierMask::GL_NONE_BIT) {
+                for (auto& [name, state] : states) {
+                    if (state.incoherentlyWritten) state.visibleTo |= required;
+                }
+            }
+            for (const auto& access : *nodes[i].resources) {
+                if (!access.write) continue;
+                auto& state = states[access.resource];
+                state.incoherentlyWritten = isIncoherentWrite(access.usage);
+                state.visibleTo = MemoryBarrierMask::GL_NONE_BIT;
+            }
+        }
+    }
+}
+
+void RenderGraph::allocateTransientBuffers(const std::vector<Node>& nodes) {
+    if (transientBuffers.empty()) return;
+
+    // Find lifetimes, buffers read before being written keep their contents
+    // between frames and live during the whole frame
+    for (auto& buffer : transientBuffers) {
+        bool used = false, persistent = false;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (!nodes[i].enabled || culled[i]) continue;
+            for (const auto& access : *nodes[i].resources) {
+                if (access.resource != buffer.name) continue;
+                if (!used) {
+                    buffer.firstUse = i;
+                    persistent = !access.write;
+                }
+                buffer.lastUse = i;
+                used = true;
+            }
+        }
+        if (persistent) {
+            buffer.firstUse = 0;
+            buffer.lastUse = nodes.size();
+        }
+        // Buffers of disabled or culled renderpasses get no memory
+        buffer.used = used;
+    }
+
+    // Place buffers from the largest one to the lowest offset not overlapping
+    // any placed buffer with intersecting lifetime
+    std::vector<TransientBuffer*> order;
+    for (auto& buffer : transientBuffers)
+        if (buffer.used) order.push_back(&buffer);
+    std::sort(order.begin(), order.end(),
+              [](const TransientBuffer* a, const TransientBuffer* b) {
+                  return a->size > b->size;
+              });
+
+    GLsizeiptr poolSize = 0;
+    std::vector<const TransientBuffer*> placed;
+    for (auto* buffer : order) {
+        std::vector<const TransientBuffer*> conflicts;
+        for (const auto* other : placed) {
+            if (other->firstUse <= buffer->lastUse
+                && buffer->firstUse <= other->lastUse)
+                conflicts.push_back(other);
+        }
+        std::sort(conflicts.begin(), conflicts.end(),
+                  [](const TransientBuffer* a, const TransientBuffer* b) {
+                      return a->offset < b->offset;
+                  });
+
+        const GLint alignment = getOffsetAlignment(buffer->target);
+        GLintptr offset = 0;
+        for (const auto* other : conflicts) {
+            if (offset + buffer->size <= other->offset) break;
+            offset = std::max(offset, other->offset + other->size);
+            offset = (offset + alignment - 1) / alignment * alignment;
+        }
+        buffer->offset = offset;
+        poolSize = std::max(poolSize, offset + buffer->size);
+        placed.push_back(buffer);
+    }
+
+    if (poolSize != transientPoolSize) {
+        glDeleteBuffers(1, &transientPool);
+        transientPool = 0;
+        transientPoolSize = poolSize;
+        // Zero-size storage is an error, nothing is bound without a pool
+        if (poolSize == 0) return;
+        glCreateBuffers(1, &transientPool);
+        glNamedBufferStorage(transientPool, poolSize, nullptr,
+                             GL_CLIENT_STORAGE_BIT);
+        spdlog::debug("Render graph: {} B of transient memory ({} B requested)",
+                      transientPoolSize, getTransientMemoryRequested());
+    }
+    bindTransientBuffers();
+}
+
+void RenderGraph::bindTransientBuffers() const {
+    if (transientPool == 0) return;
+    for (const auto& buffer : transientBuffers) {
+        if (!buffer.used) continue;
+        glBindBufferRange(buffer.target, buffer.binding, transientPool,
+                          buffer.offset, buffer.size);
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef DEFERREDATTRIBUTEINTERPOLATIONSHADING_RENDER_GRAPH
+#define DEFERREDATTRIBUTEINTERPOLATIONSHADING_RENDER_GRAPH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glbinding/gl/gl.h>
+
+using namespace gl;
+
+// How a renderpass accesses a resource, determines memory barriers required
+// between renderpasses
+enum class ResourceUsage : uint8_t
+{
+    Framebuffer,   // Color/depth attachment, framebuffer clears and blits
+    Texture,       // Sampled in shaders (texture(), texelFetch())
+    Image,         // Image load/store/atomic operations
+    StorageBuffer, // Shader storage buffer
+    AtomicCounter, // Atomic counter buffer
+    UniformBuffer, // Uniform buffer
+    BufferUpdate,  // Buffer mapping, glClearBufferData(), glBufferSubData()
+    TextureUpdate, // glClearTexImage(), glTexSubImage()
+    Command        // Indirect draw/dispatch commands
+};
+
+struct ResourceAccess
+{
+    std::string resource; // Resource name (unique within the algorithm)
+    ResourceUsage usage;
+    bool write = false;
+};
+
+//-----------------------------------------------------------------------------
+// Name: RenderGraph
+// Desc: Dependency graph of renderpasses built from resources they declare.
+//       Culls renderpasses whose outputs are not used, computes minimal memory
+//       barriers between renderpasses and places transient buffers with
+//       disjoint lifetimes into shared memory.
+//-----------------------------------------------------------------------------
+class RenderGraph
+{
+public:
+    // Default framebuffer, final output of all algorithms
+    // NOLINTNEXTLINE(cert-err58-cpp)
+    inline static const std::string BackbufferColor{"backbuffer color"};
+    // NOLINTNEXTLINE(cert-err58-cpp)
+    inline static const std::string BackbufferDepth{"backbuffer depth"};
+
+    struct Node
+    {
+        const std::vector<ResourceAccess>* resources = nullptr;
+        bool enabled = true; // Disabled renderpasses are not executed
+    };
+
+    RenderGraph() = default;
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+    ~RenderGraph();
+
+    // Registers buffer allocated by the graph. Its memory may be shared with
+    // other transient buffers not used by the same renderpasses, buffers not
+    // used by any executed renderpass are neither allocated nor bound.
+    void addTransientBuffer(std::string name, GLenum target, GLuint binding,
+                            GLsizeiptr size);
+    // Changes size of a registered buffer, it takes effect when the graph is
+    // built again (see needsBuild())
+    void setTransientBufferSize(const std::string& name, GLsizeiptr size);
+
+    // Builds the graph from renderpasses in execution order
+    void build(const std::vector<Node>& nodes);
+
+    // Binds transient buffers to their binding points
+    void bindTransientBuffers() const;
+
+    // Returns true if the transient buffers changed since the last build
+    bool needsBuild() const { return buffersChanged; }
+
+    bool isCulled(size_t node) const { return culled[node]; }
+    MemoryBarrierMask getBarriers(size_t node) const { return barriers[node]; }
+
+    // Returns memory used by transient buffers and the memory they would use
+    // without aliasing
+    GLsizeiptr getTransientMemorySize() const { return transientPoolSize; }
+    GLsizeiptr getTransientMemoryRequested() const;
+
+private:
+    struct TransientBuffer
+    {
+        std::string name;
+        GLenum target;
+        GLuint binding;
+        GLsizeiptr size;
+        GLintptr offset = 0;
+        size_t firstUse = 0, lastUse = 0; // Lifetime (node indices)
+        bool used = true; // Accessed by an executed renderpass
+    };
+
+    void cull(const std::vector<Node>& nodes);
+    void computeBarriers(const std::vector<Node>& nodes);
+    void allocateTransientBuffers(const std::vector<Node>& nodes);
+
+    std::vector<bool> culled;
+    std::vector<MemoryBarrierMask> barriers;
+    std::vector<TransientBuffer> transientBuffers;
+    GLuint transientPool = 0;
+    GLsizeiptr transientPoolSize = 0;
+    bool buffersChanged = false;
+};
+
+#endif /* DEFERREDATTRIBUTEINTERPOLATIONSHADING_RENDER_GRAPH */
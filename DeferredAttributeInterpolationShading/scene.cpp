@@ -1,23 +1,41 @@
 #include <scene.h>
 #include <layout_constants.h>
 
+#include <random>
+
 #include <spdlog/spdlog.h>
 
 using UniformBuffers = layout::UniformBuffers;
 
+namespace {
+// Uniformly distributed value in <min, max). Does not depend on the standard
+// library distributions, so the light layout is identical on all platforms.
+float random(std::mt19937& engine, float min, float max) {
+    return min + (max - min) * static_cast<float>(engine() >> 8) * 0x1p-24f;
+}
+
+glm::vec3 random(std::mt19937& engine, glm::vec3 min, glm::vec3 max) {
+    const float x = random(engine, min.x, max.x);
+    const float y = random(engine, min.y, max.y);
+    const float z = random(engine, min.z, max.z);
+    return glm::vec3(x, y, z);
+}
+} // namespace
+
 void Scene::Lights::create(float maxDistanceFromWorldOrigin) {
-    // Create random light
+    // Create random lights, the layout is given by the seed
+    std::mt19937 engine(seed);
     lights.resize(numLights);
     for (int i = 0; i < numLights; i++) {
-        const float radius = glm::linearRand(1.0f, maxDistanceFromWorldOrigin);
+        const float radius = random(engine, 1.0f, maxDistanceFromWorldOrigin);
         const glm::vec3 position
-          = glm::normalize(glm::linearRand(glm::vec3(-1.0f), glm::vec3(1.0f)))
+          = glm::normalize(random(engine, glm::vec3(-1.0f), glm::vec3(1.0f)))
             * radius;
-        const float range = glm::linearRand(rangeLimits.x, rangeLimits.y);
+        const float range = random(engine, rangeLimits.x, rangeLimits.y);
 
         lights[i].position = glm::vec4(position, range);
         lights[i].color
-          = glm::vec4(glm::linearRand(glm::vec3(0.1f), glm::vec3(0.8f)), 0.45f);
+          = glm::vec4(random(engine, glm::vec3(0.1f), glm::vec3(0.8f)), 0.45f);
     }
 
     createBufferAndVertexArray();
@@ -84,8 +102,9 @@ void Scene::Lights::update() {
 }
 
 void Scene::Lights::genRandomRadiuses() {
+    std::mt19937 engine(seed + 1);
     for (auto& light : lights) {
-        light.position.w = glm::linearRand(rangeLimits.x, rangeLimits.y);
+        light.position.w = random(engine, rangeLimits.x, rangeLimits.y);
     }
 }
 
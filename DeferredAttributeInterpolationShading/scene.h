@@ -1,10 +1,12 @@
 #ifndef DEFERREDATTRIBUTEINTERPOLATIONSHADING_SCENE
 #define DEFERREDATTRIBUTEINTERPOLATIONSHADING_SCENE
 
+#include <cstdint>
 #include <vector>
 
 #include <glm/vec3.hpp>
 #include <tools.h>
+#include <trace.h>
 
 inline std::vector<glm::vec3> createSphereGeometry(float radius, int slices) {
     std::vector<glm::vec3> vertices;
@@ -32,6 +34,7 @@ struct Scene
         int numLights = 256; // Number of lights currently used in the scene
         float rotationSpeed = 0.005;       // Speed of light moving (rotation)
         glm::vec2 rangeLimits{0.2f, 2.0f}; // Light range limits
+        uint32_t seed = 1; // Seed of the random light layout
         std::vector<Light> lights;
         bool rotate = true;           // Rotate lights
         bool showLightCenters = true; // Render light centers
@@ -119,7 +122,16 @@ struct Scene
     Scene(Scene&&) = default;
     Scene& operator=(Scene&&) = default;
 
-    void update() { lights.update(); }
+    // Starts a new frame, scene is updated at most once per frame so that all
+    // algorithms rendered in the same frame see identical scene state
+    void beginFrame() { updated = false; }
+
+    void update() {
+        if (updated) return;
+        Tools::TraceScope traceScope("Scene::update");
+        lights.update();
+        updated = true;
+    }
 
     static Scene& get() {
         static Scene scene{};
@@ -127,6 +139,8 @@ struct Scene
     }
 
 private:
+    bool updated = false; // Scene was updated in the current frame
+
     explicit Scene(int numSpheresPerRow = 5, int numSphereSlices = 20)
       : lights(static_cast<float>(numSpheresPerRow)),
         spheres(numSpheresPerRow, numSphereSlices) {}
@@ -1,39 +1,20 @@
 #version 450 core
 #extension GL_ARB_post_depth_coverage : require
+#ifdef SubgroupDeduplication
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_ballot : require
+#endif
 
 layout(post_depth_coverage) in;
 layout(early_fragment_tests) in;
 
-struct Triangle
-{
-    // in std430, vec3s are not padded to vec4 when in an array or structure.
-    vec4 vertices[3];        // size = 48, offset = 0, alignment = 16
-    uint normalsSnormOct[3]; // size = 12, offset = 48, alignment = 4
-    uint UVsUnorm[3];        // size = 12, offset = 60, alignment = 4
+#include "dais_cache.glsl"
+#include "dais_triangle.glsl"
+#ifdef ObjectSpaceShading
+#include "dais_shading_cache.glsl"
+#endif
 
-    // 96 - 72 = 24 bytes padding
-    uint padding[6]; // size = 24, offset = 72, alignment = 4
-
-    // ---- std430:
-    // size == 96 bytes, alignment = 16
-    // --------------------------------
-};
-
-layout(std140, binding = 1) uniform DAISUniforms {
-    vec4 cameraPosition;       // size = 16, offset = 0, alignment = 16
-    mat4 MVPMatrix;            // size = 64, offset = 16, alignment = 16
-    mat4 MVPMatrixInv;         // size = 64, offset = 80, alignment = 16
-    vec4 Viewport;             // size = 16, offset = 144, alignment = 16
-    int bitwiseModHashSize;    // size = 4, offset = 160, alignment = 4
-    uint trianglesPerSphere;   // size = 4, offset = 164, alignment = 4
-    float projectionMatrix_32; // size = 4, offset = 168, alignment = 4
-    float projectionMatrix_22; // size = 4, offset = 172, alignment = 4
-    uint numSamples;           // size = 4, offset = 176, alignment = 4
-
-    // ---- std140:
-    // size = 180, alignment = 16
-    // -------------------------
-};
+#include "dais_uniforms.glsl"
 
 layout(binding = 0, rgba32ui) coherent
   volatile restrict uniform uimageBuffer cache;
@@ -45,74 +26,220 @@ in flat vec4 vVertices[3];
 in flat uint vNormalsSnormOct[3];
 in flat uint vUVsSnorm[3];
 
+#ifdef FusedDerivatives
+#include "dais_derivatives.glsl"
+
+// Derivatives are computed by the fragment storing the triangle, the
+// triangle record and the compute pass are not needed
+layout(std430,
+       binding = 1) writeonly buffer TriangleDerivativesShaderStorageBuffer {
+#ifdef PackedDerivatives
+    PackedTriangleDerivatives derivatives[];
+#else
+    TriangleDerivatives derivatives[];
+#endif
+};
+#else
 layout(std430, binding = 0) buffer TriangleShaderStorageBuffer {
+#ifdef CompactTriangles
+    CompactTriangle triangles[];
+#else
     Triangle triangles[];
+#endif
 };
+#endif
 
 layout(binding = 0) uniform atomic_uint triangleSSBWriteIndex;
 
-int get_index_from_bucket(uint id, uvec4 bucketValue) {
-    if (bucketValue.x == id) return int(bucketValue.y);
-    if (bucketValue.z == id) return int(bucketValue.w);
+#ifdef CacheStatistics
+// Read back by DeferredAttributeInterpolationShading (CacheCounters)
+layout(binding = 0, offset = 4) uniform atomic_uint cacheLookups;
+layout(binding = 0, offset = 8) uniform atomic_uint cacheInsertions;
+layout(binding = 0, offset = 12) uniform atomic_uint cacheCollisions;
+layout(binding = 0, offset = 16) uniform atomic_uint cacheEvictions;
+layout(binding = 0, offset = 20) uniform atomic_uint cacheRedundantStores;
+layout(binding = 0, offset = 24) uniform atomic_uint cacheSharedLookups;
+#define COUNT(counter) atomicCounterIncrement(counter)
+#else
+#define COUNT(counter)
+#endif
+
+// Index stored for the id in the set, -1 if not present
+int findInCacheSet(uint id, uint set) {
+    for (uint t = 0u; t < cacheTexelsPerSet; t++) {
+        uvec4 b = imageLoad(cache, int(set * cacheTexelsPerSet + t));
+        if (b.x == id) return int(b.y);
+        if (b.z == id) return int(b.w);
+        // Sets are filled from the front
+        if (b.z == DAIS_CACHE_EMPTY) break;
+    }
     return -1;
 }
 
+int findInCache(uint id, uint home) {
+    int index = -1;
+    for (uint p = 0u; index < 0 && p < getNumCacheProbes(cacheProbing); p++)
+        index = findInCacheSet(id, probeCacheSet(home, p, cacheProbing,
+                                                 uint(bitwiseModHashSize)));
+    return index;
+}
+
+bool isCacheSetFull(uint set) {
+    int last = int((set + 1u) * cacheTexelsPerSet - 1u);
+    return imageLoad(cache, last).z != DAIS_CACHE_EMPTY;
+}
+
+// Pushes the entry to the front of the set FIFO, returns true if a valid
+// entry was dropped. The caller holds the lock of the set.
+bool insertIntoCacheSet(uint set, uvec2 entry) {
+    for (uint t = 0u; t < cacheTexelsPerSet; t++) {
+        int texel = int(set * cacheTexelsPerSet + t);
+        uvec4 b = imageLoad(cache, texel);
+        imageStore(cache, texel, uvec4(entry, b.xy));
+        entry = b.zw;
+        if (entry.x == DAIS_CACHE_EMPTY) return false;
+    }
+    return true;
+}
+
 const int LOCKED = 1;
 const int UNLOCKED = 0;
 
 bool lookupMemoizationCache(uint id, out int index) {
+    COUNT(cacheLookups);
     bool store_sample = false;
-    int hash = int(id) & bitwiseModHashSize;
-    uvec4 b = imageLoad(cache, hash);
-    index = get_index_from_bucket(id, b);
+    uint setMask = uint(bitwiseModHashSize);
+    uint home = hashTriangleID(id, cacheHash, setMask);
+    index = findInCache(id, home);
     for (int k = 0; index < 0 && k < 1024; k++) {
         // ID not found in cache, make several attempts.
-        uint lock = imageAtomicExchange(locks, hash, LOCKED);
+        uint lock = imageAtomicExchange(locks, int(home), LOCKED);
         if (lock == UNLOCKED) {
-            // Gain exclusive access to the bucket.
-            b = imageLoad(cache, hash);
-            index = get_index_from_bucket(id, b);
+            // Gain exclusive access to the home set, triangles are only
+            // inserted by the holder of the lock of their home set.
+            index = findInCache(id, home);
             if (index < 0) {
                 // Allocate new storage.index
                 index = int(atomicCounterIncrement(triangleSSBWriteIndex));
-                b.zw = b.xy; // Update bucket FIFO.
-                b.xy = uvec2(id, index);
-                imageStore(cache, hash, b);
+                COUNT(cacheInsertions);
+                uint set = home;
+                if (isCacheSetFull(home)) {
+                    COUNT(cacheCollisions);
+                    // Probed sets are only tried, waiting for their locks
+                    // while holding the home lock could deadlock
+                    for (uint p = 1u;
+                         set == home && p < getNumCacheProbes(cacheProbing);
+                         p++) {
+                        uint probed
+                          = probeCacheSet(home, p, cacheProbing, setMask);
+                        if (imageAtomicExchange(locks, int(probed), LOCKED)
+                            == UNLOCKED) {
+                            if (!isCacheSetFull(probed)) {
+                                insertIntoCacheSet(probed, uvec2(id, index));
+                                set = probed;
+                            }
+                            imageStore(locks, int(probed), uvec4(UNLOCKED));
+                        }
+                    }
+                }
+                // Update home set FIFO.
+                if (set == home && insertIntoCacheSet(home, uvec2(id, index)))
+                    COUNT(cacheEvictions);
                 store_sample = true;
             }
-            imageStore(locks, hash, uvec4(UNLOCKED));
+            imageStore(locks, int(home), uvec4(UNLOCKED));
         }
         // Use if (expr){} if (!expr) {} construct to explicitly sequence the
         // branches
         if (lock == LOCKED) {
             for (int i = 0; i < 128 && lock == LOCKED; i++) {
-                lock = imageLoad(locks, hash).r;
+                lock = imageLoad(locks, int(home)).r;
             }
-            b = imageLoad(cache, hash);
-            index = get_index_from_bucket(id, b);
+            index = findInCache(id, home);
         }
     }
     if (index < 0) { // Cache lookup failed, store redundantly.
         index = int(atomicCounterIncrement(triangleSSBWriteIndex));
+        COUNT(cacheRedundantStores);
         store_sample = true;
     }
     return store_sample;
 }
 
+#ifdef SubgroupDeduplication
+// Fragments of the subgroup covering the same triangle share one lookup,
+// performed by the first of them, and only that fragment stores the triangle
+bool lookupMemoizationCacheSubgroup(uint id, out int index) {
+    index = -1;
+    // Stores and atomics of helper invocations have no effect
+    if (gl_HelperInvocation) return false;
+
+    bool store_sample = false;
+    bool done = false;
+    while (!done) {
+        // Triangle of the first remaining fragment
+        if (id == subgroupBroadcastFirst(id)) {
+            int leaderIndex = 0;
+            if (subgroupElect()) {
+                store_sample = lookupMemoizationCache(id, leaderIndex);
+            } else {
+                COUNT(cacheSharedLookups);
+            }
+            index = subgroupBroadcastFirst(leaderIndex);
+            done = true;
+        }
+    }
+    return store_sample;
+}
+#endif
+
 layout(location = 0) out uvec4 TriangleIndex;
 
 void main() {
     int index = 0;
-    if (lookupMemoizationCache(int(gl_PrimitiveID), index)) {
+#ifdef SubgroupDeduplication
+    bool store_sample
+      = lookupMemoizationCacheSubgroup(uint(gl_PrimitiveID), index);
+#else
+    bool store_sample = lookupMemoizationCache(uint(gl_PrimitiveID), index);
+#endif
+    if (store_sample) {
+#ifdef ObjectSpaceShading
+        storeShadingCacheRecord(uint(index), uint(gl_PrimitiveID), vVertices);
+#endif
+#ifdef FusedDerivatives
+        vec3 normals[3];
+        vec2 UVs[3];
+        uncompressVertexAttributes(vNormalsSnormOct, vUVsSnorm, normals, UVs);
+        TriangleDerivatives triangleDerivatives;
+        computeAttributeDerivatives(vVertices, UVs, normals,
+                                    triangleDerivatives);
+#ifdef PackedDerivatives
+        PackedTriangleDerivatives packedDerivatives;
+        packTriangleDerivatives(triangleDerivatives, packedDerivatives);
+        derivatives[index] = packedDerivatives;
+#else
+        derivatives[index] = triangleDerivatives;
+#endif
+#else
+#ifdef CompactTriangles
+        for (int i = 0; i < 3; i++) {
+            triangles[index].positionsXYW[i * 3] = vVertices[i].x;
+            triangles[index].positionsXYW[i * 3 + 1] = vVertices[i].y;
+            triangles[index].positionsXYW[i * 3 + 2] = vVertices[i].w;
+        }
+#else
         triangles[index].vertices[0] = vVertices[0];
         triangles[index].vertices[1] = vVertices[1];
         triangles[index].vertices[2] = vVertices[2];
+#endif
         triangles[index].normalsSnormOct[0] = vNormalsSnormOct[0];
         triangles[index].normalsSnormOct[1] = vNormalsSnormOct[1];
         triangles[index].normalsSnormOct[2] = vNormalsSnormOct[2];
         triangles[index].UVsUnorm[0] = vUVsSnorm[0];
         triangles[index].UVsUnorm[1] = vUVsSnorm[1];
         triangles[index].UVsUnorm[2] = vUVsSnorm[2];
+#endif
     }
 
     int coverage = gl_SampleMaskIn[0];
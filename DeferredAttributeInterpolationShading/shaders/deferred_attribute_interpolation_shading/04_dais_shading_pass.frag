@@ -2,117 +2,92 @@
 
 layout(early_fragment_tests) in;
 
-struct TriangleDerivatives
-{
-    // Partial derivatives of each attribute for x and y
-    vec2 dUV_dX;     // size = 8, offset = 0, alignment = 8
-    vec2 dUV_dY;     // size = 8, offset = 8, alignment = 8
-    float dW_dX;     // size = 4, offset = 16, alignment = 4
-    float dW_dY;     // size = 4, offset = 20, alignment = 4
-    vec3 dNormal_dX; // size = 12, offset = 32, alignment = 16
-    vec3 dNormal_dY; // size = 12, offset = 48, alignment = 16
-
-    // Attribute values shifted to (0,0) in screenspace
-    vec2 UV_fixed;        // size = 8, offset = 64, alignment = 8
-    vec3 normal_fixed;    // size = 12, offset = 80, alignment = 16
-    float oneOverW_fixed; // size = 4, offset = 92, alignment = 4
-
-    // ---- std430:
-    //  size = 96 bytes, alignment = 16
-    // --------------------------------
-};
+#ifndef MSAA_SAMPLES
+#define MSAA_SAMPLES 0
+#endif
 
-struct Light
-{
-    vec4 position; // (x, y, z, radius)
-    vec4 color;
-};
+#include "dais_derivatives.glsl"
+#include "dais_lighting.glsl"
+#ifdef ObjectSpaceShading
+#include "dais_shading_cache.glsl"
+#endif
 
-layout(std430, binding = 0) buffer TriangleDerivativesShaderStorageBuffer {
-    TriangleDerivatives derivatives[];
-};
-layout(std430, binding = 2) buffer LightBuffer {
-    uint numLights; // size = 4, offset = 0
-    Light lights[]; // size = 32, offset = 16, alignment = 16
-};
+#ifdef TileClassification
+#include "tile_lists.glsl"
 
-layout(std140, binding = 1) uniform DAISUniforms {
-    vec4 cameraPosition;       // size = 16, offset = 0, alignment = 16
-    mat4 MVPMatrix;            // size = 64, offset = 16, alignment = 16
-    mat4 MVPMatrixInv;         // size = 64, offset = 80, alignment = 16
-    vec4 Viewport;             // size = 16, offset = 144, alignment = 16
-    int bitwiseModHashSize;    // size = 4, offset = 160, alignment = 4
-    uint trianglesPerSphere;   // size = 4, offset = 164, alignment = 4
-    float projectionMatrix_32; // size = 4, offset = 168, alignment = 4
-    float projectionMatrix_22; // size = 4, offset = 172, alignment = 4
-    uint numSamples;           // size = 4, offset = 176, alignment = 4
-
-    // ---- std140:
-    // size = 180, alignment = 16
-    // -------------------------
+flat in uint vTileTriangle;
+#endif
+
+layout(std430, binding = 1) buffer TriangleDerivativesShaderStorageBuffer {
+#ifdef PackedDerivatives
+    PackedTriangleDerivatives derivatives[];
+#else
+    TriangleDerivatives derivatives[];
+#endif
 };
 
 layout(binding = 0) uniform isampler2D TriangleIndexSampler;
 layout(binding = 4) uniform isampler2DMS TriangleAddressMultiSampler;
 layout(binding = 3) uniform sampler2D AlbedoSampler;
 
-layout(location = 0) out vec4 FragColor;
-
-// Simple phong lighting
-vec3 calculateLightContribution(in uint lightIdx, in vec3 vertex,
-                                in vec3 normal, in vec4 diffSpecColor) {
-    vec4 lightPos = lights[lightIdx].position;
-
-    // Check if point is out of the light's range
-    vec3 lightDir = lightPos.xyz - vertex;
-    float distance = length(lightDir);
-    if (distance > lightPos.w) return vec3(0.0);
-
-    // Get light color
-    vec4 color = lights[lightIdx].color;
-
-    // Calculate light attenuation factor
-    // float attenuation = 1.0;
-    float attenuation = 1.0 - distance / lightPos.w;
-
-    // Calculate diffuse color component
-    lightDir = normalize(lightDir);
-    float NdotL = max(dot(normal, lightDir), 0.0);
-    vec3 lightContribution = color.rgb * diffSpecColor.rgb * NdotL;
+#ifdef AdaptiveShadingRate
+// Written by 03_dais_coarse_shading.comp, alpha 0 for pixels shaded here
+layout(binding = 2, rgba8) readonly uniform image2D CoarseShadingImage;
+#endif
 
-    // Calculate specular color component
-    vec3 viewDir = normalize(cameraPosition.xyz - vertex);
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float NdotH = pow(max(dot(normal, halfwayDir), 0.0), 5.0);
-    // Multiply by NdotL to
-    lightContribution += color.aaa * diffSpecColor.a * NdotH * NdotL;
+layout(location = 0) out vec4 FragColor;
 
-    return lightContribution * attenuation;
+TriangleDerivatives loadDerivatives(int index) {
+#ifdef PackedDerivatives
+    TriangleDerivatives result;
+    unpackTriangleDerivatives(derivatives[index], result);
+    return result;
+#else
+    return derivatives[index];
+#endif
 }
 
 vec3 shadePixel(int index, vec2 ndcPosXY) {
     vec4 ndcPos = vec4(ndcPosXY, 0, 1);
+    TriangleDerivatives triangle = loadDerivatives(index);
 
-    float oneOverW
-      = (derivatives[index].oneOverW_fixed + ndcPos.x * derivatives[index].dW_dX
-         + ndcPos.y * derivatives[index].dW_dY);
+    float oneOverW = (triangle.oneOverW_fixed + ndcPos.x * triangle.dW_dX
+                      + ndcPos.y * triangle.dW_dY);
 
     ndcPos.z = projectionMatrix_32 * oneOverW - projectionMatrix_22;
 
     vec4 clipPos = ndcPos / oneOverW;
     vec4 worldPos = MVPMatrixInv * clipPos;
 
-    vec3 normal = (derivatives[index].normal_fixed //
-                   + ndcPos.x * derivatives[index].dNormal_dX
-                   + ndcPos.y * derivatives[index].dNormal_dY)
+    vec3 normal = (triangle.normal_fixed //
+                   + ndcPos.x * triangle.dNormal_dX
+                   + ndcPos.y * triangle.dNormal_dY)
                   / oneOverW;
 
-    vec2 uv = (derivatives[index].UV_fixed //
-               + ndcPos.x * derivatives[index].dUV_dX
-               + ndcPos.y * derivatives[index].dUV_dY)
+    vec2 uv = (triangle.UV_fixed //
+               + ndcPos.x * triangle.dUV_dX + ndcPos.y * triangle.dUV_dY)
               / oneOverW;
 
+#ifdef AnalyticGradients
+    // Implicit derivatives of the fullscreen pass span pixels of different
+    // triangles, differentiate uv = UV / (1 / w) over one pixel instead
+    vec2 ndcPerPixel = 2.0 / (Viewport.zw - Viewport.xy);
+    vec2 dUVdx = (triangle.dUV_dX - uv * triangle.dW_dX) / oneOverW;
+    vec2 dUVdy = (triangle.dUV_dY - uv * triangle.dW_dY) / oneOverW;
+    vec4 diffSpecColor = textureGrad(AlbedoSampler, uv, dUVdx * ndcPerPixel.x,
+                                     dUVdy * ndcPerPixel.y);
+#else
     vec4 diffSpecColor = texture(AlbedoSampler, uv);
+#endif
+#ifdef ObjectSpaceShading
+    // Lighting comes from the lattice of the triangle, the albedo is still
+    // sampled per pixel
+    ShadingCacheRecord record = shadingCacheRecords[index];
+    if (record.block != SHADING_CACHE_NO_BLOCK) {
+        vec4 light = lookupShadingCache(record, ndcPosXY);
+        return light.rgb * diffSpecColor.rgb + light.a * diffSpecColor.a;
+    }
+#endif
     vec3 retval = vec3(0);
     for (uint i = 0; i < numLights; ++i) {
         retval
@@ -123,7 +98,7 @@ vec3 shadePixel(int index, vec2 ndcPosXY) {
 
 vec3 shadeMultisample(vec2 ndcPosXY) {
     // mask stores which samples need to be shaded
-    uint mask = (1 << numSamples) - 1;
+    uint mask = (1 << MSAA_SAMPLES) - 1;
     vec3 accum = vec3(0.0);
 
     while (mask > 0) {
@@ -142,25 +117,37 @@ vec3 shadeMultisample(vec2 ndcPosXY) {
             mask &= ~(1 << i);  // mark shaded sample
         }
     }
-    return accum / float(numSamples);
+    return accum / float(MSAA_SAMPLES);
 }
 
 void main() {
+#ifdef AdaptiveShadingRate
+    vec4 coarseColor = imageLoad(CoarseShadingImage, ivec2(gl_FragCoord.xy));
+    if (coarseColor.a > 0.0) {
+        FragColor = vec4(coarseColor.rgb, 1.0);
+        return;
+    }
+#endif
     // precalculate ndcPosXY that will be same for all shaded samples
     vec2 viewportSize = Viewport.zw - Viewport.xy;
     vec2 ndcPosXY = (gl_FragCoord.xy - Viewport.xy) / viewportSize * 2 - 1;
 
-    if (numSamples > 0) {
+#ifdef TileClassification
+    // All samples of the tile are covered by one triangle
+    if (vTileTriangle != COMPLEX_TILE) {
+        FragColor = vec4(shadePixel(int(vTileTriangle), ndcPosXY), 1.0);
+        return;
+    }
+#endif
+#if MSAA_SAMPLES > 0
 #ifdef AggressiveMultisampleDiscard
-        int index0
-          = texelFetch(TriangleIndexSampler, ivec2(gl_FragCoord.xy), 0).r;
-        if (index0 == -1) discard;
+    int index0 = texelFetch(TriangleIndexSampler, ivec2(gl_FragCoord.xy), 0).r;
+    if (index0 == -1) discard;
+#endif
+    FragColor = vec4(shadeMultisample(ndcPosXY), 1.0);
+#else
+    int index = texelFetch(TriangleIndexSampler, ivec2(gl_FragCoord.xy), 0).r;
+    if (index == -1) discard;
+    FragColor = vec4(shadePixel(index & 0x00ffffff, ndcPosXY), 1.0);
 #endif
-        FragColor = vec4(shadeMultisample(ndcPosXY), 1.0);
-    } else {
-        int index
-          = texelFetch(TriangleIndexSampler, ivec2(gl_FragCoord.xy), 0).r;
-        if (index == -1) discard;
-        FragColor = vec4(shadePixel(index & 0x00ffffff, ndcPosXY), 1.0);
-    }
 }
@@ -1,10 +1,22 @@
 #version 450 core
 
+#ifdef TileClassification
+#define TILE_LISTS_DRAW
+#include "tile_lists.glsl"
+
+// Triangle covering the whole tile or COMPLEX_TILE
+flat out uint vTileTriangle;
+#endif
+
 void main(void) {
+#ifdef TileClassification
+    gl_Position = getTileVertexPosition(vTileTriangle);
+#else
     // Full-screen triangle
     // glVertexId == 0 => vec2(-1, -1)
     // glVertexId == 1 => vec2(3, -1)
     // glVertexId == 2 => vec2(-1, 3)
     vec2 xy = vec2((gl_VertexID & 1) << 2,(gl_VertexID & 2) << 1) - vec2(1.0);
     gl_Position = vec4(xy, 0.0, 1.0);
+#endif
 }
@@ -0,0 +1,64 @@
+//-----------------------------------------------------------------------------
+// Set-associative memoization cache of the geometry pass: hash functions and
+// probe sequences.
+//
+// Included by 02_dais_geometry_pass.frag and compiled as C++ by the CPU
+// reference (DAISReference/include/cache_kernel.h), the restrictions of
+// dais_derivatives.glsl apply.
+//
+// The cache image stores (id, index) pairs, two per rgba32ui texel. A set of
+// N ways occupies N / 2 consecutive texels, its entries are kept in FIFO
+// order (newest first) and empty entries have id DAIS_CACHE_EMPTY.
+//-----------------------------------------------------------------------------
+#ifndef DAIS_CACHE_GLSL
+#define DAIS_CACHE_GLSL
+
+#ifndef __cplusplus
+#define DAIS_FUNCTION
+#endif
+
+// Values of the cacheHash uniform
+const uint DAIS_CACHE_HASH_MASK = 0u;           // id % number of sets
+const uint DAIS_CACHE_HASH_MULTIPLICATIVE = 1u; // Fibonacci hashing
+const uint DAIS_CACHE_HASH_MURMUR = 2u;         // MurmurHash3 finalizer
+
+// Values of the cacheProbing uniform
+const uint DAIS_CACHE_PROBING_NONE = 0u;      // Home set only
+const uint DAIS_CACHE_PROBING_LINEAR = 1u;    // home + i
+const uint DAIS_CACHE_PROBING_QUADRATIC = 2u; // home + i * i
+const uint DAIS_CACHE_MAX_PROBES = 4u;
+
+const uint DAIS_CACHE_EMPTY = 0xFFFFFFFFu;
+
+// Home set of the triangle, setMask == number of sets - 1 (power of two, at
+// least 2 sets)
+DAIS_FUNCTION uint hashTriangleID(uint id, uint hashFunction, uint setMask) {
+    if (hashFunction == DAIS_CACHE_HASH_MULTIPLICATIVE) {
+        // The high bits of the product depend on all bits of the id, so
+        // consecutive ids of neighbouring spheres are spread over the table
+        return (id * 2654435769u) >> (32u - uint(bitCount(setMask)));
+    }
+    if (hashFunction == DAIS_CACHE_HASH_MURMUR) {
+        id ^= id >> 16u;
+        id *= 0x85EBCA6Bu;
+        id ^= id >> 13u;
+        id *= 0xC2B2AE35u;
+        id ^= id >> 16u;
+    }
+    return id & setMask;
+}
+
+// Number of sets a lookup visits
+DAIS_FUNCTION uint getNumCacheProbes(uint probing) {
+    return probing == DAIS_CACHE_PROBING_NONE ? 1u : DAIS_CACHE_MAX_PROBES;
+}
+
+// Set visited by the probe-th step of the sequence starting at home
+DAIS_FUNCTION uint probeCacheSet(uint home, uint probe, uint probing,
+                                 uint setMask) {
+    const uint offset
+      = probing == DAIS_CACHE_PROBING_QUADRATIC ? probe * probe : probe;
+    return (home + offset) & setMask;
+}
+
+#endif // DAIS_CACHE_GLSL
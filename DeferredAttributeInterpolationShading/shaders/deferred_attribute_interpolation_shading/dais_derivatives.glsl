@@ -0,0 +1,202 @@
+//-----------------------------------------------------------------------------
+// Screen-space partial derivatives of triangle attributes.
+//
+// Included by 03_dais_compute_pass.comp and 04_dais_shading_pass.frag and
+// compiled as C++ by the CPU reference (DAISReference/include/
+// derivative_kernel.h), so the code has to stay valid in both languages: no
+// swizzles, no implicit double literals, functions, in/out parameters and
+// array parameters use the DAIS_* macros.
+//-----------------------------------------------------------------------------
+#ifndef DAIS_DERIVATIVES_GLSL
+#define DAIS_DERIVATIVES_GLSL
+
+#ifndef __cplusplus
+#define DAIS_FUNCTION
+#define DAIS_IN(type) in type
+#define DAIS_INOUT(type) inout type
+#define DAIS_OUT(type) out type
+#define DAIS_IN_ARRAY3(type, name) in type name[3]
+#endif
+
+struct TriangleDerivatives
+{
+    // Partial derivatives of each attribute for x and y
+    vec2 dUV_dX;     // size = 8, offset = 0, alignment = 8
+    vec2 dUV_dY;     // size = 8, offset = 8, alignment = 8
+    float dW_dX;     // size = 4, offset = 16, alignment = 4
+    float dW_dY;     // size = 4, offset = 20, alignment = 4
+    vec3 dNormal_dX; // size = 12, offset = 32, alignment = 16
+    vec3 dNormal_dY; // size = 12, offset = 48, alignment = 16
+
+    // Attribute values shifted to (0,0) in screenspace
+    vec2 UV_fixed;        // size = 8, offset = 64, alignment = 8
+    vec3 normal_fixed;    // size = 12, offset = 80, alignment = 16
+    float oneOverW_fixed; // size = 4, offset = 92, alignment = 4
+
+    // ---- std430:
+    //  size = 96 bytes, alignment = 16
+    // --------------------------------
+};
+
+// TriangleDerivatives with UV and normal terms stored as fp16 pairs
+// (packHalf2x16). The 1/w terms stay fp32, their error is amplified by the
+// perspective division of every attribute.
+struct PackedTriangleDerivatives
+{
+    // dUV_dX, dUV_dY, UV_fixed, (normal_fixed.z, unused)
+    uvec4 UVs; // size = 16, offset = 0, alignment = 16
+    // dNormal_dX.xy, dNormal_dY.xy, normal_fixed.xy, (dNormal_dX.z,
+    // dNormal_dY.z)
+    uvec4 normals; // size = 16, offset = 16, alignment = 16
+    // dW_dX, dW_dY, oneOverW_fixed, unused
+    vec4 oneOverW; // size = 16, offset = 32, alignment = 16
+
+    // ---- std430:
+    //  size = 48 bytes, alignment = 16
+    // --------------------------------
+};
+
+DAIS_FUNCTION void packTriangleDerivatives(
+  DAIS_IN(TriangleDerivatives) derivatives,
+  DAIS_OUT(PackedTriangleDerivatives) packed) {
+    packed.UVs = uvec4(packHalf2x16(derivatives.dUV_dX),
+                       packHalf2x16(derivatives.dUV_dY),
+                       packHalf2x16(derivatives.UV_fixed),
+                       packHalf2x16(vec2(derivatives.normal_fixed.z, 0.0f)));
+    packed.normals
+      = uvec4(packHalf2x16(vec2(derivatives.dNormal_dX)),
+              packHalf2x16(vec2(derivatives.dNormal_dY)),
+              packHalf2x16(vec2(derivatives.normal_fixed)),
+              packHalf2x16(
+                vec2(derivatives.dNormal_dX.z, derivatives.dNormal_dY.z)));
+    packed.oneOverW = vec4(derivatives.dW_dX, derivatives.dW_dY,
+                           derivatives.oneOverW_fixed, 0.0f);
+}
+
+DAIS_FUNCTION void unpackTriangleDerivatives(
+  DAIS_IN(PackedTriangleDerivatives) packed,
+  DAIS_OUT(TriangleDerivatives) derivatives) {
+    const vec2 dNormal_dZ = unpackHalf2x16(packed.normals.w);
+    derivatives.dUV_dX = unpackHalf2x16(packed.UVs.x);
+    derivatives.dUV_dY = unpackHalf2x16(packed.UVs.y);
+    derivatives.UV_fixed = unpackHalf2x16(packed.UVs.z);
+    derivatives.dNormal_dX
+      = vec3(unpackHalf2x16(packed.normals.x), dNormal_dZ.x);
+    derivatives.dNormal_dY
+      = vec3(unpackHalf2x16(packed.normals.y), dNormal_dZ.y);
+    derivatives.normal_fixed = vec3(unpackHalf2x16(packed.normals.z),
+                                    unpackHalf2x16(packed.UVs.w).x);
+    derivatives.dW_dX = packed.oneOverW.x;
+    derivatives.dW_dY = packed.oneOverW.y;
+    derivatives.oneOverW_fixed = packed.oneOverW.z;
+}
+
+DAIS_FUNCTION void shrinkTriangle(DAIS_INOUT(mat3x4) pos,
+                                  DAIS_INOUT(mat3x2) UVs,
+                                  DAIS_INOUT(mat3) normals, const int axis,
+                                  const bool isMin) {
+    const uint v0 = 1u, v1 = 2u, v2 = 4u;
+    uint clipMask = 0u;
+    if (isMin) {
+        clipMask |= pos[0][axis] < -pos[0].w ? v0 : 0u;
+        clipMask |= pos[1][axis] < -pos[1].w ? v1 : 0u;
+        clipMask |= pos[2][axis] < -pos[2].w ? v2 : 0u;
+    } else {
+        clipMask |= pos[0][axis] > pos[0].w ? v0 : 0u;
+        clipMask |= pos[1][axis] > pos[1].w ? v1 : 0u;
+        clipMask |= pos[2][axis] > pos[2].w ? v2 : 0u;
+    }
+
+    float a, b1, b2;
+
+// Push the vertex on edge from->to
+#define PUSH_VERTEX(from, to)                                   \
+    b1 = isMin ? pos[to][axis] : -pos[to][axis];                \
+    b2 = isMin ? pos[from][axis] : -pos[from][axis];            \
+    a = (pos[to].w + b1) / (pos[to].w - pos[from].w + b1 - b2); \
+    pos[from] = mix(pos[to], pos[from], a);                     \
+    UVs[from] = mix(UVs[to], UVs[from], a);                     \
+    normals[from] = mix(normals[to], normals[from], a);
+
+    // only 2 vertices may be outside since the triangle is visible
+    switch (clipMask) {
+        case v2 | v0:
+            PUSH_VERTEX(2, 1);
+        case v0:
+            PUSH_VERTEX(0, 1);
+            break;
+        case v0 | v1:
+            PUSH_VERTEX(0, 2);
+        case v1:
+            PUSH_VERTEX(1, 2);
+            break;
+        case v1 | v2:
+            PUSH_VERTEX(1, 0);
+        case v2:
+            PUSH_VERTEX(2, 0);
+            break;
+    }
+#undef PUSH_VERTEX
+}
+
+DAIS_FUNCTION void computeBarycentricDerivatives(DAIS_IN_ARRAY3(vec2, pos),
+                                                 DAIS_OUT(vec3) db_dx,
+                                                 DAIS_OUT(vec3) db_dy) {
+    float det = determinant(mat2(pos[2] - pos[1], pos[0] - pos[1]));
+
+    db_dx[0] = (pos[1].y - pos[2].y) / det;
+    db_dx[1] = (pos[2].y - pos[0].y) / det;
+    db_dx[2] = (pos[0].y - pos[1].y) / det;
+
+    db_dy[0] = (pos[2].x - pos[1].x) / det;
+    db_dy[1] = (pos[0].x - pos[2].x) / det;
+    db_dy[2] = (pos[1].x - pos[0].x) / det;
+}
+
+// vertices are clip-space positions, UVs and normals uncompressed attributes
+DAIS_FUNCTION void computeAttributeDerivatives(
+  DAIS_IN_ARRAY3(vec4, vertices), DAIS_IN_ARRAY3(vec2, vertexUVs),
+  DAIS_IN_ARRAY3(vec3, vertexNormals),
+  DAIS_OUT(TriangleDerivatives) derivatives) {
+    mat3x4 pos;
+    mat3x2 UVs;
+    mat3x3 normals;
+    for (int i = 0; i < 3; i++) {
+        pos[i] = vertices[i];
+        UVs[i] = vertexUVs[i];
+        normals[i] = vertexNormals[i];
+    }
+
+    for (int i = 0; i < 3; i++) {
+        shrinkTriangle(pos, UVs, normals, i, true);
+        shrinkTriangle(pos, UVs, normals, i, false);
+    }
+
+    vec3 oneOverW = 1.0f / vec3(pos[0].w, pos[1].w, pos[2].w);
+    vec2 posScreen[3];
+
+    for (int i = 0; i < 3; i++) {
+        posScreen[i] = vec2(pos[i]) * oneOverW[i];
+        UVs[i] *= oneOverW[i];
+        normals[i] *= oneOverW[i];
+    }
+    vec3 db_dx, db_dy;
+    computeBarycentricDerivatives(posScreen, db_dx, db_dy);
+
+    derivatives.dNormal_dX = normals * db_dx;
+    derivatives.dNormal_dY = normals * db_dy;
+    derivatives.dUV_dX = UVs * db_dx;
+    derivatives.dUV_dY = UVs * db_dy;
+    derivatives.dW_dX = dot(oneOverW, db_dx);
+    derivatives.dW_dY = dot(oneOverW, db_dy);
+
+    vec2 o = -posScreen[0];
+    derivatives.oneOverW_fixed
+      = oneOverW[0] + o.x * derivatives.dW_dX + o.y * derivatives.dW_dY;
+    derivatives.UV_fixed
+      = UVs[0] + o.x * derivatives.dUV_dX + o.y * derivatives.dUV_dY;
+    derivatives.normal_fixed = normals[0] + o.x * derivatives.dNormal_dX
+                               + o.y * derivatives.dNormal_dY;
+}
+
+#endif // DAIS_DERIVATIVES_GLSL
@@ -0,0 +1,56 @@
+//-----------------------------------------------------------------------------
+// Lights of the scene (Scene::Lights in scene.h) and the phong lighting of
+// the shading passes. The object-space shading pass accumulates the lighting
+// without the albedo, which is applied when its samples are interpolated.
+//-----------------------------------------------------------------------------
+#ifndef DAIS_LIGHTING_GLSL
+#define DAIS_LIGHTING_GLSL
+
+#include "dais_uniforms.glsl"
+
+struct Light
+{
+    vec4 position; // (x, y, z, radius)
+    vec4 color;
+};
+
+layout(std430, binding = 2) readonly buffer LightBuffer {
+    uint numLights; // size = 4, offset = 0
+    Light lights[]; // size = 32, offset = 16, alignment = 16
+};
+
+// Simple phong lighting without the albedo
+void accumulateLightContribution(in uint lightIdx, in vec3 vertex,
+                                 in vec3 normal, inout vec3 diffuse,
+                                 inout float specular) {
+    vec4 lightPos = lights[lightIdx].position;
+
+    // Check if point is out of the light's range
+    vec3 lightDir = lightPos.xyz - vertex;
+    float distance = length(lightDir);
+    if (distance > lightPos.w) return;
+
+    vec4 color = lights[lightIdx].color;
+    float attenuation = 1.0 - distance / lightPos.w;
+
+    lightDir = normalize(lightDir);
+    float NdotL = max(dot(normal, lightDir), 0.0);
+    diffuse += color.rgb * NdotL * attenuation;
+
+    vec3 viewDir = normalize(cameraPosition.xyz - vertex);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float NdotH = pow(max(dot(normal, halfwayDir), 0.0), 5.0);
+    specular += color.a * NdotH * NdotL * attenuation;
+}
+
+// Simple phong lighting, diffSpecColor is the albedo (rgb) and the specular
+// intensity (a)
+vec3 calculateLightContribution(in uint lightIdx, in vec3 vertex,
+                                in vec3 normal, in vec4 diffSpecColor) {
+    vec3 diffuse = vec3(0.0);
+    float specular = 0.0;
+    accumulateLightContribution(lightIdx, vertex, normal, diffuse, specular);
+    return diffuse * diffSpecColor.rgb + specular * diffSpecColor.a;
+}
+
+#endif // DAIS_LIGHTING_GLSL
@@ -0,0 +1,134 @@
+//-----------------------------------------------------------------------------
+// Object-space shading cache of the ObjectSpaceShading option (ShadingCache
+// in algorithms/shading_cache.h).
+//
+// The geometry pass stores a record next to each stored triangle, the object
+// space shading pass evaluates the lighting of the triangle at the samples of
+// a barycentric lattice and the shading pass interpolates the lattice. Blocks
+// of samples are kept for the triangle (gl_PrimitiveID) while the epoch of
+// the cache does not change, so they are reused across frames and samples.
+//-----------------------------------------------------------------------------
+#ifndef DAIS_SHADING_CACHE_GLSL
+#define DAIS_SHADING_CACHE_GLSL
+
+// Triangle shaded directly by the shading pass
+const uint SHADING_CACHE_NO_BLOCK = 0xFFFFFFFFu;
+// Blocks are offset | level << SHADING_CACHE_LEVEL_SHIFT, the lattice of a
+// level has 2^level samples along each edge of the triangle
+const uint SHADING_CACHE_LEVEL_SHIFT = 27u;
+const uint SHADING_CACHE_MAX_LEVEL = 5u;
+
+struct ShadingCacheRecord
+{
+    // NDC x, y and 1 / w of the vertices, 1 / w <= 0 for vertices behind the
+    // camera
+    float vertices[9]; // size = 36, offset = 0, alignment = 4
+    uint triangleID;   // size = 4, offset = 36, alignment = 4
+    uint block;        // size = 4, offset = 40, alignment = 4
+    uint padding;      // size = 4, offset = 44, alignment = 4
+
+    // ---- std430:
+    // size == 48 bytes, alignment = 4
+    // --------------------------------
+};
+
+layout(std430, binding = 4) buffer ShadingCacheBuffer {
+    uint numAllocatedTexels; // size = 4, offset = 0, alignment = 4
+    uint capacity;           // size = 4, offset = 4, alignment = 4
+    uint epoch;              // size = 4, offset = 8, alignment = 4
+    float pixelsPerSample;   // size = 4, offset = 12, alignment = 4
+    // (packHalf2x16(diffuse.rg), packHalf2x16(diffuse.b, specular))
+    uvec2 shadingCacheTexels[]; // size = 8, offset = 16, alignment = 8
+};
+
+// (epoch, block) of the last block allocated for each triangle of the scene
+layout(std430, binding = 5) buffer ShadingCacheEntryBuffer {
+    uvec2 shadingCacheEntries[];
+};
+
+// Indexed like the triangle records and derivatives
+layout(std430, binding = 6) buffer ShadingCacheRecordBuffer {
+    ShadingCacheRecord shadingCacheRecords[];
+};
+
+void storeShadingCacheRecord(uint index, uint triangleID, vec4 vertices[3]) {
+    for (int i = 0; i < 3; i++) {
+        float oneOverW = vertices[i].w > 0.0 ? 1.0 / vertices[i].w : -1.0;
+        shadingCacheRecords[index].vertices[i * 3] = vertices[i].x * oneOverW;
+        shadingCacheRecords[index].vertices[i * 3 + 1]
+          = vertices[i].y * oneOverW;
+        shadingCacheRecords[index].vertices[i * 3 + 2] = oneOverW;
+    }
+    shadingCacheRecords[index].triangleID = triangleID;
+    shadingCacheRecords[index].block = SHADING_CACHE_NO_BLOCK;
+}
+
+uint getShadingCacheLevel(uint block) {
+    return block >> SHADING_CACHE_LEVEL_SHIFT;
+}
+
+uint getShadingCacheOffset(uint block) {
+    return block & ((1u << SHADING_CACHE_LEVEL_SHIFT) - 1u);
+}
+
+uint getNumShadingCacheSamples(uint level) {
+    uint n = 1u << level;
+    return (n + 1u) * (n + 2u) / 2u;
+}
+
+// Sample at barycentrics (i / n, j / n) of the second and third vertex,
+// i + j <= n, rows of constant i are stored one after another
+uint getShadingCacheSample(uint i, uint j, uint n) {
+    return i * (n + 1u) - i * (i - 1u) / 2u + j;
+}
+
+void storeShadingCacheSample(uint texel, vec3 diffuse, float specular) {
+    shadingCacheTexels[texel] = uvec2(packHalf2x16(diffuse.rg),
+                                      packHalf2x16(vec2(diffuse.b, specular)));
+}
+
+vec4 loadShadingCacheSample(uint offset, uint i, uint j, uint n) {
+    uvec2 packed = shadingCacheTexels[offset + getShadingCacheSample(i, j, n)];
+    return vec4(unpackHalf2x16(packed.x), unpackHalf2x16(packed.y));
+}
+
+float cross2(vec2 a, vec2 b) { return a.x * b.y - a.y * b.x; }
+
+// Diffuse light (rgb) and specular light (a) of the cached triangle at the
+// NDC position, interpolated from the lattice
+vec4 lookupShadingCache(ShadingCacheRecord record, vec2 ndcPosXY) {
+    vec2 v0 = vec2(record.vertices[0], record.vertices[1]);
+    vec2 v1 = vec2(record.vertices[3], record.vertices[4]);
+    vec2 v2 = vec2(record.vertices[6], record.vertices[7]);
+    vec3 oneOverW
+      = vec3(record.vertices[2], record.vertices[5], record.vertices[8]);
+
+    // Screen-space barycentrics to perspective-correct ones, samples of the
+    // pixel may lie slightly outside of the triangle
+    float area = cross2(v1 - v0, v2 - v0);
+    vec3 b;
+    b.y = cross2(ndcPosXY - v0, v2 - v0) / area;
+    b.z = cross2(v1 - v0, ndcPosXY - v0) / area;
+    b.x = 1.0 - b.y - b.z;
+    b = max(b * oneOverW, vec3(0.0));
+    b /= b.x + b.y + b.z;
+
+    uint n = 1u << getShadingCacheLevel(record.block);
+    uint offset = getShadingCacheOffset(record.block);
+    vec2 uv = b.yz * float(n);
+    uint i = min(uint(uv.x), n - 1u);
+    uint j = min(uint(uv.y), n - 1u - i);
+    vec2 f = uv - vec2(i, j);
+
+    // Lower or upper triangle of the lattice cell
+    if (f.x + f.y <= 1.0) {
+        return (1.0 - f.x - f.y) * loadShadingCacheSample(offset, i, j, n)
+               + f.x * loadShadingCacheSample(offset, i + 1u, j, n)
+               + f.y * loadShadingCacheSample(offset, i, j + 1u, n);
+    }
+    return (f.x + f.y - 1.0) * loadShadingCacheSample(offset, i + 1u, j + 1u, n)
+           + (1.0 - f.x) * loadShadingCacheSample(offset, i, j + 1u, n)
+           + (1.0 - f.y) * loadShadingCacheSample(offset, i + 1u, j, n);
+}
+
+#endif // DAIS_SHADING_CACHE_GLSL
@@ -0,0 +1,64 @@
+//-----------------------------------------------------------------------------
+// Triangle records written by 02_dais_geometry_pass.frag and read by
+// 03_dais_compute_pass.comp and decoding of their vertex attributes. The C++
+// mirrors are in algorithms/deferred_attribute_interpolation_shading.h.
+//-----------------------------------------------------------------------------
+#ifndef DAIS_TRIANGLE_GLSL
+#define DAIS_TRIANGLE_GLSL
+
+struct Triangle
+{
+    // in std430, vec3s are not padded to vec4 when in an array or structure.
+    vec4 vertices[3];        // size = 48, offset = 0, alignment = 16
+    uint normalsSnormOct[3]; // size = 12, offset = 48, alignment = 4
+    uint UVsUnorm[3];        // size = 12, offset = 60, alignment = 4
+
+    // 96 - 72 = 24 bytes padding
+    uint padding[6]; // size = 24, offset = 72, alignment = 4
+
+    // ---- std430:
+    // size == 96 bytes, alignment = 16
+    // --------------------------------
+};
+
+// Record of the CompactTriangles option. Clip-space z is not stored, for
+// a perspective projection it is given by w:
+//   z = projectionMatrix_32 - projectionMatrix_22 * w
+struct CompactTriangle
+{
+    float positionsXYW[9];   // size = 36, offset = 0, alignment = 4
+    uint normalsSnormOct[3]; // size = 12, offset = 36, alignment = 4
+    uint UVsUnorm[3];        // size = 12, offset = 48, alignment = 4
+
+    // ---- std430:
+    // size == 60 bytes, alignment = 4
+    // --------------------------------
+};
+
+// Returns ±1
+vec2 signNotZero(vec2 v) {
+    return vec2((v.x >= 0.0) ? +1.0 : -1.0, (v.y >= 0.0) ? +1.0 : -1.0);
+}
+
+vec3 oct_to_float32x3(vec2 e) {
+    vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0) v.xy = (1.0 - abs(v.yx)) * signNotZero(v.xy);
+    return normalize(v);
+}
+
+void uncompressVertexAttributes(in uint normalsSnormOct[3],
+                                in uint UVsUnorm[3], out vec3 normals[3],
+                                out vec2 UVs[3]) {
+    for (int i = 0; i < 3; i++) {
+        normals[i] = oct_to_float32x3(unpackSnorm2x16(normalsSnormOct[i]));
+        UVs[i] = unpackSnorm2x16(UVsUnorm[i]);
+    }
+}
+
+void uncompressTriangleAttributes(in Triangle triangle, out vec3 normals[3],
+                                  out vec2 UVs[3]) {
+    uncompressVertexAttributes(triangle.normalsSnormOct, triangle.UVsUnorm,
+                               normals, UVs);
+}
+
+#endif // DAIS_TRIANGLE_GLSL
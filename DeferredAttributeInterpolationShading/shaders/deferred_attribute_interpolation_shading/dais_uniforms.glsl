@@ -0,0 +1,28 @@
+//-----------------------------------------------------------------------------
+// Uniforms shared by all D.A.I.S. passes, the C++ mirror is UniformBufferData
+// in algorithms/deferred_attribute_interpolation_shading.h.
+//-----------------------------------------------------------------------------
+#ifndef DAIS_UNIFORMS_GLSL
+#define DAIS_UNIFORMS_GLSL
+
+layout(std140, binding = 1) uniform DAISUniforms {
+    vec4 cameraPosition;       // size = 16, offset = 0, alignment = 16
+    mat4 MVPMatrix;            // size = 64, offset = 16, alignment = 16
+    mat4 MVPMatrixInv;         // size = 64, offset = 80, alignment = 16
+    vec4 Viewport;             // size = 16, offset = 144, alignment = 16
+    int bitwiseModHashSize;    // size = 4, offset = 160, alignment = 4
+    uint trianglesPerSphere;   // size = 4, offset = 164, alignment = 4
+    float projectionMatrix_32; // size = 4, offset = 168, alignment = 4
+    float projectionMatrix_22; // size = 4, offset = 172, alignment = 4
+    uint numSamples;           // size = 4, offset = 176, alignment = 4
+    uint cacheTexelsPerSet;    // size = 4, offset = 180, alignment = 4
+    uint cacheHash;            // size = 4, offset = 184, alignment = 4
+    uint cacheProbing;         // size = 4, offset = 188, alignment = 4
+    float maxShadingVariation; // size = 4, offset = 192, alignment = 4
+
+    // ---- std140:
+    // size = 208, alignment = 16
+    // -------------------------
+};
+
+#endif // DAIS_UNIFORMS_GLSL
@@ -3,6 +3,10 @@
 #ifdef USER_TEST
 #endif
 
+#ifndef MSAA_SAMPLES
+#define MSAA_SAMPLES 0
+#endif
+
 layout(location = 0) out vec4 FragColor;
 
 struct Light
@@ -82,7 +86,7 @@ void shadeMultisample(ivec2 pixel) {
     vec4 position;
 
     vec3 accum = vec3(0.0);
-    for (int i = 0; i < int(MSAASamples); ++i) {
+    for (int i = 0; i < MSAA_SAMPLES; ++i) {
         position = texelFetch(VertexSamplerMS, pixel, i);
         if (position.w == 0) {
             continue;
@@ -93,7 +97,7 @@ void shadeMultisample(ivec2 pixel) {
 
         accum += shadeSample(pixel, position.xyz, normal, diffSpecColor);
     }
-    FragColor = vec4(accum / MSAASamples, 1);
+    FragColor = vec4(accum / float(MSAA_SAMPLES), 1);
 }
 
 void shadeMultisampleCoverageMask(ivec2 pixel) {
@@ -103,7 +107,7 @@ void shadeMultisampleCoverageMask(ivec2 pixel) {
     vec4 position;
 
     // mask stores which samples need to be shaded
-    uint mask = (1 << MSAASamples) - 1;
+    uint mask = (1 << MSAA_SAMPLES) - 1;
     vec3 accum = vec3(0.0);
 
     while (mask > 0) {
@@ -122,7 +126,7 @@ void shadeMultisampleCoverageMask(ivec2 pixel) {
             mask &= ~(1 << i);  // mark shaded sample
         }
     }
-    FragColor = vec4(accum / MSAASamples, 1);
+    FragColor = vec4(accum / float(MSAA_SAMPLES), 1);
 }
 
 void shadeSingleSample(ivec2 pixel) {
@@ -149,13 +153,13 @@ void shadeSingleSample(ivec2 pixel) {
 void main(void) {
     ivec2 pixel = ivec2(gl_FragCoord.xy);
 
-    if (MSAASamples > 1) {
+#if MSAA_SAMPLES > 1
 #ifdef StoreCoverage
-        shadeMultisampleCoverageMask(pixel);
+    shadeMultisampleCoverageMask(pixel);
 #else
-        shadeMultisample(pixel);
+    shadeMultisample(pixel);
+#endif
+#else
+    shadeSingleSample(pixel);
 #endif
-    } else {
-        shadeSingleSample(pixel);
-    }
 }
@@ -0,0 +1,36 @@
+//-----------------------------------------------------------------------------
+// Temporal anti-aliasing (TemporalAA in algorithms/temporal_aa.h). Motion
+// vector passes of the algorithms write the screen-space motion of the
+// surface visible in each pixel, taa_resolve.comp reprojects the history
+// with it.
+//-----------------------------------------------------------------------------
+#ifndef TAA_GLSL
+#define TAA_GLSL
+
+layout(std140, binding = 3) uniform TAAUniforms {
+    mat4 previousMVP;   // size = 64, offset = 0, alignment = 16
+    mat4 currentMVP;    // size = 64, offset = 64, alignment = 16
+    float blendFactor;  // size = 4, offset = 128, alignment = 4
+    uint historyValid;  // size = 4, offset = 132, alignment = 4
+
+    // ---- std140:
+    // size = 144, alignment = 16
+    // -------------------------
+};
+
+// Motion from the previous frame in texture coordinates
+#ifdef TAA_RESOLVE
+layout(binding = 4, rg16f) readonly uniform image2D MotionImage;
+#else
+layout(binding = 4, rg16f) writeonly uniform image2D MotionImage;
+
+// Motion of a static world-space position, both matrices are unjittered so
+// that the jitter does not show up as motion
+vec2 getMotion(vec3 position) {
+    vec4 current = currentMVP * vec4(position, 1.0);
+    vec4 previous = previousMVP * vec4(position, 1.0);
+    return (current.xy / current.w - previous.xy / previous.w) * 0.5;
+}
+#endif
+
+#endif // TAA_GLSL
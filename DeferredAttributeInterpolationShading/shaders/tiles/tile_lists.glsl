@@ -0,0 +1,47 @@
+//-----------------------------------------------------------------------------
+// Screen tiles containing geometry (TileLists in algorithms/tile_lists.h).
+// Appended by the tile classification passes and drawn as instanced quads by
+// the shading passes with the TileClassification option. Vertex shaders
+// define TILE_LISTS_DRAW before including the file.
+//-----------------------------------------------------------------------------
+#ifndef TILE_LISTS_GLSL
+#define TILE_LISTS_GLSL
+
+#define TILE_SIZE 16
+
+// Tile not covered by a single triangle
+const uint COMPLEX_TILE = 0xFFFFFFFFu;
+
+layout(std430, binding = 3) buffer TileListBuffer {
+    // glDrawArraysIndirect() command, one instance per tile
+    uint vertexCount;   // size = 4, offset = 0, alignment = 4
+    uint instanceCount; // size = 4, offset = 4, alignment = 4
+    uint firstVertex;   // size = 4, offset = 8, alignment = 4
+    uint baseInstance;  // size = 4, offset = 12, alignment = 4
+    uvec2 numTiles;     // size = 8, offset = 16, alignment = 8
+    uvec2 resolution;   // size = 8, offset = 24, alignment = 8
+    // (x | y << 16, triangle covering the tile or COMPLEX_TILE)
+    uvec2 tiles[]; // size = 8, offset = 32, alignment = 8
+};
+
+#ifdef TILE_LISTS_DRAW
+// Clip-space position of the quad vertex of the instanced tile
+vec4 getTileVertexPosition(out uint triangle) {
+    const uvec2 corners[6] = uvec2[6](uvec2(0, 0), uvec2(1, 0), uvec2(0, 1),
+                                      uvec2(0, 1), uvec2(1, 0), uvec2(1, 1));
+    uvec2 entry = tiles[gl_InstanceID];
+    uvec2 tile = uvec2(entry.x & 0xFFFFu, entry.x >> 16);
+    triangle = entry.y;
+
+    vec2 pixel = vec2((tile + corners[gl_VertexID]) * uint(TILE_SIZE));
+    pixel = min(pixel, vec2(resolution));
+    return vec4(pixel / vec2(resolution) * 2.0 - 1.0, 0.0, 1.0);
+}
+#else
+void appendTile(uvec2 tile, uint triangle) {
+    uint slot = atomicAdd(instanceCount, 1u);
+    tiles[slot] = uvec2(tile.x | (tile.y << 16), triangle);
+}
+#endif
+
+#endif // TILE_LISTS_GLSL
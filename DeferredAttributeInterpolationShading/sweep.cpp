@@ -0,0 +1,250 @@
+#include "sweep.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <type_traits>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+std::string trim(const std::string& str) {
+    const auto first = str.find_first_not_of(" \t\r");
+    if (first == std::string::npos) return {};
+    const auto last = str.find_last_not_of(" \t\r");
+    return str.substr(first, last - first + 1);
+}
+
+// Splits comma separated values, each one is parsed by parse(value, result)
+template<typename T, typename ParseFunc>
+bool parseList(const std::string& values, std::vector<T>& result,
+               ParseFunc&& parse) {
+    result.clear();
+    std::stringstream stream(values);
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+        T parsed{};
+        if (!parse(trim(value), parsed)) return false;
+        result.push_back(parsed);
+    }
+    return !result.empty();
+}
+
+bool parseInt(const std::string& value, int& result) {
+    return sscanf(value.c_str(), "%d", &result) == 1;
+}
+
+// Value has to be one of the names, result is its index
+auto parseName(const std::vector<std::string>& names) {
+    return [&names](const std::string& value, int& result) {
+        const auto it = std::find(names.begin(), names.end(), value);
+        result = static_cast<int>(it - names.begin());
+        return it != names.end();
+    };
+}
+} // namespace
+
+const std::vector<std::string>& SweepRunner::getCacheHashNames() {
+    static const std::vector<std::string> names{"mask", "multiplicative",
+                                                "murmur"};
+    return names;
+}
+
+const std::vector<std::string>& SweepRunner::getCacheProbingNames() {
+    static const std::vector<std::string> names{"none", "linear",
+                                                "quadratic"};
+    return names;
+}
+
+bool SweepRunner::start(const std::string& gridFileName,
+                        const std::string& outputFileName, int numAlgorithms,
+                        const Configuration& current) {
+    if (!parseGrid(gridFileName, current)) return false;
+
+    output.open(outputFileName);
+    if (!output) {
+        spdlog::error("Unable to create sweep output {}", outputFileName);
+        return false;
+    }
+    this->numAlgorithms = numAlgorithms;
+    configuration = 0;
+    algorithm = 0;
+    frame = -1;
+    running = true;
+    spdlog::info("Sweep of {} configurations started, results are written "
+                 "to {}",
+                 configurations.size(), outputFileName);
+    return true;
+}
+
+SweepRunner::Action SweepRunner::nextFrame() {
+    if (!running) return Action::None;
+
+    frame++;
+    if (frame == 0) {
+        spdlog::info("Sweep {}/{}, algorithm {}: {}", configuration + 1,
+                     configurations.size(), algorithm, getColumns());
+        return Action::Configure;
+    }
+    if (frame < warmupFrames) return Action::None;
+    if (frame == warmupFrames) return Action::StartMeasurement;
+    if (frame < warmupFrames + measuredFrames) return Action::None;
+    // All measured frames were rendered, results are written before moving
+    // to the next run
+    if (frame == warmupFrames + measuredFrames) return Action::WriteResults;
+
+    frame = -1;
+    if (++algorithm == numAlgorithms) {
+        algorithm = 0;
+        configuration++;
+    }
+    if (configuration == configurations.size()) {
+        running = false;
+        output.close();
+        spdlog::info("Sweep finished");
+        return Action::Finished;
+    }
+    return nextFrame();
+}
+
+std::string SweepRunner::getColumns() const {
+    const auto& config = getConfiguration();
+    return fmt::format("{},{},{},{},{},{},{},{},{},{},{},{},{},",
+                       config.numSpheresPerRow, config.numSphereSlices,
+                       config.numLights, config.lightRangeLimits.x,
+                       config.lightRangeLimits.y, config.msaaSampleCount,
+                       static_cast<int>(config.temporalAA),
+                       config.hashTableSize, config.cacheWays,
+                       getCacheHashNames()[config.cacheHash],
+                       getCacheProbingNames()[config.cacheProbing],
+                       config.resolution.x, config.resolution.y);
+}
+
+const char* SweepRunner::getColumnsHeader() {
+    return "spheres per row,sphere slices,lights,light range min,"
+           "light range max,msaa,taa,hash table size,cache ways,cache hash,"
+           "cache probing,width,height,";
+}
+
+bool SweepRunner::parseGrid(const std::string& gridFileName,
+                            const Configuration& current) {
+    std::ifstream file(gridFileName);
+    if (!file) {
+        spdlog::error("Unable to open sweep grid {}", gridFileName);
+        return false;
+    }
+
+    std::vector<int> spheresPerRow{current.numSpheresPerRow};
+    std::vector<int> sphereSlices{current.numSphereSlices};
+    std::vector<int> lights{current.numLights};
+    std::vector<glm::vec2> lightRanges{current.lightRangeLimits};
+    std::vector<int> msaa{current.msaaSampleCount};
+    std::vector<int> temporalAA{current.temporalAA};
+    std::vector<int> hashTableSizes{current.hashTableSize};
+    std::vector<int> cacheWays{current.cacheWays};
+    std::vector<int> cacheHashes{current.cacheHash};
+    std::vector<int> cacheProbings{current.cacheProbing};
+    std::vector<glm::ivec2> resolutions{current.resolution};
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+
+        const auto separator = line.find('=');
+        const std::string key = trim(line.substr(0, separator));
+        const std::string values = separator == std::string::npos
+                                     ? std::string{}
+                                     : line.substr(separator + 1);
+        bool valid = true;
+        if (key == "spheresPerRow") {
+            valid = parseList(values, spheresPerRow, parseInt);
+        } else if (key == "sphereSlices") {
+            valid = parseList(values, sphereSlices, parseInt);
+        } else if (key == "lights") {
+            valid = parseList(values, lights, parseInt);
+        } else if (key == "lightRange") {
+            valid = parseList(values, lightRanges,
+                              [](const std::string& value, glm::vec2& range) {
+                                  return sscanf(value.c_str(), "%f:%f",
+                                                &range.x, &range.y)
+                                         == 2;
+                              });
+        } else if (key == "msaa") {
+            valid = parseList(values, msaa, parseInt);
+        } else if (key == "taa") {
+            valid = parseList(values, temporalAA,
+                              [](const std::string& value, int& enabled) {
+                                  return parseInt(value, enabled)
+                                         && (enabled == 0 || enabled == 1);
+                              });
+        } else if (key == "hashTableSize") {
+            valid = parseList(values, hashTableSizes, parseInt);
+        } else if (key == "cacheWays") {
+            valid = parseList(values, cacheWays,
+                              [](const std::string& value, int& ways) {
+                                  return parseInt(value, ways)
+                                         && (ways == 2 || ways == 4
+                                             || ways == 8);
+                              });
+        } else if (key == "cacheHash") {
+            valid = parseList(values, cacheHashes,
+                              parseName(getCacheHashNames()));
+        } else if (key == "cacheProbing") {
+            valid = parseList(values, cacheProbings,
+                              parseName(getCacheProbingNames()));
+        } else if (key == "resolution") {
+            valid = parseList(values, resolutions,
+                              [](const std::string& value, glm::ivec2& size) {
+                                  return sscanf(value.c_str(), "%dx%d",
+                                                &size.x, &size.y)
+                                         == 2;
+                              });
+        } else if (key == "warmupFrames") {
+            valid = parseInt(trim(values), warmupFrames);
+        } else if (key == "frames") {
+            valid = parseInt(trim(values), measuredFrames);
+        } else {
+            spdlog::error("{}:{}: unknown sweep parameter {}", gridFileName,
+                          lineNumber, key);
+            return false;
+        }
+        if (!valid) {
+            spdlog::error("{}:{}: invalid values of {}", gridFileName,
+                          lineNumber, key);
+            return false;
+        }
+    }
+    warmupFrames = std::max(warmupFrames, 1);
+    measuredFrames = std::max(measuredFrames, 1);
+
+    // Cartesian product of all parameters, the first one changes slowest
+    configurations.assign(1, current);
+    const auto expand = [this](const auto& values, auto member) {
+        std::vector<Configuration> expanded;
+        expanded.reserve(configurations.size() * values.size());
+        for (const auto& config : configurations) {
+            for (const auto& value : values) {
+                expanded.push_back(config);
+                expanded.back().*member = static_cast<
+                  std::remove_cvref_t<decltype(config.*member)>>(value);
+            }
+        }
+        configurations = std::move(expanded);
+    };
+    expand(spheresPerRow, &Configuration::numSpheresPerRow);
+    expand(sphereSlices, &Configuration::numSphereSlices);
+    expand(lights, &Configuration::numLights);
+    expand(lightRanges, &Configuration::lightRangeLimits);
+    expand(msaa, &Configuration::msaaSampleCount);
+    expand(temporalAA, &Configuration::temporalAA);
+    expand(hashTableSizes, &Configuration::hashTableSize);
+    expand(cacheWays, &Configuration::cacheWays);
+    expand(cacheHashes, &Configuration::cacheHash);
+    expand(cacheProbings, &Configuration::cacheProbing);
+    expand(resolutions, &Configuration::resolution);
+    return true;
+}
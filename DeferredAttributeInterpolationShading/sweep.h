@@ -0,0 +1,113 @@
+#ifndef DEFERREDATTRIBUTEINTERPOLATIONSHADING_SWEEP
+#define DEFERREDATTRIBUTEINTERPOLATIONSHADING_SWEEP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+//-----------------------------------------------------------------------------
+// Name: SweepRunner
+// Desc: Runs every algorithm for all combinations of the scene parameters
+//       declared in a grid file and writes their measurements as CSV (one row
+//       per configuration, algorithm and renderpass). Each run is preceded by
+//       warmup frames that are not measured.
+//
+//       Grid file contains "key = value, value, ..." lines, '#' starts
+//       a comment. Keys not present in the file keep the current value:
+//         spheresPerRow = 5, 10, 20
+//         sphereSlices = 10
+//         lights = 256, 1024, 4096
+//         lightRange = 0.2:2.0, 0.5:4.0   (min:max)
+//         msaa = 0, 4
+//         taa = 0, 1                      (temporal anti-aliasing)
+//         hashTableSize = 8192            (D.A.I.S. only)
+//         cacheWays = 2, 4, 8             (D.A.I.S. only)
+//         cacheHash = mask, multiplicative, murmur   (D.A.I.S. only)
+//         cacheProbing = none, linear, quadratic     (D.A.I.S. only)
+//         resolution = 1200x900
+//         warmupFrames = 20
+//         frames = 100                    (measured frames)
+//-----------------------------------------------------------------------------
+class SweepRunner
+{
+public:
+    struct Configuration
+    {
+        int numSpheresPerRow;
+        int numSphereSlices;
+        int numLights;
+        glm::vec2 lightRangeLimits;
+        uint8_t msaaSampleCount;
+        bool temporalAA;
+        int hashTableSize;
+        int cacheWays;
+        int cacheHash;    // Index into getCacheHashNames()
+        int cacheProbing; // Index into getCacheProbingNames()
+        glm::ivec2 resolution;
+    };
+
+    // Grid values of cacheHash and cacheProbing, in the order of
+    // DeferredAttributeInterpolationShading::CacheHash and CacheProbing
+    static const std::vector<std::string>& getCacheHashNames();
+    static const std::vector<std::string>& getCacheProbingNames();
+
+    // What the application has to do in the current frame
+    enum class Action
+    {
+        None,
+        Configure,        // Apply getConfiguration(), select getAlgorithm()
+        StartMeasurement, // Reset measurements, following frames are measured
+        WriteResults,     // Write rows of the algorithm to getOutput()
+        Finished
+    };
+
+    // Parses the grid, current values are used for parameters not present in
+    // the grid. Returns false if the grid or the output cannot be opened.
+    bool start(const std::string& gridFileName,
+               const std::string& outputFileName, int numAlgorithms,
+               const Configuration& current);
+
+    // Called at the beginning of every frame
+    Action nextFrame();
+
+    bool isRunning() const { return running; }
+
+    // Measurements of the current frame have to be accumulated
+    bool isMeasuring() const {
+        return running && frame >= warmupFrames
+               && frame < warmupFrames + measuredFrames;
+    }
+
+    const Configuration& getConfiguration() const {
+        return configurations[configuration];
+    }
+    int getAlgorithm() const { return algorithm; }
+
+    std::ostream& getOutput() { return output; }
+
+    // Values of the configuration columns, prefix of every row
+    std::string getColumns() const;
+
+    // Names of the configuration columns
+    static const char* getColumnsHeader();
+
+private:
+    bool parseGrid(const std::string& gridFileName,
+                   const Configuration& current);
+
+    std::vector<Configuration> configurations;
+    int numAlgorithms = 0;
+    int warmupFrames = 20;
+    int measuredFrames = 100;
+
+    bool running = false;
+    size_t configuration = 0;
+    int algorithm = 0;
+    int frame = -1; // Frame of the current run
+    std::ofstream output;
+};
+
+#endif /* DEFERREDATTRIBUTEINTERPOLATIONSHADING_SWEEP */
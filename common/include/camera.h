@@ -14,6 +14,15 @@ namespace Tools {
 class Camera
 {
 public:
+    // Complete camera state, used to record and replay camera movement
+    struct State
+    {
+        glm::vec3 Position;
+        glm::vec3 Center;
+        glm::vec3 Up;
+        float CurrentRotationX;
+    };
+
     Camera()
       : Position(glm::vec3(0.0f)), Center(glm::vec3(0.0f, 0.0f, -1.0f)),
         Up(glm::vec3(0.0f, 1.0f, 0.0f)) {}
@@ -106,6 +115,17 @@ public:
 
     const glm::vec3& getPosition() { return Position; }
 
+    State getState() const {
+        return State{Position, Center, Up, CurrentRotationX};
+    }
+
+    void setState(const State& state) {
+        Position = state.Position;
+        Center = state.Center;
+        Up = state.Up;
+        CurrentRotationX = state.CurrentRotationX;
+    }
+
 private:
     const glm::vec2 RotationRange = glm::vec2(-0.85f, 2.00f);
     const float ZoomSpeed = 0.01f;
@@ -40,6 +40,8 @@ namespace Callbacks {
 namespace User {
     extern TReleaseOpenGLCallback OpenGLRelease;
     extern TDisplayCallback Display;
+    // Optional, called before the default uniforms are updated each frame
+    extern TBeginFrameCallback BeginFrame;
     extern TShowGUICallback ShowGUI;
     extern TWindowSizeChangedCallback WindowSizeChanged;
     extern TMouseButtonChangedCallback MouseButtonChanged;
@@ -21,6 +21,7 @@
 typedef void (*TInitGLCallback)(void);
 typedef int (*TShowGUICallback)();
 typedef void (*TDisplayCallback)(void);
+typedef void (*TBeginFrameCallback)(void);
 typedef void (*TReleaseOpenGLCallback)(void);
 typedef void (*TWindowSizeChangedCallback)(const glm::ivec2&);
 typedef void (*TMouseButtonChangedCallback)(int, int);
@@ -34,5 +35,6 @@ void compileShaders(void* = nullptr);
 #define PGR2_SHOW_MEMORY_STATISTICS 0x0F000001
 #define PGR2_DISABLE_VSYNC 0x0F000002
 #define PGR2_DISABLE_BUFFER_SWAP 0x0F000004
+#define PGR2_HEADLESS 0x0F000008
 
 #endif // _COMMON_INCLUDE_SETUP_H_
@@ -6,6 +6,7 @@
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
+#include <string>
 
 #include "camera.h"
 
@@ -25,8 +26,11 @@ extern bool MouseMiddlePressed;
 extern bool ModelTransformEnabled;
 extern bool Debug;
 extern bool ShaderBinaryOutput;
+extern bool ShaderBinaryCache; // Programs are stored to/loaded from binary cache
+extern std::string ShaderBinaryCacheDirectory;
 extern bool ShowMemStat;
 extern bool AppClose;
+extern bool Headless; // Window is hidden and GUI is not rendered
 
 namespace Inspector {
     extern glm::u8vec4 pixel;
@@ -69,9 +73,12 @@ struct Transformation
     glm::mat4 ModelViewInverse;
     glm::mat4 Projection;
     glm::mat4 ModelViewProjection;
+    // ModelViewProjection without the sub-pixel Jitter
+    glm::mat4 UnjitteredModelViewProjection;
     glm::mat3 Normal;
     glm::vec4 Viewport;
     Tools::Camera Camera;
+    glm::vec2 Jitter = glm::vec2(0.0f); // Projection offset in pixels
 
     void update() {
         Model = glm::rotate(
@@ -85,6 +92,9 @@ struct Transformation
         Projection
           = glm::perspective(glm::radians(60.0f),
                              float(WindowSize.x) / WindowSize.y, 0.1f, 1000.0f);
+        UnjitteredModelViewProjection = Projection * ModelView;
+        Projection[2][0] -= 2.0f * Jitter.x / WindowSize.x;
+        Projection[2][1] -= 2.0f * Jitter.y / WindowSize.y;
         ModelViewProjection = Projection * ModelView;
         Normal = glm::inverseTranspose(glm::mat3(ModelView));
 
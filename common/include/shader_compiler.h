@@ -0,0 +1,137 @@
+//-----------------------------------------------------------------------------
+//  [PGR2] Asynchronous shader program compilation
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+#ifndef COMMON_INCLUDE_SHADER_COMPILER
+#define COMMON_INCLUDE_SHADER_COMPILER
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glbinding/gl/gl.h>
+#include <GLFW/glfw3.h>
+
+using namespace gl;
+
+namespace Tools {
+//-----------------------------------------------------------------------------
+// Name: ProgramCompileJob
+// Desc: Shader program compiled by the ShaderCompiler. The job owns the
+//       program until it is taken over with takeProgram().
+//-----------------------------------------------------------------------------
+class ProgramCompileJob
+{
+public:
+    // Shader stage type and source file name
+    using Stage = std::pair<GLenum, std::string>;
+
+    enum class State
+    {
+        Compiling,
+        Ready,
+        Failed
+    };
+
+    ProgramCompileJob(std::vector<Stage> stages, std::string preprocessor)
+      : stages(std::move(stages)), preprocessor(std::move(preprocessor)) {}
+    ~ProgramCompileJob();
+
+    ProgramCompileJob(const ProgramCompileJob&) = delete;
+    ProgramCompileJob& operator=(const ProgramCompileJob&) = delete;
+
+    // Returns true once the job is finished (successfully or not), never
+    // blocks. Has to be called from the main thread.
+    bool poll();
+
+    // Blocks until the job is finished
+    void wait();
+
+    bool isReady() const { return state == State::Ready; }
+
+    // Passes ownership of the linked program to the caller, returns 0 if the
+    // job is not ready
+    GLuint takeProgram();
+
+private:
+    friend class ShaderCompiler;
+
+    bool loadSources();
+    void compile();
+    void submitParallel();
+    void finishLink();
+    void finish(State result);
+    // Fails a job that was never compiled, wakes up its waiters
+    void cancel();
+
+    std::vector<Stage> stages;
+    std::string preprocessor;
+    std::vector<std::string> sources;
+    uint64_t binaryKey = 0;
+
+    bool parallel = false;       // Compiled with KHR_parallel_shader_compile
+    bool workerThread = false;   // Compiled by the worker thread
+    std::vector<GLuint> shaders; // Shaders not yet detached (parallel only)
+    GLuint program = 0;
+    std::atomic<State> state{State::Compiling};
+};
+
+//-----------------------------------------------------------------------------
+// Name: ShaderCompiler
+// Desc: Compiles shader programs without blocking the frame. Uses
+//       GL_KHR_parallel_shader_compile if available, otherwise programs are
+//       compiled by a worker thread with its own (shared) OpenGL context.
+//-----------------------------------------------------------------------------
+class ShaderCompiler
+{
+public:
+    enum class Mode
+    {
+        Synchronous,
+        ParallelShaderCompile,
+        WorkerThread
+    };
+
+    static ShaderCompiler& get();
+
+    // Has to be called from the main thread after OpenGL initialization
+    void initialize(GLFWwindow* mainWindow);
+
+    // Stops the worker thread and destroys its context
+    void shutdown();
+
+    // Submits all stages of the program for compilation
+    std::shared_ptr<ProgramCompileJob>
+      submit(std::vector<ProgramCompileJob::Stage> stages,
+             std::string preprocessor);
+
+    // Moves a job waiting in the worker queue to its front, e.g. before the
+    // main thread waits for it
+    void prioritize(const std::shared_ptr<ProgramCompileJob>& job);
+
+    Mode getMode() const { return mode; }
+
+private:
+    ShaderCompiler() = default;
+
+    void workerMain();
+
+    Mode mode = Mode::Synchronous;
+    GLFWwindow* workerWindow = nullptr;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::shared_ptr<ProgramCompileJob>> queue;
+    bool stopWorker = false;
+};
+} // end of namespace Tools
+
+#endif /* COMMON_INCLUDE_SHADER_COMPILER */
@@ -6,11 +6,16 @@
 //-----------------------------------------------------------------------------
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
+#include <deque>
 #include <glm/gtc/random.hpp>
 #include <imgui.h>
 #include <implot.h>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <glbinding/gl/gl.h>
@@ -114,6 +119,8 @@ using TransformFeedbackBufferRelease
                   GL_TRANSFORM_FEEDBACK_BUFFER_BINDING>;
 using UniformBufferRelease
   = BufferRelease<GL_UNIFORM_BUFFER, GL_UNIFORM_BUFFER_BINDING>;
+using PixelPackBufferRelease
+  = BufferRelease<GL_PIXEL_PACK_BUFFER, GL_PIXEL_PACK_BUFFER_BINDING>;
 
 //-----------------------------------------------------------------------------
 // Name: GetCPUTime()
@@ -133,6 +140,42 @@ inline double GetGPUTime(bool micro = true) {
     return micro ? time * 0.001 : time;
 }
 
+// Durations of the last measurements of a timer (rolling window), used for
+// latency percentiles and frame time graphs. Stored in microseconds.
+class TimerHistory
+{
+public:
+    static constexpr int Capacity = 512;
+
+    void add(float time) {
+        samples[next] = time;
+        next = (next + 1) % Capacity;
+        size = std::min(size + 1, Capacity);
+    }
+
+    // Returns p-th percentile (p in <0, 1>) of the window
+    float getPercentile(float p) const;
+
+    float getMax() const;
+
+    // Number of samples in the window
+    int getSize() const { return size; }
+
+    // Ring buffer with samples, the oldest sample is at getOffset()
+    const float* getData() const { return samples.data(); }
+    int getOffset() const { return size < Capacity ? 0 : next; }
+
+    void clear() {
+        next = 0;
+        size = 0;
+    }
+
+private:
+    std::array<float, Capacity> samples{};
+    int next = 0;
+    int size = 0;
+};
+
 // Very simple GPU timer (timer cannot be nested with other timer or
 // GL_TIME_ELAPSED query
 class GPUTimer
@@ -153,9 +196,12 @@ public:
 
     unsigned int getCounter() const { return counter; }
 
+    const TimerHistory& getHistory() const { return history; }
+
     void reset() {
         timeTotal = 0;
         counter = 0;
+        history.clear();
     }
 
     GLuint getId(bool start) const { return start ? queryStart : queryStop; }
@@ -165,6 +211,7 @@ private:
     GLuint64 time{};
     GLuint64 timeTotal{};
     GLuint counter{};
+    TimerHistory history;
 };
 
 // Very simple GPU timer (timer cannot be nested with other timer or
@@ -189,10 +236,13 @@ public:
 
     unsigned int getCounter() const { return counter; }
 
+    const TimerHistory& getHistory() const { return history; }
+
     void reset() {
         time = 0;
         timeTotal = 0;
         counter = 0;
+        history.clear();
     }
 
     GLuint getId() const { return query; }
@@ -202,6 +252,7 @@ private:
     GLuint64 time{};
     GLuint64 timeTotal{};
     GLuint counter{};
+    TimerHistory history;
 };
 
 // Very simple CPU timer
@@ -218,6 +269,8 @@ public:
 
     unsigned int getCounter() const { return counter; }
 
+    const TimerHistory& getHistory() const { return history; }
+
     void reset();
 
 private:
@@ -225,6 +278,7 @@ private:
     double time{};
     unsigned long long timeTotal{};
     unsigned int counter{};
+    TimerHistory history;
 };
 
 // Very simple GL query wrapper
@@ -262,6 +316,7 @@ public:
     }
 
     unsigned int getAverage() const {
+        if (counter == 0) return 0;
         return static_cast<unsigned int>(
           static_cast<double>(resultTotal) / counter + 0.5);
     }
@@ -287,6 +342,130 @@ using GPUVSInvocationQuery = GPUQuery<GLenum::GL_VERTEX_SHADER_INVOCATIONS_ARB>;
 using GPUFSInvocationQuery
   = GPUQuery<GLenum::GL_FRAGMENT_SHADER_INVOCATIONS_ARB>;
 
+// Complete set of pipeline statistics (ARB_pipeline_statistics_query) and
+// number of generated primitives of a range of GL commands
+class GPUPipelineStatisticsQuery
+{
+public:
+    enum Statistic
+    {
+        VerticesSubmitted = 0,
+        PrimitivesSubmitted,
+        PrimitivesGenerated,
+        VertexShaderInvocations,
+        GeometryShaderInvocations,
+        GeometryShaderPrimitivesEmitted,
+        ClippingInputPrimitives,
+        ClippingOutputPrimitives,
+        FragmentShaderInvocations,
+        ComputeShaderInvocations,
+        Count
+    };
+    using Results = std::array<unsigned int, Count>;
+
+    static constexpr std::array<const char*, Count> Names{
+      "vertices submitted",
+      "primitives submitted",
+      "primitives generated",
+      "VS invocations",
+      "GS invocations",
+      "GS primitives emitted",
+      "clipping input primitives",
+      "clipping output primitives",
+      "FS invocations",
+      "CS invocations"};
+
+    void start() {
+        std::apply([](auto&... query) { (query.start(), ...); }, queries);
+    }
+
+    void stop() const {
+        std::apply([](const auto&... query) { (query.stop(), ...); }, queries);
+    }
+
+    // Results of the last measurement
+    Results get() {
+        return std::apply(
+          [](auto&... query) { return Results{query.get()...}; }, queries);
+    }
+
+    Results getAverage() const {
+        return std::apply(
+          [](const auto&... query) { return Results{query.getAverage()...}; },
+          queries);
+    }
+
+    void clear() {
+        std::apply([](auto&... query) { (query.clear(), ...); }, queries);
+    }
+
+private:
+    // Same order as Statistic
+    std::tuple<GPUQuery<GLenum::GL_VERTICES_SUBMITTED_ARB>,
+               GPUQuery<GLenum::GL_PRIMITIVES_SUBMITTED_ARB>,
+               GPUQuery<GLenum::GL_PRIMITIVES_GENERATED>,
+               GPUQuery<GLenum::GL_VERTEX_SHADER_INVOCATIONS_ARB>,
+               GPUQuery<GLenum::GL_GEOMETRY_SHADER_INVOCATIONS>,
+               GPUQuery<GLenum::GL_GEOMETRY_SHADER_PRIMITIVES_EMITTED_ARB>,
+               GPUQuery<GLenum::GL_CLIPPING_INPUT_PRIMITIVES_ARB>,
+               GPUQuery<GLenum::GL_CLIPPING_OUTPUT_PRIMITIVES_ARB>,
+               GPUQuery<GLenum::GL_FRAGMENT_SHADER_INVOCATIONS_ARB>,
+               GPUQuery<GLenum::GL_COMPUTE_SHADER_INVOCATIONS_ARB>>
+      queries;
+};
+
+//-----------------------------------------------------------------------------
+// Name: AsyncReadback
+// Desc: Reads pixels of the read framebuffer into pixel pack buffers without
+//       stalling the pipeline. Results are mapped once their fence is
+//       signaled, usually a few frames later.
+//-----------------------------------------------------------------------------
+class AsyncReadback
+{
+public:
+    // RGBA8 pixels, rows from the bottom of the framebuffer
+    struct Image
+    {
+        int id = 0;
+        GLsizei width = 0, height = 0;
+        std::vector<unsigned char> pixels;
+    };
+
+    explicit AsyncReadback(size_t numBuffers = 4) : slots(numBuffers) {}
+    ~AsyncReadback();
+
+    AsyncReadback(const AsyncReadback&) = delete;
+    AsyncReadback& operator=(const AsyncReadback&) = delete;
+
+    // Starts reading a rectangle of the read framebuffer. If all buffers are
+    // in use, waits for the oldest readback.
+    void read(int id, GLint x, GLint y, GLsizei width, GLsizei height);
+
+    // Returns the oldest finished readback, if wait is true blocks until the
+    // oldest readback finishes. Returns false if there is none.
+    bool get(Image& image, bool wait = false);
+
+    bool isPending() const { return numInFlight > 0 || !finished.empty(); }
+
+private:
+    struct Slot
+    {
+        GLuint buffer = 0;
+        GLsizeiptr capacity = 0;
+        GLsync fence = nullptr;
+        Image image; // Readback parameters, pixels are filled once finished
+    };
+
+    // Moves the oldest readback to finished, returns false if it is not
+    // finished and wait is false
+    bool finishOldest(bool wait);
+
+    std::vector<Slot> slots;
+    size_t oldest = 0; // Ring buffer of readbacks in flight
+    size_t numInFlight = 0;
+    std::deque<Image> finished;
+};
+
 //-----------------------------------------------------------------------------
 // Name: SaveFramebuffer()
 // Desc:
@@ -369,6 +548,39 @@ namespace Shader {
     //-----------------------------------------------------------------------------
     bool SaveBinaryCode(GLuint programId, const char* fileName);
 
+    //-----------------------------------------------------------------------------
+    // Name: GetProgramBinaryKey()
+    // Desc: Program binary cache key. Hashes the preprocessed shader sources
+    //       (including the generated #define preamble) together with the
+    //       driver string, so driver updates invalidate the cache.
+    //-----------------------------------------------------------------------------
+    uint64_t GetProgramBinaryKey(GLint count, const GLenum* shader_types,
+                                 const std::string* sources,
+                                 const std::vector<char*>* tbx = nullptr);
+
+    //-----------------------------------------------------------------------------
+    // Name: LoadProgramBinary()
+    // Desc: Creates a new program from the program binary cache. Returns false
+    //       on cache miss or if the driver rejected the stored binary.
+    //-----------------------------------------------------------------------------
+    bool LoadProgramBinary(GLuint& programId, uint64_t key);
+
+    //-----------------------------------------------------------------------------
+    // Name: StoreProgramBinary()
+    // Desc: Stores linked program to the program binary cache. The program has
+    //       to be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+    //-----------------------------------------------------------------------------
+    bool StoreProgramBinary(GLuint programId, uint64_t key);
+
+    //-----------------------------------------------------------------------------
+    // Name: LoadShaderSource()
+    // Desc: Reads shader file, expands #include "file" directives (searched
+    //       next to the including file) and inserts preprocessor definitions
+    //       right after the #version directive.
+    //-----------------------------------------------------------------------------
+    bool LoadShaderSource(std::string& source, const char* file_name,
+                          const char* preprocessor = nullptr);
+
     //-----------------------------------------------------------------------------
     // Name: CheckShaderInfoLog()
     // Desc:
@@ -406,6 +618,13 @@ namespace Shader {
     GLuint CreateShaderFromFile(GLenum shader_type, const char* file_name,
                                 const char* preprocessor = nullptr);
 
+    //-----------------------------------------------------------------------------
+    // Name: ReplaceProgram()
+    // Desc: Deletes programId and replaces it with newProgram (keeps internal
+    //       list of programs with automatically updated uniforms up to date).
+    //-----------------------------------------------------------------------------
+    void ReplaceProgram(GLuint& programId, GLuint newProgram);
+
     //-----------------------------------------------------------------------------
     // Name: CreateShaderProgram()
     // Desc:
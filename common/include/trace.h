@@ -0,0 +1,138 @@
+//-----------------------------------------------------------------------------
+//  [PGR2] CPU/GPU timeline capture in Chrome trace event format
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+#ifndef COMMON_INCLUDE_TRACE
+#define COMMON_INCLUDE_TRACE
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glbinding/gl/gl.h>
+
+#include "tools.h"
+
+using namespace gl;
+
+namespace Tools {
+//-----------------------------------------------------------------------------
+// Name: TraceRecorder
+// Desc: Records CPU scopes and GPU timestamp ranges of a range of frames and
+//       writes them in Chrome trace event JSON format (chrome://tracing,
+//       ui.perfetto.dev). CPU and GPU events share one timeline, so the
+//       overlap and bubbles between them are visible. Has to be used from the
+//       main thread only.
+//-----------------------------------------------------------------------------
+class TraceRecorder
+{
+public:
+    static TraceRecorder& get();
+
+    // Requests recording of frames <firstFrame, firstFrame + numFrames), the
+    // trace is written to fileName after the last one
+    void capture(int firstFrame, int numFrames, std::string fileName);
+
+    // Called by the main loop at the beginning of every frame, starts and
+    // finishes requested captures
+    void beginFrame(int frame);
+
+    // Finishes the capture in progress (e.g. when the application closes)
+    void stop();
+
+    bool isRecording() const { return recording; }
+
+    // Capture was requested or is in progress
+    bool isPending() const { return numFrames > 0; }
+
+    // Adds CPU scope, times are in microseconds (GetCPUTime())
+    void addCPUEvent(std::string_view name, double start, double end);
+
+    // Starts GPU range measured by timestamp queries, returns range id or -1
+    // if not recording
+    int beginGPURange(std::string_view name);
+    void endGPURange(int range);
+
+private:
+    enum class Track
+    {
+        CPU,
+        GPU
+    };
+
+    struct Event
+    {
+        std::string name;
+        Track track;
+        double start, end; // microseconds on the CPU clock
+    };
+
+    struct GPURange
+    {
+        std::string name;
+        GLuint queryStart = 0, queryStop = 0;
+    };
+
+    TraceRecorder() = default;
+
+    GLuint allocateQuery();
+    void resolveGPURanges();
+    void write() const;
+
+    int firstFrame = 0;
+    int numFrames = 0;
+    std::string fileName;
+
+    bool recording = false;
+    int frame = 0;           // Frame being recorded
+    double frameStart = 0.0; // CPU time of the recorded frame start
+    double captureStart = 0.0;
+    double gpuClockOffset = 0.0; // CPU time - GPU time, microseconds
+    std::vector<Event> events;
+    std::vector<GPURange> gpuRanges;
+    std::vector<GLuint> queries; // Pool of timestamp queries
+    size_t usedQueries = 0;
+};
+
+// Records CPU time spent in the enclosing scope
+class TraceScope
+{
+public:
+    explicit TraceScope(std::string_view name)
+      : name(name),
+        start(TraceRecorder::get().isRecording() ? GetCPUTime() : -1.0) {}
+
+    ~TraceScope() {
+        if (start >= 0.0 && TraceRecorder::get().isRecording())
+            TraceRecorder::get().addCPUEvent(name, start, GetCPUTime());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    std::string_view name;
+    double start;
+};
+
+// Records GPU execution of commands issued in the enclosing scope
+class GPUTraceScope
+{
+public:
+    explicit GPUTraceScope(std::string_view name)
+      : range(TraceRecorder::get().beginGPURange(name)) {}
+
+    ~GPUTraceScope() {
+        if (range >= 0) TraceRecorder::get().endGPURange(range);
+    }
+
+    GPUTraceScope(const GPUTraceScope&) = delete;
+    GPUTraceScope& operator=(const GPUTraceScope&) = delete;
+
+private:
+    int range;
+};
+} // end of namespace Tools
+
+#endif /* COMMON_INCLUDE_TRACE */
@@ -1,10 +1,13 @@
 #include <common.h>
+#include <shader_compiler.h>
 #include <tools.h>
+#include <trace.h>
 
 namespace Callbacks {
 namespace User {
     TReleaseOpenGLCallback OpenGLRelease = nullptr;
     TDisplayCallback Display = nullptr;
+    TBeginFrameCallback BeginFrame = nullptr;
     TShowGUICallback ShowGUI = nullptr;
     TWindowSizeChangedCallback WindowSizeChanged = nullptr;
     TMouseButtonChangedCallback MouseButtonChanged = nullptr;
@@ -192,13 +195,34 @@ namespace GUI {
         ImGui::SetNextWindowPos(glm::vec2(10, heightOffset + 460)
                                   * IMGUI_RESIZE_FACTOR,
                                 ImGuiCond_Once);
-        ImGui::SetNextWindowSize(glm::vec2(220, 125) * IMGUI_RESIZE_FACTOR,
+        ImGui::SetNextWindowSize(glm::vec2(220, 150) * IMGUI_RESIZE_FACTOR,
                                  ImGuiCond_Always);
         ImGui::Begin("Inspector");
         if (ImGui::Button("take screenshot",
                           glm::vec2(204, 0) * IMGUI_RESIZE_FACTOR))
             Tools::SaveFramebuffer();
 
+        static int traceFrames = 10;
+        auto& traceRecorder = Tools::TraceRecorder::get();
+        ImGui::BeginDisabled(traceRecorder.isPending());
+        if (ImGui::Button(traceRecorder.isPending() ? "recording..."
+                                                    : "capture trace",
+                          glm::vec2(120, 0) * IMGUI_RESIZE_FACTOR)) {
+            const int firstFrame = Statistic::Frame::ID + 1;
+            traceRecorder.capture(firstFrame, traceFrames,
+                                  fmt::format("trace_{}.json", firstFrame));
+        }
+        ImGui::EndDisabled();
+#ifdef PGR2_SHOW_TOOL_TIPS
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Writes CPU and GPU timeline of the following "
+                              "frames in Chrome trace format.");
+#endif
+        ImGui::SameLine(0.0f, ImGui::GetStyle().ItemInnerSpacing.x);
+        ImGui::SetNextItemWidth(80.0f * IMGUI_RESIZE_FACTOR);
+        if (ImGui::InputInt("##frames", &traceFrames))
+            traceFrames = glm::clamp(traceFrames, 1, 1000);
+
         const ImVec4 color = ImColor(Variables::Inspector::pixel.r,
                                      Variables::Inspector::pixel.g,
                                      Variables::Inspector::pixel.b, 255);
@@ -403,6 +427,14 @@ int common_main(int window_width, int window_height, const char* window_title,
             case PGR2_DISABLE_BUFFER_SWAP:
                 bAutoSwapDisabled = (value == 1);
                 break;
+            case PGR2_HEADLESS:
+                // Frames are rendered into a hidden window as fast as possible
+                Variables::Headless = (value == 1);
+                if (Variables::Headless) {
+                    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+                    bDisableVSync = true;
+                }
+                break;
             default:
                 glfwWindowHint(hint, value);
                 if (hint == GLFW_OPENGL_DEBUG_CONTEXT)
@@ -480,6 +512,15 @@ int common_main(int window_width, int window_height, const char* window_title,
     } else
         Variables::Debug = false;
 
+    // Program binaries are cached only if the driver supports any format
+    if (Variables::ShaderBinaryCache) {
+        GLint numBinaryFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+        Variables::ShaderBinaryCache = (numBinaryFormats > 0);
+        spdlog::info("Program binary cache is {}.",
+                     Variables::ShaderBinaryCache ? "enabled" : "unsupported");
+    }
+
     // Disable VSync if required
     if (bDisableVSync) {
         glfwSwapInterval(0);
@@ -500,6 +541,9 @@ int common_main(int window_width, int window_height, const char* window_title,
         }
     }
 
+    // Init asynchronous shader compilation
+    Tools::ShaderCompiler::get().initialize(Variables::Window);
+
     // Init OGL
     if (cbUserInitGL) {
         cbUserInitGL();
@@ -516,13 +560,19 @@ int common_main(int window_width, int window_height, const char* window_title,
     Variables::Transform.update();
 
     while (!glfwWindowShouldClose(Variables::Window) && !Variables::AppClose) {
-        glfwPollEvents();
+        {
+            Tools::TraceScope traceScope("Poll events");
+            glfwPollEvents();
+        }
 
         // Increase frame counter
         Statistic::Frame::ID++;
+        Tools::TraceRecorder::get().beginFrame(Statistic::Frame::ID);
+        if (Callbacks::User::BeginFrame) Callbacks::User::BeginFrame();
 
         // Update transformations and default variables if used
         {
+            Tools::TraceScope traceScope("Update default uniforms");
             for (size_t i = 0; i < OpenGL::programs.size(); i++) {
                 const OpenGL::Program& program = OpenGL::programs[i];
                 glUseProgram(program.id);
@@ -573,6 +623,8 @@ int common_main(int window_width, int window_height, const char* window_title,
           = std::chrono::high_resolution_clock::now();
         glQueryCounter(OpenGL::Query[OpenGL::FrameStartQuery], GL_TIMESTAMP);
         if (Callbacks::User::Display) {
+            Tools::TraceScope traceScope("Display");
+            Tools::GPUTraceScope gpuTraceScope("Display");
             Callbacks::User::Display();
             assert(glGetError() == GL_NO_ERROR);
             // Restore OGL states
@@ -601,6 +653,8 @@ int common_main(int window_width, int window_height, const char* window_title,
         }
 
         {
+            // Waits for the GPU to finish the frame
+            Tools::TraceScope traceScope("Frame time queries");
             // Unbind query buffer if bound
             Tools::QueryBufferRelease queryBufferRelease;
             glGetQueryObjectui64v(OpenGL::Query[OpenGL::FrameStartQuery],
@@ -624,16 +678,27 @@ int common_main(int window_width, int window_height, const char* window_title,
         }
 
         // Show Magnifier
-        ShowMagnifier();
+        if (!Variables::Headless) {
+            Tools::TraceScope traceScope("Magnifier");
+            ShowMagnifier();
+        }
 
         // Render GUI
-        Callbacks::GUI::Show(nullptr);
+        if (!Variables::Headless) {
+            Tools::TraceScope traceScope("GUI");
+            Tools::GPUTraceScope gpuTraceScope("GUI");
+            Callbacks::GUI::Show(nullptr);
+        }
 
         // Present frame buffer
-        if (!bAutoSwapDisabled) glfwSwapBuffers(Variables::Window);
+        if (!bAutoSwapDisabled) {
+            Tools::TraceScope traceScope("Swap buffers");
+            glfwSwapBuffers(Variables::Window);
+        }
 
         glfwPollEvents();
     }
+    Tools::TraceRecorder::get().stop();
 
     // Cleanup
     ImGui_ImplOpenGL3_Shutdown();
@@ -641,6 +706,7 @@ int common_main(int window_width, int window_height, const char* window_title,
     ImPlot::DestroyContext();
     ImGui::DestroyContext();
 
+    Tools::ShaderCompiler::get().shutdown();
     glfwDestroyWindow(Variables::Window);
 
     // Terminate GLFW
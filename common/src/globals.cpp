@@ -13,8 +13,11 @@ bool MouseMiddlePressed = false;
 bool ModelTransformEnabled = true;
 bool Debug = false;
 bool ShaderBinaryOutput = false;
+bool ShaderBinaryCache = true;
+std::string ShaderBinaryCacheDirectory = "shader_cache";
 bool ShowMemStat = true;
 bool AppClose = false;
+bool Headless = false;
 
 namespace Inspector {
     glm::u8vec4 pixel;
@@ -0,0 +1,282 @@
+//-----------------------------------------------------------------------------
+//  [PGR2] Asynchronous shader program compilation
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+#include <shader_compiler.h>
+#include <tools.h>
+#include <globals.h>
+
+#include <algorithm>
+
+#include <glbinding/glbinding.h>
+#include <spdlog/spdlog.h>
+
+namespace Tools {
+ProgramCompileJob::~ProgramCompileJob() {
+    // Jobs dropped while still compiling are released by the last owner
+    for (GLuint shader : shaders) glDeleteShader(shader);
+    if (program) glDeleteProgram(program);
+}
+
+bool ProgramCompileJob::poll() {
+    if (state != State::Compiling) return true;
+    if (!parallel) return false;
+
+    GLint completed = GL_FALSE.m_value;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+    if (completed == GL_FALSE.m_value) return false;
+
+    finishLink();
+    return true;
+}
+
+void ProgramCompileJob::wait() {
+    if (parallel) {
+        // Link status query blocks until the program is linked
+        if (state == State::Compiling) finishLink();
+        return;
+    }
+    state.wait(State::Compiling);
+}
+
+GLuint ProgramCompileJob::takeProgram() {
+    if (state != State::Ready) return 0;
+    return std::exchange(program, 0);
+}
+
+bool ProgramCompileJob::loadSources() {
+    sources.resize(stages.size());
+    std::vector<GLenum> types(stages.size());
+    for (size_t i = 0; i < stages.size(); i++) {
+        types[i] = stages[i].first;
+        if (!Shader::LoadShaderSource(sources[i], stages[i].second.c_str(),
+                                      preprocessor.empty()
+                                        ? nullptr
+                                        : preprocessor.c_str()))
+            return false;
+    }
+    if (Variables::ShaderBinaryCache) {
+        binaryKey = Shader::GetProgramBinaryKey(
+          static_cast<GLint>(types.size()), types.data(), sources.data());
+    }
+    return true;
+}
+
+void ProgramCompileJob::compile() {
+    if (!loadSources()) return finish(State::Failed);
+    if (Variables::ShaderBinaryCache
+        && Shader::LoadProgramBinary(program, binaryKey))
+        return finish(State::Ready);
+
+    program = glCreateProgram();
+    for (size_t i = 0; i < stages.size(); i++) {
+        GLuint shader = Shader::CreateShaderFromSource(
+          stages[i].first, sources[i].c_str(), stages[i].second.c_str());
+        if (shader == 0) return finish(State::Failed);
+        glAttachShader(program, shader);
+        glDeleteShader(shader);
+    }
+    if (Variables::ShaderBinaryCache) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                            GL_TRUE);
+    }
+    glLinkProgram(program);
+    finishLink();
+}
+
+void ProgramCompileJob::submitParallel() {
+    parallel = true;
+    if (!loadSources()) return finish(State::Failed);
+    if (Variables::ShaderBinaryCache
+        && Shader::LoadProgramBinary(program, binaryKey))
+        return finish(State::Ready);
+
+    // Compile and link calls return immediately, the driver compiles the
+    // stages on its own threads
+    program = glCreateProgram();
+    for (size_t i = 0; i < stages.size(); i++) {
+        GLuint shader = glCreateShader(stages[i].first);
+        const char* source = sources[i].c_str();
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+        shaders.push_back(shader);
+    }
+    if (Variables::ShaderBinaryCache) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                            GL_TRUE);
+    }
+    glLinkProgram(program);
+}
+
+void ProgramCompileJob::finishLink() {
+    const bool linked = Shader::CheckProgramLinkStatus(program);
+    for (size_t i = 0; i < shaders.size(); i++) {
+        if (!linked
+            && Shader::CheckShaderCompileStatus(shaders[i]) != GL_TRUE) {
+            spdlog::error("Shader compilation failed ({})", stages[i].second);
+            Shader::CheckShaderInfoLog(shaders[i]);
+        }
+        glDetachShader(program, shaders[i]);
+        glDeleteShader(shaders[i]);
+    }
+    shaders.clear();
+
+    if (!linked) {
+        Shader::CheckProgramInfoLog(program);
+        spdlog::error("Program linking failed. See previous log messages.");
+        return finish(State::Failed);
+    }
+    if (Variables::ShaderBinaryCache)
+        Shader::StoreProgramBinary(program, binaryKey);
+    finish(State::Ready);
+}
+
+void ProgramCompileJob::finish(State result) {
+    if (result == State::Failed && program) {
+        glDeleteProgram(program);
+        program = 0;
+    }
+    sources.clear();
+    // Program has to be complete before another context uses it
+    if (workerThread) glFinish();
+    state = result;
+    state.notify_all();
+}
+
+void ProgramCompileJob::cancel() {
+    sources.clear();
+    state = State::Failed;
+    state.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+// Name: get()
+// Desc:
+//-----------------------------------------------------------------------------
+ShaderCompiler& ShaderCompiler::get() {
+    static ShaderCompiler compiler;
+    return compiler;
+}
+
+//-----------------------------------------------------------------------------
+// Name: initialize()
+// Desc:
+//-----------------------------------------------------------------------------
+void ShaderCompiler::initialize(GLFWwindow* mainWindow) {
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        // Let the driver decide how many threads to use
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        mode = Mode::ParallelShaderCompile;
+        spdlog::info("Shaders are compiled using KHR_parallel_shader_compile.");
+        return;
+    }
+
+    // Fall back to worker thread with a hidden window sharing objects with
+    // the main context (windows can be created only on the main thread)
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    workerWindow = glfwCreateWindow(1, 1, "", nullptr, mainWindow);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!workerWindow) {
+        spdlog::warn("Unable to create shader compiler context, shaders "
+                     "will be compiled synchronously.");
+        return;
+    }
+    mode = Mode::WorkerThread;
+    worker = std::thread(&ShaderCompiler::workerMain, this);
+    spdlog::info("Shaders are compiled on a worker thread.");
+}
+
+//-----------------------------------------------------------------------------
+// Name: shutdown()
+// Desc:
+//-----------------------------------------------------------------------------
+void ShaderCompiler::shutdown() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard lock(mutex);
+            stopWorker = true;
+        }
+        condition.notify_one();
+        worker.join();
+    }
+    // Jobs left in the queue are never compiled, wait() would block forever
+    for (auto& job : queue) job->cancel();
+    queue.clear();
+    if (workerWindow) {
+        glfwDestroyWindow(workerWindow);
+        workerWindow = nullptr;
+    }
+    mode = Mode::Synchronous;
+}
+
+//-----------------------------------------------------------------------------
+// Name: submit()
+// Desc:
+//-----------------------------------------------------------------------------
+std::shared_ptr<ProgramCompileJob>
+  ShaderCompiler::submit(std::vector<ProgramCompileJob::Stage> stages,
+                         std::string preprocessor) {
+    auto job = std::make_shared<ProgramCompileJob>(std::move(stages),
+                                                   std::move(preprocessor));
+    switch (mode) {
+        case Mode::ParallelShaderCompile:
+            job->submitParallel();
+            break;
+        case Mode::WorkerThread: {
+            job->workerThread = true;
+            std::lock_guard lock(mutex);
+            queue.push_back(job);
+        }
+            condition.notify_one();
+            break;
+        default:
+            job->compile();
+    }
+    return job;
+}
+
+//-----------------------------------------------------------------------------
+// Name: prioritize()
+// Desc:
+//-----------------------------------------------------------------------------
+void ShaderCompiler::prioritize(const std::shared_ptr<ProgramCompileJob>& job) {
+    if (mode != Mode::WorkerThread) return;
+    std::lock_guard lock(mutex);
+    const auto it = std::find(queue.begin(), queue.end(), job);
+    if (it == queue.end()) return;
+    auto queued = std::move(*it);
+    queue.erase(it);
+    queue.push_front(std::move(queued));
+}
+
+//-----------------------------------------------------------------------------
+// Name: workerMain()
+// Desc:
+//-----------------------------------------------------------------------------
+void ShaderCompiler::workerMain() {
+    glfwMakeContextCurrent(workerWindow);
+    // glbinding keeps function pointers per context, the worker context has
+    // to be initialized separately
+    const auto context
+      = reinterpret_cast<glbinding::ContextHandle>(workerWindow);
+    glbinding::initialize(context, glfwGetProcAddress);
+
+    while (true) {
+        std::shared_ptr<ProgramCompileJob> job;
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(lock,
+                           [this] { return stopWorker || !queue.empty(); });
+            if (stopWorker) break;
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        job->compile();
+    }
+
+    glbinding::releaseContext(context);
+    glfwMakeContextCurrent(nullptr);
+}
+} // end of namespace Tools
@@ -4,7 +4,12 @@
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <string_view>
 #include <tools.h>
 #include <globals.h>
 #include <fmt/format.h>
@@ -57,6 +62,21 @@ GLuint Query[NumQueries];
 
 namespace Tools {
 
+float TimerHistory::getPercentile(float p) const {
+    if (size == 0) return 0.0f;
+    std::array<float, Capacity> sorted;
+    std::copy_n(samples.begin(), size, sorted.begin());
+    const auto nth = sorted.begin()
+                     + std::clamp(static_cast<int>(p * size), 0, size - 1);
+    std::nth_element(sorted.begin(), nth, sorted.begin() + size);
+    return *nth;
+}
+
+float TimerHistory::getMax() const {
+    if (size == 0) return 0.0f;
+    return *std::max_element(samples.begin(), samples.begin() + size);
+}
+
 // Very simple GPU timer (timer cannot be nested with other timer or
 // GL_TIME_ELAPSED query
 GPUTimer::~GPUTimer() {
@@ -93,6 +113,7 @@ unsigned int
         time = stop_time - start_time;
         timeTotal += time;
         counter++;
+        history.add(time * 0.001f);
     }
     return micro ? static_cast<unsigned int>(time * 0.001f)
                  : static_cast<unsigned int>(time);
@@ -130,6 +151,7 @@ unsigned int GPURangeTimer::get(
         glGetQueryObjectui64v(query, GL_QUERY_RESULT, &time);
         timeTotal += time;
         counter++;
+        history.add(time * 0.001f);
     }
     return micro ? static_cast<unsigned int>(time * 0.001f)
                  : static_cast<unsigned int>(time);
@@ -158,6 +180,7 @@ unsigned int CPUTimer::get(bool micro) {
         time = timeStop - timeStart;
         timeTotal += time;
         counter++;
+        history.add(static_cast<float>(time * 0.001));
     }
     return micro ? static_cast<unsigned int>(time * 0.001f)
                  : static_cast<unsigned int>(time);
@@ -173,6 +196,7 @@ void CPUTimer::reset() {
     time = 0;
     timeTotal = 0;
     counter = 0;
+    history.clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -205,6 +229,88 @@ void SaveFramebuffer(GLuint framebufferId, GLsizei width, GLsizei height) {
     glBindFramebuffer(GL_READ_FRAMEBUFFER, fboId);
 }
 
+AsyncReadback::~AsyncReadback() {
+    for (auto& slot : slots) {
+        if (slot.fence) glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: read()
+// Desc:
+//-----------------------------------------------------------------------------
+void AsyncReadback::read(int id, GLint x, GLint y, GLsizei width,
+                         GLsizei height) {
+    if (numInFlight == slots.size()) finishOldest(true);
+
+    Slot& slot = slots[(oldest + numInFlight) % slots.size()];
+    const GLsizeiptr size = static_cast<GLsizeiptr>(width) * height * 4;
+    if (slot.capacity < size) {
+        glDeleteBuffers(1, &slot.buffer);
+        glCreateBuffers(1, &slot.buffer);
+        glNamedBufferStorage(slot.buffer, size, nullptr,
+                             GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+        slot.capacity = size;
+    }
+    slot.image.id = id;
+    slot.image.width = width;
+    slot.image.height = height;
+
+    {
+        PixelPackBufferRelease pixelPackBufferRelease;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        GLint packAlignment = 4;
+        glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    numInFlight++;
+}
+
+//-----------------------------------------------------------------------------
+// Name: get()
+// Desc:
+//-----------------------------------------------------------------------------
+bool AsyncReadback::get(Image& image, bool wait) {
+    if (finished.empty() && (numInFlight == 0 || !finishOldest(wait)))
+        return false;
+    image = std::move(finished.front());
+    finished.pop_front();
+    return true;
+}
+
+bool AsyncReadback::finishOldest(bool wait) {
+    Slot& slot = slots[oldest];
+    // Flush makes sure the fence is eventually signaled
+    constexpr GLuint64 Timeout = 1000000000; // 1 s
+    GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                     wait ? Timeout : 0);
+    while (wait && status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                  Timeout);
+    if (status == GL_TIMEOUT_EXPIRED) return false;
+    if (status == GL_WAIT_FAILED) glFinish();
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    const GLsizeiptr size
+      = static_cast<GLsizeiptr>(slot.image.width) * slot.image.height * 4;
+    const auto* data = static_cast<const unsigned char*>(
+      glMapNamedBufferRange(slot.buffer, 0, size, GL_MAP_READ_BIT));
+    slot.image.pixels.assign(data, data + size);
+    glUnmapNamedBuffer(slot.buffer);
+    finished.push_back(std::move(slot.image));
+    slot.image = {};
+
+    oldest = (oldest + 1) % slots.size();
+    numInFlight--;
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 // Name: GetFilePath()
 // Desc:
@@ -711,6 +817,218 @@ namespace Shader {
         return result;
     }
 
+    namespace {
+        constexpr uint32_t PROGRAM_BINARY_MAGIC = 0x31434250; // "PBC1"
+
+        // Header of the program binary cache file, followed by binary code
+        struct ProgramBinaryHeader
+        {
+            uint32_t magic;
+            uint32_t format;
+            uint64_t key;
+            uint64_t length;
+        };
+
+        // FNV-1a, cache keys do not need to be cryptographically strong
+        uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+            const auto* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++) {
+                hash ^= bytes[i];
+                hash *= 0x100000001b3ull;
+            }
+            return hash;
+        }
+
+        uint64_t hashString(uint64_t hash, std::string_view str) {
+            // Hash also the length, so that concatenations do not collide
+            const uint64_t length = str.size();
+            hash = hashBytes(hash, &length, sizeof(length));
+            return hashBytes(hash, str.data(), str.size());
+        }
+
+        const std::string& getDriverString() {
+            static const std::string driver = [] {
+                const auto getString = [](GLenum name) {
+                    const auto* str
+                      = reinterpret_cast<const char*>(glGetString(name));
+                    return std::string{str ? str : ""};
+                };
+                return fmt::format("{}|{}|{}", getString(GL_VENDOR),
+                                   getString(GL_RENDERER),
+                                   getString(GL_VERSION));
+            }();
+            return driver;
+        }
+
+        std::filesystem::path getProgramBinaryPath(uint64_t key) {
+            return std::filesystem::path(Variables::ShaderBinaryCacheDirectory)
+                   / fmt::format("{:016x}.bin", key);
+        }
+
+        // Replaces #include "file" directives by the file contents. Files are
+        // searched next to the including file, include guards are up to the
+        // included files.
+        bool expandIncludes(std::string& source,
+                            const std::filesystem::path& directory,
+                            int depth = 0) {
+            constexpr int MaxIncludeDepth = 16;
+
+            std::string result;
+            size_t lineStart = 0;
+            while (lineStart < source.size()) {
+                size_t lineEnd = source.find('\n', lineStart);
+                if (lineEnd == std::string::npos) lineEnd = source.size();
+                const std::string_view line(source.data() + lineStart,
+                                            lineEnd - lineStart);
+                lineStart = lineEnd + 1;
+
+                const auto directive = line.find_first_not_of(" \t");
+                if (directive == std::string_view::npos
+                    || !line.substr(directive).starts_with("#include")) {
+                    result.append(line);
+                    result += '\n';
+                    continue;
+                }
+
+                const auto first = line.find('"', directive);
+                const auto last = first == std::string_view::npos
+                                    ? first
+                                    : line.find('"', first + 1);
+                if (last == std::string_view::npos) {
+                    spdlog::error("Invalid shader directive: {}", line);
+                    return false;
+                }
+                if (depth == MaxIncludeDepth) {
+                    spdlog::error("Shader includes are nested too deep: {}",
+                                  line);
+                    return false;
+                }
+
+                const auto path
+                  = directory
+                    / std::string(line.substr(first + 1, last - first - 1));
+                std::vector<char> content;
+                if (!Tools::ReadFile(content, path.string().c_str())
+                    || content.empty()) {
+                    spdlog::error("Shader include ({}) is empty or missing!",
+                                  path.string());
+                    return false;
+                }
+                std::string included(content.begin(), content.end());
+                if (!expandIncludes(included, path.parent_path(), depth + 1))
+                    return false;
+                result += included;
+                result += '\n';
+            }
+            source = std::move(result);
+            return true;
+        }
+    } // namespace
+
+    //-----------------------------------------------------------------------------
+    // Name: GetProgramBinaryKey()
+    // Desc:
+    //-----------------------------------------------------------------------------
+    uint64_t GetProgramBinaryKey(GLint count, const GLenum* shader_types,
+                                 const std::string* sources,
+                                 const std::vector<char*>* tbx) {
+        uint64_t key = hashString(0xcbf29ce484222325ull, getDriverString());
+        for (int i = 0; i < count; i++) {
+            if (shader_types[i] == GL_NONE) continue;
+            const auto type = static_cast<uint32_t>(shader_types[i]);
+            key = hashBytes(key, &type, sizeof(type));
+            key = hashString(key, sources[i]);
+        }
+        if (tbx) {
+            for (const char* varying : *tbx) key = hashString(key, varying);
+        }
+        return key;
+    }
+
+    //-----------------------------------------------------------------------------
+    // Name: LoadProgramBinary()
+    // Desc:
+    //-----------------------------------------------------------------------------
+    bool LoadProgramBinary(GLuint& programId, uint64_t key) {
+        std::ifstream file(getProgramBinaryPath(key), std::ios::binary);
+        if (!file) return false;
+
+        ProgramBinaryHeader header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != PROGRAM_BINARY_MAGIC || header.key != key
+            || header.length == 0) {
+            spdlog::warn("Program binary cache entry {:016x} is corrupted.",
+                         key);
+            return false;
+        }
+
+        std::vector<char> binary(header.length);
+        file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+        if (!file) return false;
+
+        GLuint pr_id = glCreateProgram();
+        glProgramBinary(pr_id, static_cast<GLenum>(header.format),
+                        binary.data(), static_cast<GLsizei>(binary.size()));
+        // Driver may reject binaries created by other driver versions
+        if (!CheckProgramLinkStatus(pr_id)) {
+            spdlog::debug("Program binary {:016x} rejected by the driver.",
+                          key);
+            glDeleteProgram(pr_id);
+            return false;
+        }
+
+        spdlog::debug("Program loaded from binary cache ({:016x}).", key);
+        programId = pr_id;
+        return true;
+    }
+
+    //-----------------------------------------------------------------------------
+    // Name: StoreProgramBinary()
+    // Desc:
+    //-----------------------------------------------------------------------------
+    bool StoreProgramBinary(GLuint programId, uint64_t key) {
+        GLint binaryLength = 0;
+        glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+        if (binaryLength < 1) return false;
+
+        ProgramBinaryHeader header{PROGRAM_BINARY_MAGIC, 0, key,
+                                   static_cast<uint64_t>(binaryLength)};
+        std::vector<char> binary(binaryLength);
+        GLenum binaryFormat = GL_NONE;
+        glGetProgramBinary(programId, binaryLength, nullptr, &binaryFormat,
+                           binary.data());
+        header.format = static_cast<uint32_t>(binaryFormat);
+
+        std::error_code error;
+        std::filesystem::create_directories(
+          Variables::ShaderBinaryCacheDirectory, error);
+
+        // Write to temporary file first, concurrently running instances must
+        // never see partially written cache entries
+        const auto path = getProgramBinaryPath(key);
+        auto tmpPath = path;
+        tmpPath += fmt::format(
+          ".{:x}.tmp",
+          std::chrono::steady_clock::now().time_since_epoch().count());
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(binary.data(),
+                       static_cast<std::streamsize>(binary.size()));
+            if (!file) {
+                spdlog::warn("Unable to write program binary cache entry {}.",
+                             tmpPath.string());
+                return false;
+            }
+        }
+        std::filesystem::rename(tmpPath, path, error);
+        if (error) {
+            std::filesystem::remove(tmpPath, error);
+            return false;
+        }
+        return true;
+    }
+
     //-----------------------------------------------------------------------------
     // Name: CheckShaderInfoLog()
     // Desc:
@@ -826,12 +1144,27 @@ namespace Shader {
     //-----------------------------------------------------------------------------
     GLuint CreateShaderFromFile(GLenum shader_type, const char* file_name,
                                 const char* preprocessor) {
+        std::string shader_source;
+        if (!LoadShaderSource(shader_source, file_name, preprocessor)) {
+            return 0;
+        }
+
+        return CreateShaderFromSource(shader_type, shader_source.c_str(),
+                                      file_name);
+    }
+
+    //-----------------------------------------------------------------------------
+    // Name: LoadShaderSource()
+    // Desc:
+    //-----------------------------------------------------------------------------
+    bool LoadShaderSource(std::string& source, const char* file_name,
+                          const char* preprocessor) {
         std::vector<char> fileContent;
         if (!Tools::ReadFile(fileContent, file_name)) {
             spdlog::error("Shader creation failed, input file ({}) is "
                           "empty or missing!",
                           file_name);
-            return 0;
+            return false;
         }
         fileContent.emplace_back('\0'); // null terminated
 
@@ -843,17 +1176,16 @@ namespace Shader {
             shader_header += "\n#define USER_TEST\n";
         }
 
-        std::string shader_source = &fileContent[0];
+        source = &fileContent[0];
+        if (!expandIncludes(source,
+                            std::filesystem::path(file_name).parent_path()))
+            return false;
         if (!shader_header.empty()) {
-            std::size_t insertIdx
-              = shader_source.find("\n", shader_source.find("#version"));
-            shader_source.insert((insertIdx != std::string::npos) ? insertIdx
-                                                                  : 0,
-                                 std::string("\n") + shader_header + "\n\n");
+            std::size_t insertIdx = source.find("\n", source.find("#version"));
+            source.insert((insertIdx != std::string::npos) ? insertIdx : 0,
+                          std::string("\n") + shader_header + "\n\n");
         }
-
-        return CreateShaderFromSource(shader_type, shader_source.c_str(),
-                                      file_name);
+        return true;
     }
 
     //-----------------------------------------------------------------------------
@@ -888,6 +1220,16 @@ namespace Shader {
         }
     }
 
+    //-----------------------------------------------------------------------------
+    // Name: ReplaceProgram()
+    // Desc:
+    //-----------------------------------------------------------------------------
+    void ReplaceProgram(GLuint& programId, GLuint newProgram) {
+        glDeleteProgram(programId);
+        _updateProgramList(programId, newProgram);
+        programId = newProgram;
+    }
+
     //-----------------------------------------------------------------------------
     // Name: CreateShaderProgram()
     // Desc:
@@ -964,29 +1306,39 @@ namespace Shader {
     }
 
     //-----------------------------------------------------------------------------
-    // Name: CreateShaderProgramFromFile()
-    // Desc:
+    // Name: _createShaderProgramFromFiles()
+    // Desc: Loads and links shader files, the program is taken from the program
+    //       binary cache if possible (and stored to the cache otherwise).
     //-----------------------------------------------------------------------------
-    bool CreateShaderProgramFromFile(GLuint& programId, const char* vs,
-                                     const char* tc, const char* te,
-                                     const char* gs, const char* fs,
-                                     const char* preprocessor,
-                                     const std::vector<char*>* tbx) {
-        GLenum shader_types[5] = {
-          static_cast<GLenum>(vs ? GL_VERTEX_SHADER : GL_NONE),
-          static_cast<GLenum>(tc ? GL_TESS_CONTROL_SHADER : GL_NONE),
-          static_cast<GLenum>(te ? GL_TESS_EVALUATION_SHADER : GL_NONE),
-          static_cast<GLenum>(gs ? GL_GEOMETRY_SHADER : GL_NONE),
-          static_cast<GLenum>(fs ? GL_FRAGMENT_SHADER : GL_NONE),
-        };
-        const char* source_file_names[5] = {vs, tc, te, gs, fs};
+    bool _createShaderProgramFromFiles(GLuint& programId, GLint count,
+                                       const GLenum* shader_types,
+                                       const char* const* file_names,
+                                       const char* preprocessor,
+                                       const std::vector<char*>* tbx) {
+        std::vector<std::string> sources(count);
+        for (int i = 0; i < count; i++) {
+            if (file_names[i]
+                && !LoadShaderSource(sources[i], file_names[i], preprocessor))
+                return false;
+        }
+
+        GLuint pr_id = 0;
+        uint64_t binaryKey = 0;
+        if (Variables::ShaderBinaryCache) {
+            binaryKey
+              = GetProgramBinaryKey(count, shader_types, sources.data(), tbx);
+            if (LoadProgramBinary(pr_id, binaryKey)) {
+                ReplaceProgram(programId, pr_id);
+                return true;
+            }
+        }
 
         // Create shader program object
-        GLuint pr_id = glCreateProgram();
-        for (int i = 0; i < 5; i++) {
-            if (source_file_names[i]) {
-                GLuint shader_id = CreateShaderFromFile(
-                  shader_types[i], source_file_names[i], preprocessor);
+        pr_id = glCreateProgram();
+        for (int i = 0; i < count; i++) {
+            if (file_names[i]) {
+                GLuint shader_id = CreateShaderFromSource(
+                  shader_types[i], sources[i].c_str(), file_names[i]);
                 if (shader_id == 0) {
                     glDeleteProgram(pr_id);
                     return false;
@@ -1000,7 +1352,7 @@ namespace Shader {
                                         static_cast<GLsizei>(tbx->size()),
                                         &(*tbx)[0], GL_INTERLEAVED_ATTRIBS);
         }
-        if (Variables::ShaderBinaryOutput) {
+        if (Variables::ShaderBinaryOutput || Variables::ShaderBinaryCache) {
             glProgramParameteri(pr_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
                                 GL_TRUE);
         }
@@ -1012,15 +1364,37 @@ namespace Shader {
             glDeleteProgram(pr_id);
             return false;
         }
+        if (Variables::ShaderBinaryCache) StoreProgramBinary(pr_id, binaryKey);
 
         // Remove program from OpenGL and update internal list
-        glDeleteProgram(programId);
-        _updateProgramList(programId, pr_id);
-        programId = pr_id;
+        ReplaceProgram(programId, pr_id);
 
         return true;
     }
 
+    //-----------------------------------------------------------------------------
+    // Name: CreateShaderProgramFromFile()
+    // Desc:
+    //-----------------------------------------------------------------------------
+    bool CreateShaderProgramFromFile(GLuint& programId, const char* vs,
+                                     const char* tc, const char* te,
+                                     const char* gs, const char* fs,
+                                     const char* preprocessor,
+                                     const std::vector<char*>* tbx) {
+        GLenum shader_types[5] = {
+          static_cast<GLenum>(vs ? GL_VERTEX_SHADER : GL_NONE),
+          static_cast<GLenum>(tc ? GL_TESS_CONTROL_SHADER : GL_NONE),
+          static_cast<GLenum>(te ? GL_TESS_EVALUATION_SHADER : GL_NONE),
+          static_cast<GLenum>(gs ? GL_GEOMETRY_SHADER : GL_NONE),
+          static_cast<GLenum>(fs ? GL_FRAGMENT_SHADER : GL_NONE),
+        };
+        const char* source_file_names[5] = {vs, tc, te, gs, fs};
+
+        return _createShaderProgramFromFiles(programId, 5, shader_types,
+                                             source_file_names, preprocessor,
+                                             tbx);
+    }
+
     //-----------------------------------------------------------------------------
     // Name: CreateMeshShaderProgramFromFile()
     // Desc:
@@ -1034,38 +1408,9 @@ namespace Shader {
              static_cast<GLenum>(fragment ? GL_FRAGMENT_SHADER : GL_NONE)};
         const char* source_file_names[3] = {mesh, task, fragment};
 
-        // Create shader program object
-        GLuint pr_id = glCreateProgram();
-        for (int i = 0; i < 3; i++) {
-            if (source_file_names[i]) {
-                GLuint shader_id = CreateShaderFromFile(
-                  shader_types[i], source_file_names[i], preprocessor);
-                if (shader_id == 0) {
-                    glDeleteProgram(pr_id);
-                    return false;
-                }
-                glAttachShader(pr_id, shader_id);
-                glDeleteShader(shader_id);
-            }
-        }
-        if (Variables::ShaderBinaryOutput) {
-            glProgramParameteri(pr_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
-                                GL_TRUE);
-        }
-        glLinkProgram(pr_id);
-        if (!CheckProgramLinkStatus(pr_id)) {
-            CheckProgramInfoLog(pr_id);
-            spdlog::error("Program linking failed. See previous log messages.");
-
-            glDeleteProgram(pr_id);
-            return false;
-        }
-
-        // Remove program from OpenGL and update internal list
-        glDeleteProgram(programId);
-        _updateProgramList(programId, pr_id);
-        programId = pr_id;
-        return true;
+        return _createShaderProgramFromFiles(programId, 3, shader_types,
+                                             source_file_names, preprocessor,
+                                             nullptr);
     }
 
     //-----------------------------------------------------------------------------
@@ -1076,35 +1421,9 @@ namespace Shader {
                                             const char* preprocessor) {
         if (cs == nullptr) return false;
 
-        // Create shader program object
-        GLuint pr_id = glCreateProgram();
-        GLuint shader_id
-          = CreateShaderFromFile(GL_COMPUTE_SHADER, cs, preprocessor);
-        if (shader_id == 0) {
-            glDeleteProgram(pr_id);
-            return false;
-        }
-        glAttachShader(pr_id, shader_id);
-        glDeleteShader(shader_id);
-        if (Variables::ShaderBinaryOutput) {
-            glProgramParameteri(pr_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
-                                GL_TRUE);
-        }
-        glLinkProgram(pr_id);
-        if (!CheckProgramLinkStatus(pr_id)) {
-            CheckProgramInfoLog(pr_id);
-            spdlog::error("Program linking failed. See previous log messages.");
-
-            glDeleteProgram(pr_id);
-            return false;
-        }
-
-        // Remove program from OpenGL and update internal list
-        glDeleteProgram(programId);
-        _updateProgramList(programId, pr_id);
-        programId = pr_id;
-
-        return true;
+        const GLenum shader_type = GL_COMPUTE_SHADER;
+        return _createShaderProgramFromFiles(programId, 1, &shader_type, &cs,
+                                             preprocessor, nullptr);
     }
 } // end of namespace Shader
 
@@ -0,0 +1,189 @@
+//-----------------------------------------------------------------------------
+//  [PGR2] CPU/GPU timeline capture in Chrome trace event format
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+#include <trace.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+// Escapes string for use in JSON
+std::string escapeJSON(std::string_view str) {
+    std::string result;
+    result.reserve(str.size());
+    for (char c : str) {
+        if (c == '"' || c == '\\') result += '\\';
+        if (static_cast<unsigned char>(c) < 0x20)
+            result += ' ';
+        else
+            result += c;
+    }
+    return result;
+}
+} // namespace
+
+namespace Tools {
+//-----------------------------------------------------------------------------
+// Name: get()
+// Desc:
+//-----------------------------------------------------------------------------
+TraceRecorder& TraceRecorder::get() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+//-----------------------------------------------------------------------------
+// Name: capture()
+// Desc:
+//-----------------------------------------------------------------------------
+void TraceRecorder::capture(int firstFrame, int numFrames,
+                            std::string fileName) {
+    if (recording) stop();
+    this->firstFrame = firstFrame;
+    this->numFrames = std::max(numFrames, 0);
+    this->fileName = std::move(fileName);
+}
+
+//-----------------------------------------------------------------------------
+// Name: beginFrame()
+// Desc:
+//-----------------------------------------------------------------------------
+void TraceRecorder::beginFrame(int frame) {
+    if (!isPending()) return;
+
+    const double now = GetCPUTime();
+    if (recording) {
+        events.push_back(
+          Event{fmt::format("Frame {}", this->frame), Track::CPU, frameStart,
+                now});
+        if (frame >= firstFrame + numFrames) {
+            stop();
+            return;
+        }
+    } else {
+        if (frame < firstFrame) return;
+
+        // GPU timestamps are converted to the CPU clock, the current GPU time
+        // is compared with the CPU time once at the capture start
+        GLint64 gpuTime = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+        gpuClockOffset = GetCPUTime() - static_cast<double>(gpuTime) * 0.001;
+        captureStart = now;
+        recording = true;
+        spdlog::info("Recording trace of frames {}-{}.", firstFrame,
+                     firstFrame + numFrames - 1);
+    }
+    this->frame = frame;
+    frameStart = now;
+}
+
+//-----------------------------------------------------------------------------
+// Name: stop()
+// Desc:
+//-----------------------------------------------------------------------------
+void TraceRecorder::stop() {
+    if (recording) {
+        resolveGPURanges();
+        write();
+    }
+
+    recording = false;
+    numFrames = 0;
+    events.clear();
+    gpuRanges.clear();
+    if (!queries.empty()) {
+        glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+        queries.clear();
+    }
+    usedQueries = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name: addCPUEvent()
+// Desc:
+//-----------------------------------------------------------------------------
+void TraceRecorder::addCPUEvent(std::string_view name, double start,
+                                double end) {
+    if (!recording) return;
+    events.push_back(Event{std::string(name), Track::CPU, start, end});
+}
+
+//-----------------------------------------------------------------------------
+// Name: beginGPURange()
+// Desc:
+//-----------------------------------------------------------------------------
+int TraceRecorder::beginGPURange(std::string_view name) {
+    if (!recording) return -1;
+    GPURange range{std::string(name), allocateQuery(), allocateQuery()};
+    glQueryCounter(range.queryStart, GL_TIMESTAMP);
+    gpuRanges.push_back(std::move(range));
+    return static_cast<int>(gpuRanges.size() - 1);
+}
+
+//-----------------------------------------------------------------------------
+// Name: endGPURange()
+// Desc:
+//-----------------------------------------------------------------------------
+void TraceRecorder::endGPURange(int range) {
+    // Capture may have finished since the range was started
+    if (!recording || range >= static_cast<int>(gpuRanges.size())) return;
+    glQueryCounter(gpuRanges[range].queryStop, GL_TIMESTAMP);
+}
+
+GLuint TraceRecorder::allocateQuery() {
+    if (usedQueries == queries.size()) {
+        const size_t newSize = std::max<size_t>(256, queries.size() * 2);
+        queries.resize(newSize);
+        glGenQueries(static_cast<GLsizei>(newSize - usedQueries),
+                     queries.data() + usedQueries);
+    }
+    return queries[usedQueries++];
+}
+
+void TraceRecorder::resolveGPURanges() {
+    // Results are read once after the capture, so that waiting for them does
+    // not show up in the trace
+    QueryBufferRelease queryBufferRelease;
+    for (const auto& range : gpuRanges) {
+        GLuint64 start = 0, stop = 0;
+        glGetQueryObjectui64v(range.queryStart, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(range.queryStop, GL_QUERY_RESULT, &stop);
+        events.push_back(
+          Event{range.name, Track::GPU,
+                static_cast<double>(start) * 0.001 + gpuClockOffset,
+                static_cast<double>(stop) * 0.001 + gpuClockOffset});
+    }
+}
+
+void TraceRecorder::write() const {
+    std::ofstream file(fileName);
+    if (!file) {
+        spdlog::error("Unable to write trace to {}.", fileName);
+        return;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    // Track names
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,"
+            "\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,"
+            "\"args\":{\"name\":\"GPU\"}}";
+    for (const auto& event : events) {
+        file << fmt::format(
+          ",\n{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":0,"
+          "\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+          escapeJSON(event.name), event.track == Track::CPU ? "cpu" : "gpu",
+          event.track == Track::CPU ? 0 : 1, event.start - captureStart,
+          std::max(event.end - event.start, 0.0));
+    }
+    file << "\n]}\n";
+
+    spdlog::info("Trace with {} events written to {}.", events.size(),
+                 fileName);
+}
+} // end of namespace Tools